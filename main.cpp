@@ -1,8 +1,12 @@
 #include "d3dApp.h"
 #include "MathHelper.h"
-#include "UploadBuffer.h"
+#include "UploadHeapBackend.h"
 #include "KeyCode.h"
 #include "FrameResource.h"
+#include "D3DShaderCompiler.h"
+#include "Headless.h"
+#include "Simulation.h"
+#include "Trace.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -10,21 +14,14 @@ using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
+// Upload memory for per-frame constants and transient data, shared by all frames in flight.
+const std::size_t gFrameAllocatorSize = 64 * 1024 * gNumFrameResources;
+
 struct Vertex
 {
 	XMFLOAT3 Pos;
 };
 
-struct Input
-{
-	float Horizontal = 0.0f;
-	float Vertical = 0.0f;
-	
-	bool GetKey_E = false;
-	bool GetKey_Q = false;
-	bool GetKey_LShift = false;
-};
-
 class RayMarching : public D3DApp
 {
 public:
@@ -46,6 +43,9 @@ private:
 	virtual void OnMouseMove(WPARAM btnState, int x, int y) override;
 
 	void UpdateMainPassCB(const GameTimer& gt);
+	void ToggleRecording();
+	void ToggleTracing();
+	void DumpFrameStats();
 
 	void BuildRootSignature();
 	void BuildShadersAndInputLayout();
@@ -57,6 +57,11 @@ private:
 	std::vector<std::unique_ptr<FrameResource>> mFrameResources;
 	FrameResource* mCurrFrameResource = nullptr;
 	int mCurrFrameResourceIndex = 0;
+	HANDLE mFenceEvent = nullptr;
+
+	std::unique_ptr<UploadHeapBackend> mUploadHeap;
+	std::unique_ptr<LinearRingAllocator> mFrameAllocator;
+	D3D12_GPU_VIRTUAL_ADDRESS mPassCBAddress = 0;
 
 	ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
 	std::unique_ptr<MeshGeometry> mGeometry = nullptr;
@@ -64,28 +69,35 @@ private:
 	ComPtr<ID3DBlob> mvsByteCode = nullptr;
 	ComPtr<ID3DBlob> mpsByteCode = nullptr;
 
+	// Macros selecting the Fractal.hlsl permutation, e.g. { "SCENE_MAX_STEPS", "300" }.
+	// Every set gets its own entry in shaders/cache.
+	std::vector<ShaderDefine> mShaderDefines;
+
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
 	ComPtr<ID3D12PipelineState> mPSO = nullptr;
 
-	XMFLOAT4X4 mWorld = MathHelper::Identity4x4();
-	XMFLOAT4X4 mProj = MathHelper::Identity4x4();
+	Simd::Float4x4 mWorld = MathHelper::Identity4x4();
+	Simd::Float4x4 mProj = MathHelper::Identity4x4();
 
-	XMVECTOR mPosition = XMVectorSet(3.0f, 0.0f, -3.0f, 1.0f);
-	Input mInput;
-	float mMoveSpeedHor = 1.0f;
-	float mMoveSpeedVert = 1.0f;
-	float mMoveSpeedAcceleration = .1f;
+	// Camera and power are integrated at a fixed rate on the simulation thread;
+	// mCamera is the state interpolated for the frame being drawn.
+	Simulation mSimulation;
+	CameraState mCamera;
+	CameraInput mInput;
 
-	float mTheta = 3.0f * XM_PIDIV4;
-	float mPhi = XM_PIDIV2;
+	// F5 records every simulation tick's input to camera.camlog for headless replay.
+	bool mRecordingActive = false;
+
+	// Stages reported to mFrameStats; F7 writes frame_stats.csv and frame_stats.json.
+	int mUpdateStage = -1;
+	int mFenceWaitStage = -1;
+	int mDrawStage = -1;
+	int mPresentStage = -1;
 
 	POINT mLastMousePos;
 
 	float fovAngleY = .25f * MathHelper::Pi;
-
-	float mPower = 8.0f;
-	float mPowerGrowSpeed = 0.0f;
 };
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, PSTR cmdLine, int showCmd)
@@ -93,6 +105,18 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, PSTR cmdLine, in
 #if defined(DEBUG) | defined(_DEBUG)
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
+	if (IsHeadlessCommandLine(cmdLine))
+	{
+		// Headless modes print to the console they were started from.
+		if (AttachConsole(ATTACH_PARENT_PROCESS))
+		{
+			FILE* stream = nullptr;
+			freopen_s(&stream, "CONOUT$", "w", stdout);
+			freopen_s(&stream, "CONOUT$", "w", stderr);
+		}
+		return RunHeadless(__argc, __argv);
+	}
+
 	try
 	{
 		RayMarching theApp(hInstance);
@@ -115,6 +139,12 @@ RayMarching::RayMarching(HINSTANCE hInstance) :
 
 RayMarching::~RayMarching()
 {
+	// The frame allocator's upload heap is released before D3DApp's destructor flushes.
+	if (md3dDevice != nullptr)
+		FlushCommandQueue();
+
+	if (mFenceEvent != nullptr)
+		CloseHandle(mFenceEvent);
 }
 
 bool RayMarching::Initialize()
@@ -122,6 +152,11 @@ bool RayMarching::Initialize()
 	if (!D3DApp::Initialize())
 		return false;
 
+	// Auto-reset event reused by every frame resource wait.
+	mFenceEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+	if (mFenceEvent == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+
 	ThrowIfFailed(mCommandList->Reset(mCommandListAlloc.Get(), nullptr));
 
 	BuildRootSignature();
@@ -130,6 +165,13 @@ bool RayMarching::Initialize()
 	BuildFrameResources();
 	BuildPSO();
 
+	mSimulation.Start(mCamera);
+
+	mUpdateStage = mFrameStats.Stage("update");
+	mFenceWaitStage = mFrameStats.Stage("fence_wait");
+	mDrawStage = mFrameStats.Stage("draw");
+	mPresentStage = mFrameStats.Stage("present");
+
 	ThrowIfFailed(mCommandList->Close());
 	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
 	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
@@ -146,11 +188,20 @@ LRESULT RayMarching::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		switch (wParam)
 		{
 		case VK_RIGHT:
-			mPowerGrowSpeed += .01f;
+			mInput.PowerSteps++;
 			return 0;
 		case VK_LEFT:
-			mPowerGrowSpeed -= .01f;
+			mInput.PowerSteps--;
+			return 0;
+		case VK_F5:
+			ToggleRecording();
+			return 0;
+		case VK_F6:
+			ToggleTracing();
 			return 0; 
+		case VK_F7:
+			DumpFrameStats();
+			return 0;
 
 		case KeyCode::W:
 			mInput.Vertical = +1.0f;
@@ -166,14 +217,14 @@ LRESULT RayMarching::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 			return 0;
 
 		case KeyCode::E:
-			mInput.GetKey_E = true;
+			mInput.Up = true;
 			return 0;
 		case KeyCode::Q:
-			mInput.GetKey_Q = true;
+			mInput.Down = true;
 			return 0;
 
 		case KeyCode::LeftShift:
-			mInput.GetKey_LShift = true;
+			mInput.Boost = true;
 			return 0;
 		}
 	}
@@ -190,13 +241,13 @@ LRESULT RayMarching::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 			mInput.Horizontal = 0.0f;
 			return 0;
 		case KeyCode::E:
-			mInput.GetKey_E = false;
+			mInput.Up = false;
 			return 0;
 		case KeyCode::Q:
-			mInput.GetKey_Q = false;
+			mInput.Down = false;
 			return 0;
 		case KeyCode::LeftShift:
-			mInput.GetKey_LShift = false;
+			mInput.Boost = false;
 			return 0;
 		}
 	}
@@ -208,14 +259,18 @@ void RayMarching::OnResize()
 {
 	D3DApp::OnResize();
 
-	XMMATRIX P = XMMatrixPerspectiveFovLH(.25f * MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
-	XMStoreFloat4x4(&mProj, P);
+	Simd::Matrix P = Simd::MatrixPerspectiveFovLH(.25f * MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
+	Simd::StoreFloat4x4(&mProj, P);
 }
 
 void RayMarching::Update(const GameTimer& gt)
 {
-	mPower += mPowerGrowSpeed * mTimer.DeltaTime();
-	if (mPower < 1.0f) mPower = 1.0f;
+	TRACE_SCOPE("Update");
+	FrameStageTimer stageTimer(mFrameStats, mUpdateStage);
+
+	mSimulation.Submit(mInput);
+	mInput.ResetFrameDeltas();
+	mCamera = mSimulation.Sample();
 
 	// Cycle through the circular frame resource array.
 	mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
@@ -225,17 +280,22 @@ void RayMarching::Update(const GameTimer& gt)
 	// If not, wait until the GPU has completed commands up to this point.
 	if (mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
 	{
-		HANDLE eventHandle = CreateEventEx(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS);
-		ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
+		TRACE_SCOPE("Wait for frame resource");
+		FrameStageTimer waitTimer(mFrameStats, mFenceWaitStage);
+		ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, mFenceEvent));
+		WaitForSingleObject(mFenceEvent, INFINITE);
 	}
 
+	mFrameAllocator->Reclaim(mFence->GetCompletedValue());
+
 	UpdateMainPassCB(gt);
 }
 
 void RayMarching::Draw(const GameTimer& gt)
 {
+	TRACE_SCOPE("Draw");
+	FrameStageTimer stageTimer(mFrameStats, mDrawStage);
+
 	auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
 
 	ThrowIfFailed(cmdListAlloc->Reset());
@@ -270,8 +330,7 @@ void RayMarching::Draw(const GameTimer& gt)
 
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
-	D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = mCurrFrameResource->PassCB->Resource()->GetGPUVirtualAddress();
-	mCommandList->SetGraphicsRootConstantBufferView(0, passCBAddress);
+	mCommandList->SetGraphicsRootConstantBufferView(0, mPassCBAddress);
 
 	D3D12_VERTEX_BUFFER_VIEW vertexBuffer = mGeometry->VertexBufferView();
 	D3D12_INDEX_BUFFER_VIEW indexBuffer = mGeometry->IndexBufferView();
@@ -296,13 +355,18 @@ void RayMarching::Draw(const GameTimer& gt)
 	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
 	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
-	ThrowIfFailed(mSwapChain->Present(0, 0));
+	{
+		TRACE_SCOPE("Present");
+		FrameStageTimer presentTimer(mFrameStats, mPresentStage);
+		ThrowIfFailed(mSwapChain->Present(0, 0));
+	}
 	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
 
 	// Advance the fence value to mark commands up to this fence point.
 	mCurrFrameResource->Fence = ++mCurrentFence;
 
 	mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+	mFrameAllocator->EndFrame(mCurrentFence);
 }
 
 void RayMarching::OnMouseDown(WPARAM btnState, int x, int y)
@@ -322,12 +386,8 @@ void RayMarching::OnMouseMove(WPARAM btnState, int x, int y)
 {
 	if ((btnState & MK_LBUTTON) != 0)
 	{
-		float dx = -XMConvertToRadians(.25f * static_cast<float>(x - mLastMousePos.x));
-		float dy = XMConvertToRadians(.25f * static_cast<float>(y - mLastMousePos.y));
-		
-		mTheta += dx;
-		mPhi += dy;
-		mPhi = MathHelper::Clamp(mPhi, .1f, MathHelper::Pi - .1f);
+		mInput.MouseDx += x - mLastMousePos.x;
+		mInput.MouseDy += y - mLastMousePos.y;
 	}
 	else if ((btnState & MK_RBUTTON) != 0)
 	{
@@ -339,56 +399,79 @@ void RayMarching::OnMouseMove(WPARAM btnState, int x, int y)
 	mLastMousePos.y = y;
 }
 
-void RayMarching::UpdateMainPassCB(const GameTimer& gt)
+void RayMarching::ToggleRecording()
+{
+	if (!mRecordingActive)
+	{
+		mSimulation.StartRecording();
+		mRecordingActive = true;
+		return;
+	}
+
+	mRecordingActive = false;
+	if (!mSimulation.StopRecording("camera.camlog"))
+		MessageBox(mhMainWnd, L"Could not write camera.camlog", L"Recording", MB_OK);
+}
+
+void RayMarching::ToggleTracing()
 {
-	float x = sinf(mPhi) * cosf(mTheta);
-	float z = sinf(mPhi) * sinf(mTheta);
-	float y = cosf(mPhi);
+	if (!Trace::IsActive())
+	{
+		Trace::Start();
+		return;
+	}
 
-	XMVECTOR pos = mPosition;
-	XMVECTOR target = XMVectorSet(x, y, z, 0.0f) + mPosition;
-	XMVECTOR up = XMVectorSet(.0f, 1.0f, .0f, .0f);
+	Trace::Stop();
+	if (!Trace::WriteJson("trace.json"))
+		MessageBox(mhMainWnd, L"Could not write trace.json", L"Tracing", MB_OK);
+}
 
-	XMVECTOR lForward = XMVector3Normalize(target - mPosition);
-	XMVECTOR lRight = XMVector3Normalize(XMVector3Cross(lForward, up));
+void RayMarching::DumpFrameStats()
+{
+	if (!mFrameStats.WriteCsv("frame_stats.csv") || !mFrameStats.WriteJson("frame_stats.json"))
+		MessageBox(mhMainWnd, L"Could not write frame_stats.csv/json", L"Frame stats", MB_OK);
+}
 
-	mPosition = mPosition + (
-		lForward * mInput.Vertical * mMoveSpeedHor
-		+ lRight * mInput.Horizontal * mMoveSpeedHor
-		+ up * (mInput.GetKey_E ? +1.0f : mInput.GetKey_Q ? -1.0f : 0.0f) * mMoveSpeedVert
-		) * (mInput.GetKey_LShift ? mMoveSpeedAcceleration : 1.0f) * mTimer.DeltaTime();
+void RayMarching::UpdateMainPassCB(const GameTimer& gt)
+{
+	TRACE_SCOPE("UpdateMainPassCB");
 
-	pos = mPosition;
-	target = XMVectorSet(x, y, z, 0.0f) + mPosition;
+	Vec3f forward = CameraController::Forward(mCamera);
 
+	Simd::Vector pos = Simd::VectorSet(mCamera.Position.x, mCamera.Position.y, mCamera.Position.z, 1.0f);
+	Simd::Vector target = Simd::VectorSet(forward.x, forward.y, forward.z, 0.0f) + pos;
+	Simd::Vector up = Simd::VectorSet(.0f, 1.0f, .0f, .0f);
 
-	XMMATRIX world = XMLoadFloat4x4(&mWorld);
-	XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
-	XMMATRIX proj = XMLoadFloat4x4(&mProj);
+	Simd::Matrix world = Simd::LoadFloat4x4(mWorld);
+	Simd::Matrix view = Simd::MatrixLookAtLH(pos, target, up);
+	Simd::Matrix proj = Simd::LoadFloat4x4(mProj);
 
-	XMMATRIX worldView = world * view;
-	XMMATRIX worldViewProj = worldView * proj;
+	Simd::Matrix worldView = world * view;
+	Simd::Matrix worldViewProj = worldView * proj;
 
-	worldView = XMMatrixTranspose(worldView);
-	worldViewProj = XMMatrixTranspose(worldViewProj);
+	worldView = Simd::MatrixTranspose(worldView);
+	worldViewProj = Simd::MatrixTranspose(worldViewProj);
 
 	PassConstants passConstants;
 	
-	XMVECTOR worldViewDeterminant = XMMatrixDeterminant(worldView);
-	XMStoreFloat4x4(&passConstants.World, XMMatrixTranspose(world));
-	XMStoreFloat4x4(&passConstants.WorldView, worldView);
-	XMStoreFloat4x4(&passConstants.InvWorldView, XMMatrixInverse(&worldViewDeterminant, worldView));
-	XMStoreFloat4x4(&passConstants.WorldViewProj, worldViewProj);
+	Simd::StoreFloat4x4(&passConstants.World, Simd::MatrixTranspose(world));
+	Simd::StoreFloat4x4(&passConstants.WorldView, worldView);
+	Simd::StoreFloat4x4(&passConstants.InvWorldView, Simd::MatrixInverse(nullptr, worldView));
+	Simd::StoreFloat4x4(&passConstants.WorldViewProj, worldViewProj);
 
-	XMStoreFloat3(&passConstants.CamPos, mPosition);
+	Simd::StoreFloat3(&passConstants.CamPos, pos);
 	passConstants.AspectRatio = AspectRatio();
 	
-	passConstants.FractalPower = mPower;
+	passConstants.FractalPower = mCamera.Power;
 
-	passConstants.Color = XMFLOAT3(0.0f, 0.0f, 1.0f);
+	passConstants.Color = Simd::Float3(0.0f, 0.0f, 1.0f);
 	passConstants.Darkness = 150.0f;
 
-	mCurrFrameResource->PassCB->CopyData(0, passConstants);
+	// The frame resource wait in Update has reclaimed this frame's share of the ring.
+	RingAllocation passCB = mFrameAllocator->Push(passConstants);
+	if (!passCB)
+		ThrowIfFailed(E_OUTOFMEMORY);
+	mPassCBAddress = passCB.Gpu;
 }
 
 void RayMarching::BuildRootSignature()
@@ -432,8 +515,43 @@ void RayMarching::BuildShadersAndInputLayout()
 {
 	HRESULT hr = S_OK;
 
-	mvsByteCode = d3dUtil::CompileShader(L"shaders/Fractal.hlsl", nullptr, "VS", "vs_5_0");
-	mpsByteCode = d3dUtil::CompileShader(L"shaders/Fractal.hlsl", nullptr, "PS", "ps_5_0");
+	// Regenerate the cbuffer declaration if fields were added to PassConstantsLayout.
+	if (!PassConstantsLayout::WriteHlsl(PassConstantsLayout::HlslPath))
+		OutputDebugStringA("Could not update shaders/PassConstants.hlsli\n");
+
+	UINT compileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)
+	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+	// Bytecode is reused across runs until Fractal.hlsl or anything it includes changes.
+	D3DShaderCompiler compiler;
+	ShaderCache cache(compiler, "shaders/cache");
+
+	auto load = [&](const char* entryPoint, const char* target)
+	{
+		ShaderRequest request;
+		request.Path = "shaders/Fractal.hlsl";
+		request.EntryPoint = entryPoint;
+		request.Target = target;
+		request.Defines = mShaderDefines;
+		request.Flags = compileFlags;
+
+		// Compile errors have already gone to the debug output.
+		std::string path = cache.Resolve(request);
+		if (path.empty())
+			ThrowIfFailed(E_FAIL);
+		return d3dUtil::LoadBinary(AnsiToWString(path));
+	};
+
+	mvsByteCode = load("VS", "vs_5_0");
+	mpsByteCode = load("PS", "ps_5_0");
+
+	const ShaderCacheStats& stats = cache.Stats();
+	char message[160];
+	sprintf_s(message, "Shaders: %d cached, %d compiled (%.1f ms compiling, %.2f ms validating)\n",
+		stats.Hits, stats.Misses + stats.Invalidated, stats.CompileMs, stats.LookupMs);
+	OutputDebugStringA(message);
 
 	mInputLayout =
 	{
@@ -527,6 +645,9 @@ void RayMarching::BuildPSO()
 
 void RayMarching::BuildFrameResources() {
 	for (int i = 0; i < gNumFrameResources; ++i) {
-		mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(), 1));
+		mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get()));
 	}
+
+	mUploadHeap = std::make_unique<UploadHeapBackend>(md3dDevice.Get(), gFrameAllocatorSize);
+	mFrameAllocator = std::make_unique<LinearRingAllocator>(*mUploadHeap);
 }
\ No newline at end of file
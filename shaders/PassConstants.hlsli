@@ -0,0 +1,16 @@
+// Generated from PASS_CONSTANTS_FIELDS in src/include/PassConstantsLayout.h; do not edit.
+cbuffer cbPerObject : register(b0)
+{
+	float4x4 gWorld; // offset 0
+	float4x4 gWorldView; // offset 64
+	float4x4 gInvWorldView; // offset 128
+	float4x4 gWorldViewProj; // offset 192
+
+	float3 gCamPos; // offset 256
+	float gAspectRatio; // offset 268
+
+	float3 gColor; // offset 272
+	float gDarkness; // offset 284
+
+	float gPower; // offset 288
+};
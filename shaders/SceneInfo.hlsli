@@ -0,0 +1,118 @@
+// Distance estimator and march loop shared by the shaders and the C++ reference
+// (src/include/SceneInfo.h). Keep to the subset HlslShim.h implements: float
+// literals, no swizzles, no globals (cbuffer values come in as parameters).
+
+#ifndef SHADER_INLINE
+#define SHADER_INLINE
+#endif
+
+// Variants override these with SCENE_MAX_STEPS, SCENE_MAX_ITERATIONS and
+// SCENE_FIXED_POWER (a literal power the compiler can fold into pow).
+#ifdef SCENE_MAX_STEPS
+static const int MaxSteps = SCENE_MAX_STEPS;
+#else
+static const int MaxSteps = 150;
+#endif
+
+#ifdef SCENE_MAX_ITERATIONS
+static const int MaxIterations = SCENE_MAX_ITERATIONS;
+#else
+static const int MaxIterations = 15;
+#endif
+
+static const float MaxDistance = 100.0f;
+static const float Epsilon = 1e-3f;
+static const float Bailout = 2.0f;
+
+struct MarchInfo
+{
+	float Steps;
+	float Iterations;
+	float Distance;
+	bool Hit;
+};
+
+// Number of iterations, Calculated distance
+SHADER_INLINE float2 SceneInfo(float3 position, float power)
+{
+#ifdef SCENE_FIXED_POWER
+	power = SCENE_FIXED_POWER;
+#endif
+
+	float3 z = position;
+	float dr = 1.0f;
+	float r = 0.0f;
+	int iterations = 0;
+
+	for (int i = 0; i < MaxIterations; i++)
+	{
+		++iterations;
+		r = length(z);
+
+		if (r > Bailout) break;
+
+		// convert to polar coordinates
+		float theta = acos(z.z / r);
+		float phi = atan2(z.y, z.x);
+		dr = pow(r, power - 1.0f) * power * dr + 1.0f;
+
+		// scale and rotate the point
+		float zr = pow(r, power);
+		theta = theta * power;
+		phi = phi * power;
+
+		// convert back to cartesian coordinates
+		z = zr * float3(
+			sin(theta) * cos(phi),
+			sin(phi) * sin(theta),
+			cos(theta));
+		z += position;
+	}
+
+	return float2((float)iterations, 0.5f * log(r) * r / dr);
+}
+
+SHADER_INLINE MarchInfo March(float3 origin, float3 direction, float power)
+{
+	MarchInfo info;
+	info.Steps = 0.0f;
+	info.Iterations = 0.0f;
+	info.Distance = 0.0f;
+	info.Hit = false;
+
+	float3 position = origin;
+	while (info.Distance < MaxDistance && info.Steps < (float)MaxSteps)
+	{
+		++info.Steps;
+		float2 sceneInfo = SceneInfo(position, power);
+		float dist = sceneInfo.y;
+
+		// Ray has hit a surface
+		if (dist <= Epsilon)
+		{
+			info.Iterations = sceneInfo.x;
+			info.Hit = true;
+			break;
+		}
+
+		position += direction * dist;
+		info.Distance += dist;
+	}
+
+	return info;
+}
+
+SHADER_INLINE float4 Shade(MarchInfo info, float3 color, float darkness)
+{
+	float4 result = float4(0.0f, 0.0f, 0.0f, 1.0f);
+	if (info.Hit)
+	{
+		float colourB = saturate(info.Iterations / (float)MaxIterations);
+		float3 colourMix = saturate(colourB * color);
+		result = float4(colourMix, 1.0f);
+	}
+
+	// Factored so there is no multiply-add to contract; the C++ copy then rounds the same.
+	float rim = info.Steps / darkness;
+	return saturate((result + float4(color, 1.0f)) * rim);
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "Arena.h"
+#include <algorithm>
+
+Arena::Arena(std::size_t blockSize) :
+	mBlockSize(std::max<std::size_t>(blockSize, 64))
+{
+}
+
+void* Arena::Allocate(std::size_t size, std::size_t alignment)
+{
+	alignment = std::max<std::size_t>(alignment, 1);
+
+	while (true)
+	{
+		if (mBlock < mBlocks.size())
+		{
+			Block& block = mBlocks[mBlock];
+			std::uintptr_t base = (std::uintptr_t)block.Memory.get();
+			std::uintptr_t aligned = (base + mOffset + alignment - 1) & ~(std::uintptr_t)(alignment - 1);
+			std::size_t end = (std::size_t)(aligned - base) + size;
+			if (end <= block.Size)
+			{
+				mOffset = end;
+				mPeakUsed = std::max(mPeakUsed, Used());
+				return (void*)aligned;
+			}
+
+			// Too little left here; the rest of this block is lost until the next Rewind or Reset.
+			if (mBlock + 1 < mBlocks.size())
+			{
+				++mBlock;
+				mOffset = 0;
+				continue;
+			}
+		}
+
+		AddBlock(std::max(mBlockSize, size + alignment));
+		mBlock = mBlocks.size() - 1;
+		mOffset = 0;
+	}
+}
+
+Arena::Marker Arena::Mark() const
+{
+	Marker marker;
+	marker.Block = mBlock;
+	marker.Offset = mOffset;
+	return marker;
+}
+
+void Arena::Rewind(const Marker& marker)
+{
+	mBlock = marker.Block;
+	mOffset = marker.Offset;
+}
+
+void Arena::Reset()
+{
+	if (mBlocks.size() > 1)
+	{
+		std::size_t size = std::max(mPeakUsed, Capacity());
+		mBlocks.clear();
+		AddBlock(size);
+	}
+
+	mBlock = 0;
+	mOffset = 0;
+	mPeakUsed = 0;
+}
+
+std::size_t Arena::Used() const
+{
+	std::size_t used = mOffset;
+	for (std::size_t i = 0; i < mBlock && i < mBlocks.size(); ++i)
+		used += mBlocks[i].Size;
+	return used;
+}
+
+std::size_t Arena::PeakUsed() const
+{
+	return mPeakUsed;
+}
+
+std::size_t Arena::Capacity() const
+{
+	std::size_t capacity = 0;
+	for (const Block& block : mBlocks)
+		capacity += block.Size;
+	return capacity;
+}
+
+std::uint64_t Arena::HeapAllocations() const
+{
+	return mHeapAllocations;
+}
+
+void Arena::AddBlock(std::size_t size)
+{
+	// new[] storage is aligned for any fundamental type; larger alignments are found inside the block.
+	Block block;
+	block.Memory.reset(new std::uint8_t[size]);
+	block.Size = size;
+	mBlocks.push_back(std::move(block));
+	++mHeapAllocations;
+}
\ No newline at end of file
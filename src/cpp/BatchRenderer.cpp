@@ -0,0 +1,586 @@
+#include "BatchRenderer.h"
+#include "FrameRing.h"
+#include "Hash.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	enum BatchStage
+	{
+		RenderStage,
+		ConvertStage,
+		WriteStage,
+		StageCount
+	};
+
+	double ElapsedMs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	double Lerp(double a, double b, double t)
+	{
+		return a + (b - a) * t;
+	}
+
+	std::uint8_t ToByte(float x)
+	{
+		return (std::uint8_t)(x < 0.0f ? 0.0f : (x > 255.0f ? 255.0f : x + 0.5f));
+	}
+
+	// Full range BT.601 planes (as in C420jpeg): chroma is averaged over 2x2 blocks, edges clamp.
+	void ConvertI420(const CpuFramebuffer& source, std::uint8_t* out)
+	{
+		const int width = source.Width;
+		const int height = source.Height;
+		const std::size_t pixels = (std::size_t)width * height;
+		const int chromaWidth = (width + 1) / 2;
+		const int chromaHeight = (height + 1) / 2;
+		const std::size_t chromaSize = (std::size_t)chromaWidth * chromaHeight;
+
+		std::uint8_t* lumaPlane = out;
+		std::uint8_t* cbPlane = lumaPlane + pixels;
+		std::uint8_t* crPlane = cbPlane + chromaSize;
+
+		for (std::size_t i = 0; i < pixels; ++i)
+		{
+			std::uint32_t c = source.Color[i];
+			float r = (float)(c & 0xff);
+			float g = (float)((c >> 8) & 0xff);
+			float b = (float)((c >> 16) & 0xff);
+			lumaPlane[i] = ToByte(0.299f * r + 0.587f * g + 0.114f * b);
+		}
+
+		for (int cy = 0; cy < chromaHeight; ++cy)
+		{
+			for (int cx = 0; cx < chromaWidth; ++cx)
+			{
+				float r = 0.0f, g = 0.0f, b = 0.0f;
+				for (int dy = 0; dy < 2; ++dy)
+				{
+					for (int dx = 0; dx < 2; ++dx)
+					{
+						int x = std::min(cx * 2 + dx, width - 1);
+						int y = std::min(cy * 2 + dy, height - 1);
+						std::uint32_t c = source.Color[(std::size_t)y * width + x];
+						r += (float)(c & 0xff);
+						g += (float)((c >> 8) & 0xff);
+						b += (float)((c >> 16) & 0xff);
+					}
+				}
+				r *= 0.25f;
+				g *= 0.25f;
+				b *= 0.25f;
+
+				std::size_t index = (std::size_t)cy * chromaWidth + cx;
+				cbPlane[index] = ToByte(128.0f - 0.168736f * r - 0.331264f * g + 0.5f * b);
+				crPlane[index] = ToByte(128.0f + 0.5f * r - 0.418688f * g - 0.081312f * b);
+			}
+		}
+	}
+}
+
+BatchRenderer::BatchRenderer(const BatchOptions& options) :
+	mOptions(options)
+{
+	mOptions.FrameCount = std::max(mOptions.FrameCount, 1);
+	mOptions.QueueDepth = std::max(mOptions.QueueDepth, 1);
+}
+
+const BatchStats& BatchRenderer::Stats() const
+{
+	return mStats;
+}
+
+const std::string& BatchRenderer::Error() const
+{
+	return mError;
+}
+
+float BatchRenderer::PowerAt(int frame) const
+{
+	if (mOptions.Path)
+		return mOptions.Path->Evaluate(PathTime(frame)).Power;
+
+	double t = mOptions.FrameCount > 1 ? (double)frame / (mOptions.FrameCount - 1) : 0.0;
+	return (float)Lerp(mOptions.PowerStart, mOptions.PowerEnd, t);
+}
+
+CpuCamera BatchRenderer::CameraAt(int frame) const
+{
+	if (mOptions.Path)
+		return mOptions.Path->CameraAt(PathTime(frame));
+
+	double t = mOptions.FrameCount > 1 ? (double)frame / (mOptions.FrameCount - 1) : 0.0;
+	const CpuCamera& a = mOptions.CameraStart;
+	const CpuCamera& b = mOptions.CameraEnd;
+
+	CpuCamera camera = a;
+	camera.Position = a.Position + (b.Position - a.Position) * t;
+	camera.Theta = Lerp(a.Theta, b.Theta, t);
+	camera.Phi = Lerp(a.Phi, b.Phi, t);
+	camera.FovY = Lerp(a.FovY, b.FovY, t);
+	return camera;
+}
+
+double BatchRenderer::PathTime(int frame) const
+{
+	return mOptions.Path->Keys().front().Time + (double)frame / std::max(mOptions.Fps, 1);
+}
+
+bool BatchRenderer::Run()
+{
+	mStats = BatchStats();
+	mError.clear();
+
+	const bool stream = mOptions.Format != BatchFormat::Ppm;
+	std::vector<bool> done((std::size_t)mOptions.FrameCount, false);
+	std::unique_ptr<Checkpoint> checkpoint;
+	std::uint64_t resumeBytes = 0;
+
+	if (mOptions.Resumable)
+	{
+		std::error_code error;
+		if (stream && (mOptions.Output == "-" || std::filesystem::is_fifo(mOptions.Output, error)))
+		{
+			mError = "cannot resume a stream written to a pipe";
+			return false;
+		}
+
+		checkpoint.reset(new Checkpoint(CheckpointPath(), Signature(), mOptions.CheckpointSeconds));
+		if (checkpoint->Load())
+			resumeBytes = VerifyFrames(*checkpoint, done);
+		else
+			checkpoint->Discard();
+	}
+
+	mStats.Resumed = (int)std::count(done.begin(), done.end(), true);
+
+	// Lives until the stream is drained, since a spliced pipe references it.
+	char streamHeader[128];
+
+	if (stream && resumeBytes > 0)
+	{
+		if (!mStream.Reopen(mOptions.Output, resumeBytes))
+		{
+			mError = "cannot reopen " + mOptions.Output;
+			return false;
+		}
+	}
+	else if (stream)
+	{
+		if (!mStream.Open(mOptions.Output))
+		{
+			mError = "cannot open " + mOptions.Output;
+			return false;
+		}
+
+		int size = StreamHeader(streamHeader, sizeof(streamHeader));
+		OutputSpan span = { streamHeader, (std::size_t)size };
+		if (size > 0 && !mStream.Write(&span, 1))
+		{
+			mError = "write failed";
+			return false;
+		}
+	}
+
+	// Every stage holds one slot while working and depth slots may wait between two
+	// stages. When the writer splices into a pipe it also keeps slots until the pipe
+	// can no longer reference them; running out of slots is what throttles the renderer.
+	const std::size_t depth = (std::size_t)mOptions.QueueDepth;
+	const std::size_t retainBytes = mStream.RetainBytes();
+	const std::size_t retainFrames = retainBytes > 0 ? retainBytes / std::max<std::size_t>(FrameBytes(), 1) + 2 : 0;
+	const std::size_t ringSize = depth * 2 + 3 + retainFrames;
+
+	FrameRing<Frame> ring((int)ringSize, StageCount);
+	for (Frame& frame : ring.Slots())
+		frame.Target.Resize(mOptions.Width, mOptions.Height);
+
+	Clock::time_point start = Clock::now();
+
+	std::thread converter([&]
+	{
+		TRACE_THREAD_NAME("Batch convert");
+		for (std::uint32_t slot = 0; ring.Begin(ConvertStage, slot); ++slot)
+		{
+			Clock::time_point work = Clock::now();
+			ConvertFrame(ring.Slot(slot));
+			mStats.Convert.BusyMs += ElapsedMs(work);
+			ring.End(ConvertStage, slot);
+		}
+	});
+
+	std::thread writer([&]
+	{
+		TRACE_THREAD_NAME("Batch write");
+		std::deque<std::uint32_t> retained;
+		bool ok = true;
+
+		for (std::uint32_t slot = 0; ring.Begin(WriteStage, slot); ++slot)
+		{
+			Frame& frame = ring.Slot(slot);
+
+			// After a failure keep draining what was already rendered.
+			Clock::time_point work = Clock::now();
+			if (ok)
+				ok = WriteFrame(frame);
+			frame.StreamEnd = mStream.BytesWritten();
+
+			// Listed only once written, so a frame cut short by a crash is rendered again.
+			if (ok && checkpoint)
+			{
+				Clock::time_point save = Clock::now();
+				std::uint64_t checksum = Fnv1aSeed;
+				for (int i = 0; i < frame.SpanCount; ++i)
+					checksum = Fnv1a(frame.Spans[i].Data, frame.Spans[i].Size, checksum);
+				checkpoint->Add(frame.Index, checksum);
+				if (!checkpoint->Update())
+				{
+					mError = "cannot write " + checkpoint->Path();
+					ok = false;
+				}
+				mStats.CheckpointMs += ElapsedMs(save);
+			}
+			mStats.Write.BusyMs += ElapsedMs(work);
+
+			// Stops the renderer at the first error instead of rendering frames for nothing.
+			if (!ok)
+				ring.Close();
+
+			if (!ok || mStream.RetainBytes() == 0)
+			{
+				ring.End(WriteStage, slot);
+				continue;
+			}
+
+			// Once a full pipe's worth of data follows a frame, the reader has consumed it
+			// and its slot may be rendered into again.
+			retained.push_back(slot);
+			while (!retained.empty() && ring.Slot(retained.front()).StreamEnd + mStream.RetainBytes() <= mStream.BytesWritten())
+			{
+				ring.End(WriteStage, retained.front());
+				retained.pop_front();
+			}
+		}
+
+		Clock::time_point work = Clock::now();
+		if (ok)
+			mStream.Drain();
+		mStats.Write.BusyMs += ElapsedMs(work);
+	});
+
+	{
+		CpuRenderer renderer(mOptions.Threads);
+		RenderSettings settings = mOptions.Settings;
+
+		FrameStats* stats = mOptions.Stats.get();
+		int renderStage = stats != nullptr ? stats->Stage("render") : -1;
+
+		std::uint32_t slot = 0;
+		for (int i = 0; i < mOptions.FrameCount; ++i)
+		{
+			if (done[i])
+				continue;
+			if (mOptions.MaxFrames > 0 && mStats.Frames >= mOptions.MaxFrames)
+				break;
+			if (!ring.Begin(RenderStage, slot))
+				break;
+			++mStats.Frames;
+
+			Frame& frame = ring.Slot(slot);
+			Clock::time_point work = Clock::now();
+			settings.March.Fractal.Power = PowerAt(i);
+			frame.Index = i;
+			if (stats != nullptr)
+				stats->BeginFrame();
+			renderer.Render(CameraAt(i), settings, frame.Target);
+			double renderMs = ElapsedMs(work);
+			mStats.Render.BusyMs += renderMs;
+
+			if (stats != nullptr)
+			{
+				stats->AddStageTime(renderStage, renderMs);
+				stats->AddRays(renderer.LastStats().Rays);
+				stats->AddDistanceEvaluations(renderer.LastStats().DistanceEvaluations);
+				stats->EndFrame();
+			}
+
+			ring.End(RenderStage, slot++);
+		}
+
+		// The later stages finish the frames already rendered, then stop.
+		ring.Close();
+	}
+
+	converter.join();
+	writer.join();
+
+	mStats.Render.StallMs = ring.Stats(RenderStage).StallMs;
+	mStats.Convert.StallMs = ring.Stats(ConvertStage).StallMs;
+	mStats.Write.StallMs = ring.Stats(WriteStage).StallMs;
+
+	if (stream)
+	{
+		mStats.BytesWritten = mStream.BytesWritten();
+		if (!mStream.Close() && mError.empty())
+			mError = "write failed";
+	}
+
+	if (checkpoint)
+	{
+		// Save and Update time is already counted with the writer's checksums.
+		double savedMs = checkpoint->SaveMs();
+		if (Finished())
+			checkpoint->Discard();
+		else if (!checkpoint->Save() && mError.empty())
+			mError = "cannot write " + checkpoint->Path();
+		mStats.CheckpointMs += checkpoint->SaveMs() - savedMs;
+	}
+
+	mStats.TotalMs = ElapsedMs(start);
+	return mError.empty();
+}
+
+bool BatchRenderer::Finished() const
+{
+	return mError.empty() && mStats.Frames + mStats.Resumed == mOptions.FrameCount;
+}
+
+std::string BatchRenderer::CheckpointPath() const
+{
+	// A numbered pattern is not a file name; strip its number format.
+	std::string path = mOptions.Output;
+	if (mOptions.Format == BatchFormat::Ppm)
+	{
+		std::size_t percent = path.find('%');
+		std::size_t end = path.find('d', percent);
+		if (percent != std::string::npos && end != std::string::npos)
+			path.erase(percent, end - percent + 1);
+	}
+	return path + ".checkpoint";
+}
+
+int BatchRenderer::StreamHeader(char* header, std::size_t size) const
+{
+	if (mOptions.Format != BatchFormat::Y4m)
+		return 0;
+	return std::snprintf(header, size, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", mOptions.Width, mOptions.Height, std::max(mOptions.Fps, 1));
+}
+
+std::string BatchRenderer::FramePath(int frame) const
+{
+	char path[1024];
+	std::snprintf(path, sizeof(path), mOptions.Output.c_str(), frame);
+	return path;
+}
+
+std::string BatchRenderer::Signature() const
+{
+	char buffer[256];
+	std::snprintf(buffer, sizeof(buffer), "batch %dx%d format %d frames %d fps %d power %.9g %.9g ",
+		mOptions.Width, mOptions.Height, (int)mOptions.Format, mOptions.FrameCount, mOptions.Fps, mOptions.PowerStart, mOptions.PowerEnd);
+	std::string signature = buffer + CameraSignature(mOptions.CameraStart) + " " + CameraSignature(mOptions.CameraEnd);
+
+	if (mOptions.Path)
+	{
+		std::uint64_t path = Fnv1aSeed;
+		for (const CameraKey& key : mOptions.Path->Keys())
+		{
+			int size = std::snprintf(buffer, sizeof(buffer), "%.17g %.17g %.17g %.17g %.17g %.17g %.9g",
+				key.Time, key.Position.x, key.Position.y, key.Position.z, key.Theta, key.Phi, key.Power);
+			path = Fnv1a(buffer, (std::size_t)size, path);
+		}
+		std::snprintf(buffer, sizeof(buffer), " path %016llx", (unsigned long long)path);
+		signature += buffer;
+	}
+
+	return signature + " " + SettingsSignature(mOptions.Settings);
+}
+
+std::uint64_t BatchRenderer::VerifyFrames(Checkpoint& checkpoint, std::vector<bool>& done)
+{
+	std::vector<int> damaged;
+	std::uint64_t resumeBytes = 0;
+	std::string bytes;
+
+	if (mOptions.Format == BatchFormat::Ppm)
+	{
+		for (const auto& item : checkpoint.Items())
+		{
+			std::ifstream file(FramePath(item.first), std::ios::binary);
+			bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+			if (item.first >= 0 && item.first < mOptions.FrameCount && Fnv1a(bytes.data(), bytes.size()) == item.second)
+				done[item.first] = true;
+			else
+				damaged.push_back(item.first);
+		}
+	}
+	else
+	{
+		// Frames have a fixed size, so frame i starts at a known offset. Everything
+		// after the first frame that fails is dropped and rendered again.
+		char header[128];
+		int headerSize = StreamHeader(header, sizeof(header));
+		std::size_t frameSize = FrameBytes() + (mOptions.Format == BatchFormat::Y4m ? 6 : 0);
+
+		std::ifstream file(mOptions.Output, std::ios::binary);
+		bytes.resize(std::max<std::size_t>(frameSize, (std::size_t)headerSize));
+		bool valid = file.read(&bytes[0], headerSize) && bytes.compare(0, headerSize, header, headerSize) == 0;
+
+		int frames = 0;
+		for (const auto& item : checkpoint.Items())
+		{
+			valid = valid && item.first == frames && frames < mOptions.FrameCount && file.read(&bytes[0], frameSize)
+				&& Fnv1a(bytes.data(), frameSize) == item.second;
+			if (valid)
+				done[frames++] = true;
+			else
+				damaged.push_back(item.first);
+		}
+
+		if (frames > 0)
+			resumeBytes = (std::uint64_t)headerSize + (std::uint64_t)frames * frameSize;
+	}
+
+	for (int index : damaged)
+		checkpoint.Remove(index);
+	mStats.Damaged = (int)damaged.size();
+	return resumeBytes;
+}
+
+std::size_t BatchRenderer::FrameBytes() const
+{
+	const std::size_t pixels = (std::size_t)mOptions.Width * mOptions.Height;
+	const std::size_t chroma = (std::size_t)((mOptions.Width + 1) / 2) * ((mOptions.Height + 1) / 2);
+
+	switch (mOptions.Format)
+	{
+	case BatchFormat::RawRgba: return pixels * 4;
+	case BatchFormat::Ppm: return pixels * 3;
+	default: return pixels + chroma * 2;
+	}
+}
+
+void BatchRenderer::ConvertFrame(Frame& frame) const
+{
+	TRACE_SCOPE("Convert frame");
+
+	const CpuFramebuffer& source = frame.Target;
+	const std::size_t pixels = (std::size_t)source.Width * source.Height;
+
+	frame.SpanCount = 0;
+
+	switch (mOptions.Format)
+	{
+	case BatchFormat::RawRgba:
+		// The framebuffer already is the output.
+		frame.Spans[frame.SpanCount++] = { source.Color.data(), pixels * 4 };
+		return;
+
+	case BatchFormat::Ppm:
+	{
+		int headerSize = std::snprintf(frame.Header, sizeof(frame.Header), "P6\n%d %d\n255\n", source.Width, source.Height);
+
+		frame.Bytes.resize(pixels * 3);
+		std::uint8_t* out = frame.Bytes.data();
+		for (std::size_t i = 0; i < pixels; ++i)
+		{
+			std::uint32_t c = source.Color[i];
+			out[i * 3 + 0] = (std::uint8_t)(c & 0xff);
+			out[i * 3 + 1] = (std::uint8_t)((c >> 8) & 0xff);
+			out[i * 3 + 2] = (std::uint8_t)((c >> 16) & 0xff);
+		}
+
+		frame.Spans[frame.SpanCount++] = { frame.Header, (std::size_t)headerSize };
+		frame.Spans[frame.SpanCount++] = { frame.Bytes.data(), frame.Bytes.size() };
+		return;
+	}
+
+	default:
+		break;
+	}
+
+	if (mOptions.Format == BatchFormat::Y4m)
+		frame.Spans[frame.SpanCount++] = { "FRAME\n", 6 };
+
+	frame.Bytes.resize(FrameBytes());
+	ConvertI420(source, frame.Bytes.data());
+	frame.Spans[frame.SpanCount++] = { frame.Bytes.data(), frame.Bytes.size() };
+}
+
+bool BatchRenderer::WriteFrame(const Frame& frame)
+{
+	TRACE_SCOPE("Write frame");
+
+	if (mOptions.Format != BatchFormat::Ppm)
+	{
+		if (mStream.Write(frame.Spans, frame.SpanCount))
+			return true;
+
+		mError = "write failed";
+		return false;
+	}
+
+	std::string path = FramePath(frame.Index);
+
+	StreamWriter file;
+	if (!file.Open(path))
+	{
+		mError = "cannot open " + path;
+		return false;
+	}
+
+	if (!file.Write(frame.Spans, frame.SpanCount) || !file.Close())
+	{
+		mError = "write failed: " + path;
+		return false;
+	}
+
+	mStats.BytesWritten += file.BytesWritten();
+	return true;
+}
+
+int BatchRenderer::RunDefault(const BatchOptions& options)
+{
+	BatchRenderer batch(options);
+	bool ok = batch.Run();
+
+	// Stats go to stderr so a stream on stdout stays clean.
+	const BatchStats& stats = batch.Stats();
+	std::fprintf(stderr, "%d frames in %.1f ms (%.2f fps), %.1f MB written\n",
+		stats.Frames, stats.TotalMs, stats.Frames * 1000.0 / std::max(stats.TotalMs, 1e-3), stats.BytesWritten / 1e6);
+	std::fprintf(stderr, "%-10s %12s %12s\n", "stage", "busy ms", "stall ms");
+	std::fprintf(stderr, "%-10s %12.1f %12.1f\n", "render", stats.Render.BusyMs, stats.Render.StallMs);
+	std::fprintf(stderr, "%-10s %12.1f %12.1f\n", "convert", stats.Convert.BusyMs, stats.Convert.StallMs);
+	std::fprintf(stderr, "%-10s %12.1f %12.1f\n", "write", stats.Write.BusyMs, stats.Write.StallMs);
+
+	if (options.Resumable)
+	{
+		if (stats.Resumed > 0)
+			std::fprintf(stderr, "%d frames kept from the checkpoint\n", stats.Resumed);
+		if (stats.Damaged > 0)
+			std::fprintf(stderr, "%d checkpointed frames failed their checksum and were rendered again\n", stats.Damaged);
+		std::fprintf(stderr, "checkpoints took %.1f ms (%.2f%% of the run)\n", stats.CheckpointMs, 100.0 * stats.CheckpointMs / std::max(stats.TotalMs, 1e-3));
+	}
+
+	if (!ok)
+	{
+		std::fprintf(stderr, "batch failed: %s\n", batch.Error().c_str());
+		return 1;
+	}
+
+	if (options.Resumable && !batch.Finished())
+		std::fprintf(stderr, "%d frames left; run the same command again to continue\n", options.FrameCount - stats.Frames - stats.Resumed);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,866 @@
+#include "Benchmark.h"
+#include "CameraPath.h"
+#include "CpuPipeline.h"
+#include "CpuRenderer.h"
+#include "Random.h"
+#include "RingAllocator.h"
+#include "SimdMath.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+namespace
+{
+	// Shared state for the renderer cases so every case reuses one worker pool.
+	struct RenderFixture
+	{
+		explicit RenderFixture(const BenchmarkOptions& options) :
+			Renderer(options.Threads)
+		{
+			Target.Resize(options.Width, options.Height);
+		}
+
+		CpuRenderer Renderer;
+		CpuFramebuffer Target;
+	};
+
+	// Returns the point where the default camera's centre ray meets the surface.
+	Vec3d FindSurfacePoint(const CpuCamera& camera, const MarchParams& march)
+	{
+		MarchParams params = march;
+		params.Epsilon = 1e-15f;
+		params.MaxSteps = 100000;
+
+		Vec3d direction = Normalize(camera.Forward());
+		MarchResult hit = March(camera.Position, direction, params);
+		return camera.Position + direction * hit.Distance;
+	}
+
+	// Sample points on a grid through the fractal's bounding box, stored SoA for the packet kernels.
+	struct SamplePoints
+	{
+		std::vector<float> X, Y, Z;
+
+		explicit SamplePoints(int resolution)
+		{
+			for (int k = 0; k < resolution; ++k)
+				for (int j = 0; j < resolution; ++j)
+					for (int i = 0; i < resolution; ++i)
+					{
+						X.push_back(-1.5f + 3.0f * i / (resolution - 1));
+						Y.push_back(-1.5f + 3.0f * j / (resolution - 1));
+						Z.push_back(-1.5f + 3.0f * k / (resolution - 1));
+					}
+		}
+
+		std::size_t Count() const { return X.size(); }
+	};
+
+	// Keeps results observable so the optimizer cannot drop the kernels.
+	volatile float gBenchmarkSink = 0.0f;
+
+	template<typename F>
+	void AddFormulaCases(Benchmark& bench, FractalFormula formula, const std::shared_ptr<SamplePoints>& points, const std::shared_ptr<RenderFixture>& fixture)
+	{
+		const FractalParams params = FractalParams::Defaults(formula);
+		const std::string prefix = std::string("formula/") + FormulaName(formula);
+
+		bench.Add(prefix + "/scalar", [points, params](std::string& note)
+		{
+			float sum = 0.0f;
+			int iterations = 0;
+			for (std::size_t i = 0; i < points->Count(); ++i)
+				sum += F::Distance(Vec3f(points->X[i], points->Y[i], points->Z[i]), params, iterations);
+			gBenchmarkSink = sum;
+			return (std::uint64_t)points->Count();
+		});
+
+		bench.Add(prefix + "/packet", [points, params](std::string& note)
+		{
+			const int N = 8;
+			float distance[N];
+			int iterations[N];
+			float sum = 0.0f;
+			for (std::size_t i = 0; i + N <= points->Count(); i += N)
+			{
+				F::template DistancePacket<float, N>(&points->X[i], &points->Y[i], &points->Z[i], params, distance, iterations);
+				sum += distance[0];
+			}
+			gBenchmarkSink = sum;
+			return (std::uint64_t)points->Count();
+		});
+
+		bench.Add(prefix + "/render", [fixture, params](std::string& note)
+		{
+			RenderSettings settings;
+			settings.Precision = PrecisionMode::Float;
+			settings.March.Fractal = params;
+
+			fixture->Renderer.Render(CpuCamera(), settings, fixture->Target);
+			return (std::uint64_t)fixture->Target.Width * fixture->Target.Height;
+		});
+	}
+
+	// Reference for the hybrids: picks the step through a function pointer on every iteration.
+	typedef void (*StepFunction)(FormulaState<float>&, const Vec3f&, const FractalParams&);
+
+	float DistanceWithDispatch(const Vec3f& position, const FractalParams& params, const StepFunction* steps, int& iterations)
+	{
+		FormulaState<float> s;
+		Mandelbulb::Init(s, position, params);
+		iterations = 0;
+
+		for (int i = 0; i < params.MaxIterations; i++)
+		{
+			++iterations;
+			s.r = sqrtf(s.x * s.x + s.y * s.y + s.z * s.z);
+			if (s.r > params.Bailout) break;
+			steps[i](s, position, params);
+		}
+
+		return Mandelbox::Estimate(s, params);
+	}
+
+	void AddHybridCases(Benchmark& bench, const std::shared_ptr<SamplePoints>& points, const std::shared_ptr<RenderFixture>& fixture)
+	{
+		const HybridPattern patterns[] = { HybridPattern::Alternate, HybridPattern::Prefix };
+
+		for (HybridPattern pattern : patterns)
+		{
+			FractalParams params = FractalParams::Defaults(FractalFormula::Mandelbulb);
+			params.Hybrid = pattern;
+			params.HybridSecond = FractalFormula::Mandelbox;
+			params.HybridPrefixIterations = 2;
+			params.MaxIterations = 12;
+			params.Bailout = 4.0f;
+
+			const std::string prefix = std::string("hybrid/mandelbulb+mandelbox/") + HybridPatternName(pattern);
+
+			bench.Add(prefix + "/scalar", [points, params](std::string& note)
+			{
+				float sum = 0.0f;
+				int iterations = 0;
+				for (std::size_t i = 0; i < points->Count(); ++i)
+					sum += DistanceEstimate(Vec3f(points->X[i], points->Y[i], points->Z[i]), params, iterations);
+				gBenchmarkSink = sum;
+				return (std::uint64_t)points->Count();
+			});
+
+			bench.Add(prefix + "/packet", [points, params](std::string& note)
+			{
+				const int N = 8;
+				float distance[N];
+				int iterations[N];
+				float sum = 0.0f;
+				VisitFormula(params, [&](auto tag)
+				{
+					typedef typename decltype(tag)::Type F;
+					for (std::size_t i = 0; i + N <= points->Count(); i += N)
+					{
+						F::template DistancePacket<float, N>(&points->X[i], &points->Y[i], &points->Z[i], params, distance, iterations);
+						sum += distance[0];
+					}
+					return 0;
+				});
+				gBenchmarkSink = sum;
+				return (std::uint64_t)points->Count();
+			});
+
+			bench.Add(prefix + "/per-iteration-dispatch", [points, params](std::string& note)
+			{
+				StepFunction steps[64];
+				for (int i = 0; i < params.MaxIterations && i < 64; ++i)
+				{
+					bool first = params.Hybrid == HybridPattern::Alternate ? (i & 1) == 0 : i < params.HybridPrefixIterations;
+					steps[i] = first ? &Mandelbulb::Step<float> : &Mandelbox::Step<float>;
+				}
+
+				float sum = 0.0f;
+				int iterations = 0;
+				for (std::size_t i = 0; i < points->Count(); ++i)
+					sum += DistanceWithDispatch(Vec3f(points->X[i], points->Y[i], points->Z[i]), params, steps, iterations);
+				gBenchmarkSink = sum;
+				return (std::uint64_t)points->Count();
+			});
+
+			bench.Add(prefix + "/render", [fixture, params](std::string& note)
+			{
+				RenderSettings settings;
+				settings.Precision = PrecisionMode::Float;
+				settings.March.Fractal = params;
+
+				fixture->Renderer.Render(CpuCamera(), settings, fixture->Target);
+				return (std::uint64_t)fixture->Target.Width * fixture->Target.Height;
+			});
+		}
+	}
+
+	// Renders every frame of the given camera path, so runs of the same path are comparable.
+	void AddPathCases(Benchmark& bench, const std::shared_ptr<RenderFixture>& fixture)
+	{
+		std::shared_ptr<const CameraPath> path = bench.Options().Path;
+		if (!path || path->Empty())
+			return;
+
+		const int fps = std::max(bench.Options().PathFps, 1);
+		const int frames = (int)(path->Duration() * fps) + 1;
+
+		bench.Add("path/replay", [fixture, path, fps, frames](std::string& note)
+		{
+			RenderSettings settings;
+			double start = path->Keys().front().Time;
+
+			for (int i = 0; i < frames; ++i)
+			{
+				double time = start + (double)i / fps;
+				settings.March.Fractal.Power = path->Evaluate(time).Power;
+				fixture->Renderer.Render(path->CameraAt(time), settings, fixture->Target);
+			}
+
+			char buffer[64];
+			std::snprintf(buffer, sizeof(buffer), "%d frames", frames);
+			note = buffer;
+			return (std::uint64_t)frames * fixture->Target.Width * fixture->Target.Height;
+		});
+	}
+
+	// Update, render and present overlapped over 1..3 frame resources. Present converts
+	// to RGB and then waits 2 ms, standing in for display or I/O latency.
+	void AddPipelineCases(Benchmark& bench)
+	{
+		const BenchmarkOptions& options = bench.Options();
+
+		for (int depth = 1; depth <= 3; ++depth)
+		{
+			auto pipeline = std::make_shared<CpuPipeline>(depth, options.Width, options.Height, options.Threads);
+
+			bench.Add("pipeline/depth-" + std::to_string(depth), [pipeline](std::string& note)
+			{
+				const int frames = 16;
+				std::vector<std::uint8_t> rgb;
+
+				CpuPipelineStats stats = pipeline->Run(frames,
+					[](CpuFrameResource& frame)
+					{
+						frame.Camera = CpuCamera();
+						frame.Camera.Theta += 0.01 * frame.Frame;
+						frame.Settings.March.Fractal.Power = 8.0f + 0.05f * frame.Frame;
+						return true;
+					},
+					[&rgb](const CpuFrameResource& frame)
+					{
+						const std::vector<std::uint32_t>& color = frame.Target.Color;
+						rgb.resize(color.size() * 3);
+						for (std::size_t i = 0; i < color.size(); ++i)
+						{
+							rgb[i * 3 + 0] = (std::uint8_t)(color[i] & 0xff);
+							rgb[i * 3 + 1] = (std::uint8_t)((color[i] >> 8) & 0xff);
+							rgb[i * 3 + 2] = (std::uint8_t)((color[i] >> 16) & 0xff);
+						}
+						std::this_thread::sleep_for(std::chrono::milliseconds(2));
+					});
+
+				char buffer[128];
+				std::snprintf(buffer, sizeof(buffer), "in flight %.2f, render stall %.1f ms, present stall %.1f ms",
+					stats.AverageInFlight, stats.Render.StallMs, stats.Present.StallMs);
+				note = buffer;
+				return (std::uint64_t)stats.Frames;
+			});
+		}
+	}
+
+	// Per-frame constants plus a varying number of transient blocks, bump allocated from
+	// a host-memory ring with the frame fence completing `depth` frames later.
+	void AddRingAllocatorCases(Benchmark& bench)
+	{
+		const int depths[] = { 1, 3 };
+		for (int depth : depths)
+		{
+			bench.Add("ring/frames-in-flight-" + std::to_string(depth), [depth](std::string& note)
+			{
+				const int frames = 1000;
+				HostMemoryBackend memory(64 * 1024 * depth);
+				LinearRingAllocator allocator(memory);
+
+				std::uint32_t seed = 1;
+				std::uint64_t allocations = 0;
+				for (int frame = 1; frame <= frames; ++frame)
+				{
+					allocator.Reclaim(frame > depth ? frame - depth : 0);
+
+					allocations += allocator.Allocate(304) ? 1 : 0;
+					int transient = 4 + frame % 13;
+					for (int i = 0; i < transient; ++i)
+					{
+						seed = seed * 1664525u + 1013904223u;
+						std::size_t size = 16 + (seed >> 16) % 2048;
+						RingAllocation block = allocator.Allocate(size, i % 2 == 0 ? 256 : 16);
+						if (block)
+						{
+							block.Cpu[0] = (std::uint8_t)i;
+							++allocations;
+						}
+					}
+
+					allocator.EndFrame(frame);
+				}
+
+				const RingAllocatorStats& stats = allocator.Stats();
+				char buffer[128];
+				std::snprintf(buffer, sizeof(buffer), "%.1f allocs/frame, %.1f KB/frame, fragmentation %.1f%%, peak %.0f%%, %llu failed",
+					stats.AllocationsPerFrame(), stats.BytesPerFrame() / 1024.0, stats.Fragmentation() * 100.0,
+					100.0 * stats.PeakUsed / allocator.Capacity(), (unsigned long long)stats.Failures);
+				note = buffer;
+				return allocations;
+			});
+		}
+	}
+
+	// Matrix microbenchmarks over a batch of distinct camera matrices, shaped like
+	// the per-frame work in UpdateMainPassCB.
+	void AddMathCases(Benchmark& bench)
+	{
+		const int count = 4096;
+		auto views = std::make_shared<std::vector<Simd::Matrix>>();
+		for (int i = 0; i < count; ++i)
+		{
+			float angle = 0.001f * i;
+			Simd::Vector eye = Simd::VectorSet(3.0f * std::cos(angle), 0.5f, 3.0f * std::sin(angle), 1.0f);
+			views->push_back(Simd::MatrixLookAtLH(eye, Simd::VectorZero(), Simd::VectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		}
+		const Simd::Matrix proj = Simd::MatrixPerspectiveFovLH(0.785398f, 16.0f / 9.0f, 1.0f, 1000.0f);
+
+		bench.Add("math/multiply", [views, proj](std::string& note)
+		{
+			Simd::Vector sum = Simd::VectorZero();
+			for (const Simd::Matrix& view : *views)
+				sum = sum + (view * proj).r[3];
+			gBenchmarkSink = Simd::VectorGetX(sum);
+			return (std::uint64_t)views->size();
+		});
+
+		bench.Add("math/inverse", [views](std::string& note)
+		{
+			Simd::Vector sum = Simd::VectorZero();
+			for (const Simd::Matrix& view : *views)
+				sum = sum + Simd::MatrixInverse(nullptr, view).r[3];
+			gBenchmarkSink = Simd::VectorGetX(sum);
+			return (std::uint64_t)views->size();
+		});
+
+		bench.Add("math/transpose", [views](std::string& note)
+		{
+			Simd::Vector sum = Simd::VectorZero();
+			for (const Simd::Matrix& view : *views)
+				sum = sum + Simd::MatrixTranspose(view).r[3];
+			gBenchmarkSink = Simd::VectorGetX(sum);
+			return (std::uint64_t)views->size();
+		});
+
+		bench.Add("math/pass-constants", [proj](std::string& note)
+		{
+			Simd::Float4x4 out;
+			float sum = 0.0f;
+			for (int i = 0; i < count; ++i)
+			{
+				Simd::Vector eye = Simd::VectorSet(3.0f, 0.001f * i, -3.0f, 1.0f);
+				Simd::Matrix view = Simd::MatrixLookAtLH(eye, Simd::VectorZero(), Simd::VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+				Simd::Matrix worldView = Simd::MatrixTranspose(view);
+				Simd::StoreFloat4x4(&out, Simd::MatrixInverse(nullptr, worldView));
+				Simd::StoreFloat4x4(&out, Simd::MatrixTranspose(view * proj));
+				sum += out.m[3][2];
+			}
+			gBenchmarkSink = sum;
+
+#if defined(SIMD_MATH_FMA)
+			note = "SSE+FMA";
+#elif defined(SIMD_MATH_SSE)
+			note = "SSE";
+#else
+			note = "scalar";
+#endif
+			return (std::uint64_t)count;
+		});
+	}
+
+	// Batch generation against rand() and the rejection sampling MathHelper used before.
+	void AddRandomCases(Benchmark& bench)
+	{
+		const int count = 1 << 16;
+		auto x = std::make_shared<std::vector<float>>(count);
+		auto y = std::make_shared<std::vector<float>>(count);
+		auto z = std::make_shared<std::vector<float>>(count);
+
+		bench.Add("random/rand-floats", [x](std::string& note)
+		{
+			for (float& f : *x)
+				f = (float)std::rand() / (float)RAND_MAX;
+			gBenchmarkSink = (*x)[count - 1];
+			return (std::uint64_t)count;
+		});
+
+		bench.Add("random/philox-floats", [x](std::string& note)
+		{
+			RandomStream stream(1);
+			stream.Floats(x->data(), count);
+			gBenchmarkSink = (*x)[count - 1];
+			return (std::uint64_t)count;
+		});
+
+		bench.Add("random/rejection-unit-vectors", [x, y, z](std::string& note)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				float vx, vy, vz, lengthSq;
+				do
+				{
+					vx = 2.0f * std::rand() / (float)RAND_MAX - 1.0f;
+					vy = 2.0f * std::rand() / (float)RAND_MAX - 1.0f;
+					vz = 2.0f * std::rand() / (float)RAND_MAX - 1.0f;
+					lengthSq = vx * vx + vy * vy + vz * vz;
+				} while (lengthSq > 1.0f || lengthSq == 0.0f);
+
+				float inv = 1.0f / std::sqrt(lengthSq);
+				(*x)[i] = vx * inv;
+				(*y)[i] = vy * inv;
+				(*z)[i] = vz * inv;
+			}
+			gBenchmarkSink = (*x)[count - 1];
+			return (std::uint64_t)count;
+		});
+
+		bench.Add("random/unit-vectors", [x, y, z](std::string& note)
+		{
+			RandomStream stream(1);
+			stream.UnitVectors(x->data(), y->data(), z->data(), count);
+			gBenchmarkSink = (*x)[count - 1];
+			return (std::uint64_t)count;
+		});
+
+		bench.Add("random/cosine-hemisphere", [x, y, z](std::string& note)
+		{
+			RandomStream stream(1);
+			stream.CosineHemisphereVectors(0.0f, 1.0f, 0.0f, x->data(), y->data(), z->data(), count);
+			gBenchmarkSink = (*x)[count - 1];
+			return (std::uint64_t)count;
+		});
+
+		bench.Add("random/sobol", [x, y](std::string& note)
+		{
+			for (int i = 0; i < count; ++i)
+				Random::Sobol2((std::uint32_t)i, 0x9E3779B9u, (*x)[i], (*y)[i]);
+			gBenchmarkSink = (*x)[count - 1];
+			return (std::uint64_t)count;
+		});
+	}
+
+	// Adaptive against uniform supersampling. The note gives rays per pixel and the
+	// RMS colour error against 16 rays per pixel everywhere, so modes of equal error
+	// can be compared by time.
+	void AddAntiAliasCases(Benchmark& bench, const std::shared_ptr<RenderFixture>& fixture)
+	{
+		struct Mode
+		{
+			const char* Name;
+			bool Enabled;
+			bool Uniform;
+			int Samples;
+		};
+		const Mode modes[] =
+		{
+			{ "aa/none", false, false, 0 },
+			{ "aa/adaptive-4", true, false, 4 },
+			{ "aa/adaptive-8", true, false, 8 },
+			{ "aa/uniform-4x", true, true, 3 },
+			{ "aa/uniform-8x", true, true, 7 },
+		};
+
+		auto reference = std::make_shared<CpuFramebuffer>();
+
+		for (const Mode& mode : modes)
+		{
+			bench.Add(mode.Name, [fixture, reference, mode](std::string& note)
+			{
+				RenderSettings settings;
+				settings.Precision = PrecisionMode::Float;
+				settings.AntiAlias.Enabled = mode.Enabled;
+				settings.AntiAlias.Uniform = mode.Uniform;
+				settings.AntiAlias.Samples = mode.Samples;
+
+				CpuFramebuffer& target = fixture->Target;
+				if (reference->Width != target.Width || reference->Height != target.Height)
+				{
+					RenderSettings uniform = settings;
+					uniform.AntiAlias.Enabled = true;
+					uniform.AntiAlias.Uniform = true;
+					uniform.AntiAlias.Samples = 15;
+					reference->Resize(target.Width, target.Height);
+					fixture->Renderer.Render(CpuCamera(), uniform, *reference);
+				}
+
+				fixture->Renderer.Render(CpuCamera(), settings, target);
+
+				double error = 0.0;
+				for (std::size_t i = 0; i < target.Color.size(); ++i)
+				{
+					for (int c = 0; c < 3; ++c)
+					{
+						double d = (double)((target.Color[i] >> (8 * c)) & 0xFF) - (double)((reference->Color[i] >> (8 * c)) & 0xFF);
+						error += d * d;
+					}
+				}
+				std::size_t pixels = target.Color.size();
+				error = std::sqrt(error / (3.0 * pixels)) / 255.0;
+
+				CpuRenderStats stats = fixture->Renderer.LastStats();
+				char buffer[128];
+				std::snprintf(buffer, sizeof(buffer), "%.2f rays/pixel, %.1f%% supersampled, %.0f evals/pixel, rms error %.4f",
+					(double)stats.Rays / pixels, 100.0 * stats.SupersampledPixels / pixels, (double)stats.DistanceEvaluations / pixels, error);
+				note = buffer;
+				return (std::uint64_t)pixels;
+			});
+		}
+	}
+
+	// Reduced-resolution marching against native resolution: the note gives the RMS
+	// colour error against the native image and the share of pixels marched again.
+	void AddUpsampleCases(Benchmark& bench, const std::shared_ptr<RenderFixture>& fixture)
+	{
+		auto native = std::make_shared<CpuFramebuffer>();
+		const int factors[] = { 1, 2, 4 };
+
+		for (int factor : factors)
+		{
+			const char* names[] = { "", "native", "half", "", "quarter" };
+			bench.Add(std::string("upsample/") + names[factor], [fixture, native, factor](std::string& note)
+			{
+				RenderSettings settings;
+				settings.Precision = PrecisionMode::Float;
+				settings.Upsample.Factor = factor;
+
+				CpuFramebuffer& target = fixture->Target;
+				if (native->Width != target.Width || native->Height != target.Height)
+				{
+					native->Resize(target.Width, target.Height);
+					fixture->Renderer.Render(CpuCamera(), RenderSettings(), *native);
+				}
+
+				fixture->Renderer.Render(CpuCamera(), settings, target);
+
+				double error = 0.0;
+				for (std::size_t i = 0; i < target.Color.size(); ++i)
+				{
+					for (int c = 0; c < 3; ++c)
+					{
+						double d = (double)((target.Color[i] >> (8 * c)) & 0xFF) - (double)((native->Color[i] >> (8 * c)) & 0xFF);
+						error += d * d;
+					}
+				}
+				std::size_t pixels = target.Color.size();
+				error = std::sqrt(error / (3.0 * pixels)) / 255.0;
+
+				CpuRenderStats stats = fixture->Renderer.LastStats();
+				char buffer[128];
+				std::snprintf(buffer, sizeof(buffer), "%.2f rays/pixel, %.1f%% remarched, %.0f evals/pixel, rms error %.4f",
+					(double)stats.Rays / pixels, 100.0 * stats.RemarchedPixels / pixels, (double)stats.DistanceEvaluations / pixels, error);
+				note = buffer;
+				return (std::uint64_t)pixels;
+			});
+		}
+	}
+
+	// Lighting passes against the unlit frame: the note gives the extra distance
+	// estimates per pixel, the share of pixels that traced a shadow ray and the
+	// frame time relative to the unlit case.
+	void AddLightingCases(Benchmark& bench, const std::shared_ptr<RenderFixture>& fixture)
+	{
+		struct Mode
+		{
+			const char* Name;
+			bool AmbientOcclusion;
+			bool Shadows;
+		};
+		const Mode modes[] =
+		{
+			{ "light/unlit", false, false },
+			{ "light/ao", true, false },
+			{ "light/shadows", false, true },
+			{ "light/ao+shadows", true, true },
+		};
+
+		auto unlit = std::make_shared<double>(0.0);
+		auto unlitEvaluations = std::make_shared<std::uint64_t>(0);
+
+		for (const Mode& mode : modes)
+		{
+			bench.Add(mode.Name, [fixture, unlit, unlitEvaluations, mode](std::string& note)
+			{
+				typedef std::chrono::steady_clock Clock;
+
+				RenderSettings settings;
+				settings.Precision = PrecisionMode::Float;
+				settings.Lighting.AmbientOcclusion = mode.AmbientOcclusion;
+				settings.Lighting.Shadows = mode.Shadows;
+
+				auto start = Clock::now();
+				fixture->Renderer.Render(CpuCamera(), settings, fixture->Target);
+				double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+				CpuRenderStats stats = fixture->Renderer.LastStats();
+				std::size_t pixels = fixture->Target.Color.size();
+				if (!settings.Lighting.Enabled())
+				{
+					*unlit = ms;
+					*unlitEvaluations = stats.DistanceEvaluations;
+				}
+
+				char buffer[128];
+				std::snprintf(buffer, sizeof(buffer), "%+.1f evals/pixel, %.1f%% shadow rays, %.2fx unlit",
+					((double)stats.DistanceEvaluations - (double)*unlitEvaluations) / pixels,
+					100.0 * stats.ShadowRays / pixels, *unlit > 0.0 ? ms / *unlit : 0.0);
+				note = buffer;
+				return (std::uint64_t)pixels;
+			});
+		}
+	}
+
+	// The scalar kernel against lockstep packets and wavefronts compacted every n steps.
+	// The note gives the share of evaluated lanes that advanced a live ray and checks
+	// the image matches the packet kernel.
+	void AddWavefrontCases(Benchmark& bench, const std::shared_ptr<RenderFixture>& fixture)
+	{
+		struct Mode
+		{
+			const char* Name;
+			PrecisionMode Precision;
+			MarchKernel Kernel;
+			int Steps;
+		};
+		const Mode modes[] =
+		{
+			{ "wavefront/float/packet", PrecisionMode::Float, MarchKernel::Packet, 1 },
+			{ "wavefront/float/scalar", PrecisionMode::Float, MarchKernel::Scalar, 1 },
+			{ "wavefront/float/compact-1", PrecisionMode::Float, MarchKernel::Wavefront, 1 },
+			{ "wavefront/float/compact-4", PrecisionMode::Float, MarchKernel::Wavefront, 4 },
+			{ "wavefront/float/compact-16", PrecisionMode::Float, MarchKernel::Wavefront, 16 },
+			{ "wavefront/double/packet", PrecisionMode::Double, MarchKernel::Packet, 1 },
+			{ "wavefront/double/scalar", PrecisionMode::Double, MarchKernel::Scalar, 1 },
+			{ "wavefront/double/compact-1", PrecisionMode::Double, MarchKernel::Wavefront, 1 },
+		};
+
+		auto packet = std::make_shared<CpuFramebuffer>();
+
+		for (const Mode& mode : modes)
+		{
+			bench.Add(mode.Name, [fixture, packet, mode](std::string& note)
+			{
+				RenderSettings settings;
+				settings.Precision = mode.Precision;
+				settings.Kernel = mode.Kernel;
+				settings.WavefrontSteps = mode.Steps;
+
+				CpuFramebuffer& target = fixture->Target;
+				fixture->Renderer.Render(CpuCamera(), settings, target);
+				if (mode.Kernel == MarchKernel::Packet)
+					*packet = target;
+
+				std::size_t differing = 0;
+				for (std::size_t i = 0; i < target.Color.size() && packet->Color.size() == target.Color.size(); ++i)
+					differing += target.Color[i] != packet->Color[i] || target.Steps[i] != packet->Steps[i] ? 1 : 0;
+
+				CpuRenderStats stats = fixture->Renderer.LastStats();
+				char buffer[128];
+				std::snprintf(buffer, sizeof(buffer), "%.1f%% lanes live, %zu pixels differ from packet",
+					stats.LaneSlots > 0 ? 100.0 * stats.LaneEvaluations / stats.LaneSlots : 0.0, differing);
+				note = buffer;
+				return (std::uint64_t)target.Width * target.Height;
+			});
+		}
+	}
+
+	// Row-major against Morton traversal of tiles and of pixels within tiles, for
+	// the packet and wavefront kernels. The note gives the share of evaluated lanes
+	// that were live.
+	void AddTraversalCases(Benchmark& bench, const std::shared_ptr<RenderFixture>& fixture)
+	{
+		struct Mode
+		{
+			const char* Name;
+			TraversalOrder Order;
+			MarchKernel Kernel;
+			int Upsample;
+		};
+		const Mode modes[] =
+		{
+			{ "order/row/packet", TraversalOrder::RowMajor, MarchKernel::Packet, 1 },
+			{ "order/morton/packet", TraversalOrder::Morton, MarchKernel::Packet, 1 },
+			{ "order/row/wavefront", TraversalOrder::RowMajor, MarchKernel::Wavefront, 1 },
+			{ "order/morton/wavefront", TraversalOrder::Morton, MarchKernel::Wavefront, 1 },
+			{ "order/row/upsample-2", TraversalOrder::RowMajor, MarchKernel::Wavefront, 2 },
+			{ "order/morton/upsample-2", TraversalOrder::Morton, MarchKernel::Wavefront, 2 },
+		};
+
+		for (const Mode& mode : modes)
+		{
+			bench.Add(mode.Name, [fixture, mode](std::string& note)
+			{
+				RenderSettings settings;
+				settings.Precision = PrecisionMode::Float;
+				settings.Order = mode.Order;
+				settings.Kernel = mode.Kernel;
+				settings.Upsample.Factor = mode.Upsample;
+
+				fixture->Renderer.Render(CpuCamera(), settings, fixture->Target);
+
+				CpuRenderStats stats = fixture->Renderer.LastStats();
+				char buffer[64];
+				std::snprintf(buffer, sizeof(buffer), "%.1f%% lanes live", stats.LaneSlots > 0 ? 100.0 * stats.LaneEvaluations / stats.LaneSlots : 0.0);
+				note = buffer;
+				return (std::uint64_t)fixture->Target.Width * fixture->Target.Height;
+			});
+		}
+	}
+
+	void AddPrecisionCases(Benchmark& bench, const std::shared_ptr<RenderFixture>& fixture)
+	{
+		const Precision tiers[] = { Precision::Float, Precision::Double, Precision::DoubleDouble };
+		const PrecisionMode modes[] = { PrecisionMode::Float, PrecisionMode::Double, PrecisionMode::DoubleDouble };
+
+		for (int i = 0; i < 3; ++i)
+		{
+			PrecisionMode mode = modes[i];
+			bench.Add(std::string("precision/") + PrecisionName(tiers[i]), [fixture, mode](std::string& note)
+			{
+				RenderSettings settings;
+				settings.Precision = mode;
+
+				fixture->Renderer.Render(CpuCamera(), settings, fixture->Target);
+				return (std::uint64_t)fixture->Target.Width * fixture->Target.Height;
+			});
+		}
+
+		// Deep zooms: back away from a surface point by ever smaller distances and let Auto pick the tier.
+		const double depths[] = { 1e-2, 1e-5, 1e-8, 1e-11, 1e-14 };
+		const Vec3d surface = FindSurfacePoint(CpuCamera(), MarchParams());
+		for (double depth : depths)
+		{
+			char name[64];
+			std::snprintf(name, sizeof(name), "precision/auto/zoom-%.0e", depth);
+
+			bench.Add(name, [fixture, depth, surface](std::string& note)
+			{
+				RenderSettings settings;
+				settings.Precision = PrecisionMode::Auto;
+				settings.AdaptiveEpsilon = true;
+				settings.March.MaxSteps = 300;
+
+				CpuCamera camera;
+				camera.Position = surface - Normalize(camera.Forward()) * depth;
+
+				fixture->Renderer.Render(camera, settings, fixture->Target);
+				note = PrecisionName(fixture->Renderer.LastPrecision());
+				return (std::uint64_t)fixture->Target.Width * fixture->Target.Height;
+			});
+		}
+	}
+}
+
+Benchmark::Benchmark(const BenchmarkOptions& options) :
+	mOptions(options)
+{
+}
+
+const BenchmarkOptions& Benchmark::Options() const
+{
+	return mOptions;
+}
+
+void Benchmark::Add(const std::string& name, Body body)
+{
+	Case c;
+	c.Name = name;
+	c.Run = body;
+	mCases.push_back(c);
+}
+
+std::vector<BenchmarkResult> Benchmark::Run()
+{
+	typedef std::chrono::steady_clock Clock;
+
+	std::vector<BenchmarkResult> results;
+	for (auto& c : mCases)
+	{
+		if (!mOptions.Filter.empty() && c.Name.find(mOptions.Filter) == std::string::npos)
+			continue;
+
+		BenchmarkResult result;
+		result.Name = c.Name;
+		result.Runs = std::max(mOptions.Runs, 1);
+		result.MinMs = 1e300;
+
+		// One untimed warm-up run.
+		std::string note;
+		c.Run(note);
+
+		double totalMs = 0.0;
+		std::uint64_t items = 0;
+		for (int i = 0; i < result.Runs; ++i)
+		{
+			auto start = Clock::now();
+			items += c.Run(note);
+			double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+			totalMs += ms;
+			result.MinMs = std::min(result.MinMs, ms);
+		}
+
+		result.MeanMs = totalMs / result.Runs;
+		result.ItemsPerSecond = totalMs > 0.0 ? items / (totalMs / 1000.0) : 0.0;
+		result.Note = note;
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void Benchmark::Print(const std::vector<BenchmarkResult>& results, std::FILE* out)
+{
+	std::fprintf(out, "%-40s %6s %12s %12s %14s  %s\n", "case", "runs", "mean ms", "min ms", "items/s", "note");
+	for (auto& r : results)
+	{
+		std::fprintf(out, "%-40s %6d %12.3f %12.3f %14.0f  %s\n",
+			r.Name.c_str(), r.Runs, r.MeanMs, r.MinMs, r.ItemsPerSecond, r.Note.c_str());
+	}
+}
+
+int Benchmark::RunDefault(const BenchmarkOptions& options)
+{
+	Benchmark bench(options);
+
+	auto fixture = std::make_shared<RenderFixture>(options);
+	AddPrecisionCases(bench, fixture);
+	AddAntiAliasCases(bench, fixture);
+	AddUpsampleCases(bench, fixture);
+	AddLightingCases(bench, fixture);
+	AddWavefrontCases(bench, fixture);
+	AddTraversalCases(bench, fixture);
+
+	auto points = std::make_shared<SamplePoints>(24);
+	AddFormulaCases<Mandelbulb>(bench, FractalFormula::Mandelbulb, points, fixture);
+	AddFormulaCases<Mandelbox>(bench, FractalFormula::Mandelbox, points, fixture);
+	AddFormulaCases<Juliabulb>(bench, FractalFormula::Juliabulb, points, fixture);
+	AddFormulaCases<QuaternionJulia>(bench, FractalFormula::QuaternionJulia, points, fixture);
+	AddFormulaCases<KaleidoscopicIFS>(bench, FractalFormula::KaleidoscopicIFS, points, fixture);
+	AddHybridCases(bench, points, fixture);
+	AddPathCases(bench, fixture);
+	AddPipelineCases(bench);
+	AddRingAllocatorCases(bench);
+	AddMathCases(bench);
+	AddRandomCases(bench);
+
+	Print(bench.Run(), stdout);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "CameraController.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const float Pi = 3.1415926535f;
+
+	float ToRadians(float degrees)
+	{
+		return degrees * (Pi / 180.0f);
+	}
+}
+
+void CameraInput::ResetFrameDeltas()
+{
+	MouseDx = 0;
+	MouseDy = 0;
+	PowerSteps = 0;
+}
+
+bool CameraState::operator==(const CameraState& rhs) const
+{
+	return Position.x == rhs.Position.x && Position.y == rhs.Position.y && Position.z == rhs.Position.z
+		&& Theta == rhs.Theta && Phi == rhs.Phi
+		&& Power == rhs.Power && PowerGrowSpeed == rhs.PowerGrowSpeed;
+}
+
+void CameraController::Step(CameraState& state, const CameraInput& input, float dt) const
+{
+	// Mouse look
+	state.Theta += -ToRadians(.25f * static_cast<float>(input.MouseDx));
+	state.Phi += ToRadians(.25f * static_cast<float>(input.MouseDy));
+	state.Phi = std::min(std::max(state.Phi, .1f), Pi - .1f);
+
+	// Power animation
+	state.PowerGrowSpeed += .01f * input.PowerSteps;
+	state.Power += state.PowerGrowSpeed * dt;
+	if (state.Power < 1.0f) state.Power = 1.0f;
+
+	// Fly movement
+	const Vec3f up(0.0f, 1.0f, 0.0f);
+	Vec3f forward = Forward(state);
+	Vec3f right = Normalize(Cross(forward, up));
+
+	state.Position += (
+		forward * (input.Vertical * MoveSpeedHor)
+		+ right * (input.Horizontal * MoveSpeedHor)
+		+ up * ((input.Up ? +1.0f : input.Down ? -1.0f : 0.0f) * MoveSpeedVert)
+		) * ((input.Boost ? MoveSpeedAcceleration : 1.0f) * dt);
+}
+
+Vec3f CameraController::Forward(const CameraState& state)
+{
+	return Normalize(Vec3f(
+		sinf(state.Phi) * cosf(state.Theta),
+		cosf(state.Phi),
+		sinf(state.Phi) * sinf(state.Theta)));
+}
+
+CpuCamera CameraController::ToCpuCamera(const CameraState& state)
+{
+	CpuCamera camera;
+	camera.Position = Vec3d(state.Position.x, state.Position.y, state.Position.z);
+	camera.Theta = state.Theta;
+	camera.Phi = state.Phi;
+	return camera;
+}
\ No newline at end of file
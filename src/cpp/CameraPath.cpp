@@ -0,0 +1,165 @@
+#include "CameraPath.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+	double CatmullRom(double p0, double p1, double p2, double p3, double u)
+	{
+		return 0.5 * (2.0 * p1
+			+ (p2 - p0) * u
+			+ (2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3) * u * u
+			+ (3.0 * p1 - p0 - 3.0 * p2 + p3) * u * u * u);
+	}
+}
+
+void CameraPath::Add(const CameraKey& key)
+{
+	mKeys.push_back(key);
+}
+
+const std::vector<CameraKey>& CameraPath::Keys() const
+{
+	return mKeys;
+}
+
+bool CameraPath::Empty() const
+{
+	return mKeys.empty();
+}
+
+double CameraPath::Duration() const
+{
+	return mKeys.empty() ? 0.0 : mKeys.back().Time - mKeys.front().Time;
+}
+
+CameraKey CameraPath::Evaluate(double time) const
+{
+	if (mKeys.empty())
+		return CameraKey();
+	if (time <= mKeys.front().Time)
+		return mKeys.front();
+	if (time >= mKeys.back().Time)
+		return mKeys.back();
+
+	// Segment [k1, k2] containing time; the outer keys repeat at the ends.
+	std::size_t i2 = std::upper_bound(mKeys.begin(), mKeys.end(), time,
+		[](double t, const CameraKey& key) { return t < key.Time; }) - mKeys.begin();
+	std::size_t i1 = i2 - 1;
+	std::size_t i0 = i1 > 0 ? i1 - 1 : i1;
+	std::size_t i3 = std::min(i2 + 1, mKeys.size() - 1);
+
+	const CameraKey& k0 = mKeys[i0];
+	const CameraKey& k1 = mKeys[i1];
+	const CameraKey& k2 = mKeys[i2];
+	const CameraKey& k3 = mKeys[i3];
+
+	double span = k2.Time - k1.Time;
+	double u = span > 0.0 ? (time - k1.Time) / span : 0.0;
+
+	CameraKey key;
+	key.Time = time;
+	key.Position = Vec3d(
+		CatmullRom(k0.Position.x, k1.Position.x, k2.Position.x, k3.Position.x, u),
+		CatmullRom(k0.Position.y, k1.Position.y, k2.Position.y, k3.Position.y, u),
+		CatmullRom(k0.Position.z, k1.Position.z, k2.Position.z, k3.Position.z, u));
+	key.Theta = CatmullRom(k0.Theta, k1.Theta, k2.Theta, k3.Theta, u);
+	key.Phi = CatmullRom(k0.Phi, k1.Phi, k2.Phi, k3.Phi, u);
+	key.Power = (float)CatmullRom(k0.Power, k1.Power, k2.Power, k3.Power, u);
+	return key;
+}
+
+CpuCamera CameraPath::CameraAt(double time) const
+{
+	CameraKey key = Evaluate(time);
+
+	CpuCamera camera;
+	camera.Position = key.Position;
+	camera.Theta = key.Theta;
+	camera.Phi = key.Phi;
+	return camera;
+}
+
+bool CameraPath::Save(const std::string& path) const
+{
+	std::FILE* file = std::fopen(path.c_str(), "w");
+	if (file == nullptr)
+		return false;
+
+	std::fprintf(file, "# time x y z theta phi power\n");
+	for (const CameraKey& key : mKeys)
+	{
+		std::fprintf(file, "%.17g %.17g %.17g %.17g %.17g %.17g %.9g\n",
+			key.Time, key.Position.x, key.Position.y, key.Position.z, key.Theta, key.Phi, key.Power);
+	}
+
+	return std::fclose(file) == 0;
+}
+
+bool CameraPath::Load(const std::string& path)
+{
+	std::FILE* file = std::fopen(path.c_str(), "r");
+	if (file == nullptr)
+		return false;
+
+	std::vector<CameraKey> keys;
+	char line[512];
+	bool ok = true;
+
+	while (ok && std::fgets(line, sizeof(line), file) != nullptr)
+	{
+		const char* p = line;
+		while (*p == ' ' || *p == '\t')
+			++p;
+		if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+			continue;
+
+		CameraKey key;
+		ok = std::sscanf(p, "%lf %lf %lf %lf %lf %lf %f",
+			&key.Time, &key.Position.x, &key.Position.y, &key.Position.z, &key.Theta, &key.Phi, &key.Power) == 7
+			&& (keys.empty() || key.Time >= keys.back().Time);
+		keys.push_back(key);
+	}
+	std::fclose(file);
+
+	if (!ok || keys.empty())
+		return false;
+
+	mKeys.swap(keys);
+	return true;
+}
+
+bool CameraPath::LoadAny(const std::string& path, float fixedDt)
+{
+	CameraRecording recording;
+	if (recording.Load(path))
+	{
+		*this = FromRecording(recording, fixedDt);
+		return !mKeys.empty();
+	}
+	return Load(path);
+}
+
+CameraPath CameraPath::FromRecording(const CameraRecording& recording, float fixedDt)
+{
+	CameraController controller;
+	std::vector<CameraState> states = recording.Replay(controller, fixedDt);
+
+	CameraPath path;
+	double time = 0.0;
+	for (std::size_t i = 0; i < states.size(); ++i)
+	{
+		const CameraState& state = states[i];
+
+		CameraKey key;
+		key.Time = fixedDt > 0.0f ? i * (double)fixedDt : time;
+		key.Position = Vec3d(state.Position.x, state.Position.y, state.Position.z);
+		key.Theta = state.Theta;
+		key.Phi = state.Phi;
+		key.Power = state.Power;
+		path.Add(key);
+
+		time += recording.Frames()[i].Dt;
+	}
+	return path;
+}
\ No newline at end of file
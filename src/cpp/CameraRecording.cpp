@@ -0,0 +1,212 @@
+#include "CameraRecording.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const char Magic[4] = { 'C', 'A', 'M', 'L' };
+	const std::uint32_t Version = 1;
+
+	const std::uint8_t FlagUp = 1 << 0;
+	const std::uint8_t FlagDown = 1 << 1;
+	const std::uint8_t FlagBoost = 1 << 2;
+
+	// The log is written in host byte order, which is little-endian on every target.
+	template<typename T>
+	void Put(std::vector<std::uint8_t>& out, T value)
+	{
+		std::uint8_t bytes[sizeof(T)];
+		std::memcpy(bytes, &value, sizeof(T));
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	template<typename T>
+	bool Get(const std::vector<std::uint8_t>& in, std::size_t& offset, T& value)
+	{
+		if (offset + sizeof(T) > in.size())
+			return false;
+		std::memcpy(&value, in.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	template<typename T>
+	T ClampTo(int value, int low, int high)
+	{
+		return (T)(value < low ? low : (value > high ? high : value));
+	}
+
+	void PutState(std::vector<std::uint8_t>& out, const CameraState& state)
+	{
+		Put(out, state.Position.x);
+		Put(out, state.Position.y);
+		Put(out, state.Position.z);
+		Put(out, state.Theta);
+		Put(out, state.Phi);
+		Put(out, state.Power);
+		Put(out, state.PowerGrowSpeed);
+	}
+
+	bool GetState(const std::vector<std::uint8_t>& in, std::size_t& offset, CameraState& state)
+	{
+		return Get(in, offset, state.Position.x)
+			&& Get(in, offset, state.Position.y)
+			&& Get(in, offset, state.Position.z)
+			&& Get(in, offset, state.Theta)
+			&& Get(in, offset, state.Phi)
+			&& Get(in, offset, state.Power)
+			&& Get(in, offset, state.PowerGrowSpeed);
+	}
+
+	// One recorded frame: dt, flags, three input axes, two mouse deltas and the state.
+	std::size_t FrameBytes()
+	{
+		std::vector<std::uint8_t> state;
+		PutState(state, CameraState());
+		return sizeof(float) + 4 * sizeof(std::int8_t) + 2 * sizeof(std::int16_t) + state.size();
+	}
+}
+
+void CameraRecording::Clear(const CameraState& initial)
+{
+	mInitial = initial;
+	mFrames.clear();
+}
+
+void CameraRecording::Append(float dt, const CameraInput& input, const CameraState& state)
+{
+	Frame frame;
+	frame.Dt = dt;
+	frame.Input = input;
+	frame.State = state;
+
+	// Store exactly what Save can represent, so a saved log replays like the live one.
+	frame.Input.Horizontal = (float)ClampTo<std::int8_t>((int)lroundf(input.Horizontal), -127, 127);
+	frame.Input.Vertical = (float)ClampTo<std::int8_t>((int)lroundf(input.Vertical), -127, 127);
+	frame.Input.MouseDx = ClampTo<std::int16_t>(input.MouseDx, -32767, 32767);
+	frame.Input.MouseDy = ClampTo<std::int16_t>(input.MouseDy, -32767, 32767);
+	frame.Input.PowerSteps = ClampTo<std::int8_t>(input.PowerSteps, -127, 127);
+
+	mFrames.push_back(frame);
+}
+
+const CameraState& CameraRecording::Initial() const
+{
+	return mInitial;
+}
+
+const std::vector<CameraRecording::Frame>& CameraRecording::Frames() const
+{
+	return mFrames;
+}
+
+bool CameraRecording::Save(const std::string& path) const
+{
+	std::vector<std::uint8_t> out;
+	out.insert(out.end(), Magic, Magic + 4);
+	Put(out, Version);
+	Put(out, (std::uint32_t)mFrames.size());
+	PutState(out, mInitial);
+
+	for (const Frame& frame : mFrames)
+	{
+		std::uint8_t flags = (frame.Input.Up ? FlagUp : 0) | (frame.Input.Down ? FlagDown : 0) | (frame.Input.Boost ? FlagBoost : 0);
+
+		Put(out, frame.Dt);
+		Put(out, flags);
+		Put(out, (std::int8_t)frame.Input.Horizontal);
+		Put(out, (std::int8_t)frame.Input.Vertical);
+		Put(out, (std::int8_t)frame.Input.PowerSteps);
+		Put(out, (std::int16_t)frame.Input.MouseDx);
+		Put(out, (std::int16_t)frame.Input.MouseDy);
+		PutState(out, frame.State);
+	}
+
+	std::FILE* file = std::fopen(path.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+
+	bool ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+	return std::fclose(file) == 0 && ok;
+}
+
+bool CameraRecording::Load(const std::string& path)
+{
+	std::FILE* file = std::fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+
+	std::vector<std::uint8_t> in;
+	std::uint8_t buffer[4096];
+	for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), file)) > 0;)
+		in.insert(in.end(), buffer, buffer + n);
+	std::fclose(file);
+
+	std::size_t offset = 4;
+	std::uint32_t version = 0;
+	std::uint32_t count = 0;
+	CameraState initial;
+
+	if (in.size() < 4 || std::memcmp(in.data(), Magic, 4) != 0)
+		return false;
+	if (!Get(in, offset, version) || version != Version || !Get(in, offset, count) || !GetState(in, offset, initial))
+		return false;
+
+	// A damaged count must not allocate more frames than the file can hold.
+	if (count > (in.size() - offset) / FrameBytes())
+		return false;
+
+	std::vector<Frame> frames(count);
+	for (Frame& frame : frames)
+	{
+		std::uint8_t flags = 0;
+		std::int8_t horizontal = 0, vertical = 0, powerSteps = 0;
+		std::int16_t mouseDx = 0, mouseDy = 0;
+
+		if (!Get(in, offset, frame.Dt) || !Get(in, offset, flags)
+			|| !Get(in, offset, horizontal) || !Get(in, offset, vertical) || !Get(in, offset, powerSteps)
+			|| !Get(in, offset, mouseDx) || !Get(in, offset, mouseDy)
+			|| !GetState(in, offset, frame.State))
+			return false;
+
+		frame.Input.Up = (flags & FlagUp) != 0;
+		frame.Input.Down = (flags & FlagDown) != 0;
+		frame.Input.Boost = (flags & FlagBoost) != 0;
+		frame.Input.Horizontal = horizontal;
+		frame.Input.Vertical = vertical;
+		frame.Input.PowerSteps = powerSteps;
+		frame.Input.MouseDx = mouseDx;
+		frame.Input.MouseDy = mouseDy;
+	}
+
+	mInitial = initial;
+	mFrames.swap(frames);
+	return true;
+}
+
+std::vector<CameraState> CameraRecording::Replay(const CameraController& controller, float fixedDt) const
+{
+	std::vector<CameraState> states;
+	states.reserve(mFrames.size());
+
+	CameraState state = mInitial;
+	for (const Frame& frame : mFrames)
+	{
+		controller.Step(state, frame.Input, fixedDt > 0.0f ? fixedDt : frame.Dt);
+		states.push_back(state);
+	}
+	return states;
+}
+
+int CameraRecording::FirstDivergence(const CameraController& controller) const
+{
+	std::vector<CameraState> states = Replay(controller);
+	for (std::size_t i = 0; i < states.size(); ++i)
+	{
+		if (states[i] != mFrames[i].State)
+			return (int)i;
+	}
+	return -1;
+}
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "Checkpoint.h"
+#include "Hash.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double NowSeconds()
+	{
+		return std::chrono::duration<double>(Clock::now().time_since_epoch()).count();
+	}
+
+	// Written through a descriptor so the data can be flushed to disk before the rename.
+	bool WriteDurable(const std::string& path, const std::string& text)
+	{
+#ifdef _WIN32
+		int fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+		if (fd < 0)
+			return false;
+		bool ok = _write(fd, text.data(), (unsigned)text.size()) == (int)text.size() && _commit(fd) == 0;
+		return _close(fd) == 0 && ok;
+#else
+		int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+			return false;
+		bool ok = write(fd, text.data(), text.size()) == (ssize_t)text.size() && fsync(fd) == 0;
+		return close(fd) == 0 && ok;
+#endif
+	}
+}
+
+Checkpoint::Checkpoint(const std::string& path, const std::string& signature, double intervalSeconds) :
+	mPath(path),
+	mSignature(signature),
+	mIntervalSeconds(intervalSeconds),
+	mLastSave(NowSeconds())
+{
+}
+
+bool Checkpoint::Load()
+{
+	mItems.clear();
+	mDirty = false;
+
+	std::ifstream file(mPath, std::ios::binary);
+	if (!file)
+		return false;
+	std::ostringstream stream;
+	stream << file.rdbuf();
+	std::string text = stream.str();
+
+	// The last line checksums everything before it.
+	std::size_t end = text.rfind("end ");
+	if (end == std::string::npos || (end > 0 && text[end - 1] != '\n'))
+		return false;
+	unsigned long long expected = 0;
+	if (std::sscanf(text.c_str() + end, "end %llx", &expected) != 1 || Fnv1a(text.data(), end) != expected)
+		return false;
+
+	std::istringstream lines(text.substr(0, end));
+	std::string line;
+	if (!std::getline(lines, line) || line != "checkpoint 1" || !std::getline(lines, line) || line != "signature " + mSignature)
+		return false;
+
+	int index = 0;
+	unsigned long long checksum = 0;
+	while (lines >> std::dec >> index >> std::hex >> checksum)
+		mItems[index] = checksum;
+	return true;
+}
+
+void Checkpoint::Add(int index, std::uint64_t checksum)
+{
+	mItems[index] = checksum;
+	mDirty = true;
+}
+
+void Checkpoint::Remove(int index)
+{
+	mDirty = mItems.erase(index) > 0 || mDirty;
+}
+
+bool Checkpoint::Contains(int index) const
+{
+	return mItems.count(index) > 0;
+}
+
+const std::map<int, std::uint64_t>& Checkpoint::Items() const
+{
+	return mItems;
+}
+
+bool Checkpoint::Update()
+{
+	if (!mDirty || NowSeconds() - mLastSave < mIntervalSeconds)
+		return true;
+	return Save();
+}
+
+bool Checkpoint::Save()
+{
+	Clock::time_point start = Clock::now();
+
+	std::ostringstream text;
+	text << "checkpoint 1\nsignature " << mSignature << "\n";
+	for (const auto& item : mItems)
+		text << std::dec << item.first << " " << std::hex << item.second << "\n";
+	std::string body = text.str();
+
+	char end[32];
+	std::snprintf(end, sizeof(end), "end %016llx\n", (unsigned long long)Fnv1a(body.data(), body.size()));
+	body += end;
+
+	std::string temporary = mPath + ".tmp";
+	std::error_code error;
+	bool ok = WriteDurable(temporary, body);
+	if (ok)
+		std::filesystem::rename(temporary, mPath, error);
+	ok = ok && !error;
+
+	mDirty = !ok;
+	mLastSave = NowSeconds();
+	++mSaves;
+	mSaveMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	return ok;
+}
+
+void Checkpoint::Discard()
+{
+	std::error_code error;
+	std::filesystem::remove(mPath, error);
+	std::filesystem::remove(mPath + ".tmp", error);
+	mItems.clear();
+	mDirty = false;
+}
+
+const std::string& Checkpoint::Path() const
+{
+	return mPath;
+}
+
+int Checkpoint::Saves() const
+{
+	return mSaves;
+}
+
+double Checkpoint::SaveMs() const
+{
+	return mSaveMs;
+}
+
+std::string CameraSignature(const CpuCamera& camera)
+{
+	char buffer[256];
+	std::snprintf(buffer, sizeof(buffer), "camera %.17g %.17g %.17g %.17g %.17g %.17g",
+		camera.Position.x, camera.Position.y, camera.Position.z, camera.Theta, camera.Phi, camera.FovY);
+	return buffer;
+}
+
+std::string SettingsSignature(const RenderSettings& settings)
+{
+	std::string signature;
+	settings.VisitPixelFields([&signature](const char* name, auto value)
+	{
+		// Floats with enough digits to round-trip, so any change shows.
+		char buffer[64];
+		typedef decltype(value) T;
+		if constexpr (std::is_same<T, float>::value)
+			std::snprintf(buffer, sizeof(buffer), "%s %.9g", name, value);
+		else if constexpr (std::is_same<T, double>::value)
+			std::snprintf(buffer, sizeof(buffer), "%s %.17g", name, value);
+		else
+			std::snprintf(buffer, sizeof(buffer), "%s %llu", name, (unsigned long long)value);
+
+		signature += signature.empty() ? "" : " ";
+		signature += buffer;
+	});
+	return signature;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include "ConstantBufferLayout.h"
+#include <cstdio>
+
+std::string CbLayout::Emit(const char* name, int slot, const CbField* fields, std::size_t count)
+{
+	char line[256];
+	std::snprintf(line, sizeof(line), "cbuffer %s : register(b%d)\n{\n", name, slot);
+	std::string out = line;
+
+	std::size_t offset = 0;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const CbField& field = fields[i];
+		if (StartsRegister(field, offset))
+			offset = (offset + RegisterSize - 1) / RegisterSize * RegisterSize;
+
+		// One blank line per register group, matrices kept together.
+		bool afterMatrix = i > 0 && fields[i - 1].Kind == CbKind::Matrix && field.Kind == CbKind::Matrix;
+		if (i > 0 && offset % RegisterSize == 0 && !afterMatrix)
+			out += "\n";
+
+		std::snprintf(line, sizeof(line), "\t%s %s; // offset %zu\n", field.HlslType, field.Name, offset);
+		out += line;
+		offset += field.Size;
+	}
+
+	out += "};\n";
+	return out;
+}
\ No newline at end of file
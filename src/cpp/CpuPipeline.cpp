@@ -0,0 +1,102 @@
+#include "CpuPipeline.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+	enum PipelineStage
+	{
+		UpdateStageIndex,
+		RenderStageIndex,
+		PresentStageIndex,
+		StageCount
+	};
+}
+
+CpuPipeline::CpuPipeline(int depth, int width, int height, int threads) :
+	mDepth(std::max(depth, 1)),
+	mWidth(width),
+	mHeight(height),
+	mRenderer(threads)
+{
+}
+
+int CpuPipeline::Depth() const
+{
+	return mDepth;
+}
+
+CpuPipelineStats CpuPipeline::Run(int frameCount, const UpdateStage& update, const PresentStage& present)
+{
+	FrameRing<CpuFrameResource> ring(mDepth, StageCount);
+	for (CpuFrameResource& slot : ring.Slots())
+		slot.Target.Resize(mWidth, mHeight);
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread updater([&]
+	{
+		TRACE_THREAD_NAME("Pipeline update");
+		for (std::uint32_t frame = 0; frame < (std::uint32_t)frameCount; ++frame)
+		{
+			if (!ring.Begin(UpdateStageIndex, frame))
+				return;
+
+			CpuFrameResource& resource = ring.Slot(frame);
+			resource.Frame = frame;
+
+			TRACE_SCOPE("Update");
+			if (!update(resource))
+			{
+				ring.Close();
+				return;
+			}
+
+			ring.End(UpdateStageIndex, frame);
+		}
+	});
+
+	std::thread presenter([&]
+	{
+		TRACE_THREAD_NAME("Pipeline present");
+		for (std::uint32_t frame = 0; ring.Begin(PresentStageIndex, frame); ++frame)
+		{
+			{
+				TRACE_SCOPE("Present");
+				present(ring.Slot(frame));
+			}
+			ring.End(PresentStageIndex, frame);
+
+			if (frame + 1 == (std::uint32_t)frameCount)
+				break;
+		}
+	});
+
+	int rendered = 0;
+	for (std::uint32_t frame = 0; frame < (std::uint32_t)frameCount && ring.Begin(RenderStageIndex, frame); ++frame)
+	{
+		CpuFrameResource& resource = ring.Slot(frame);
+		mRenderer.Render(resource.Camera, resource.Settings, resource.Target);
+		ring.End(RenderStageIndex, frame);
+		++rendered;
+	}
+
+	// The presenter finishes the frames already rendered, then stops; without this
+	// an early stop, or no frames at all, leaves it waiting for frames that never come.
+	ring.Close();
+
+	updater.join();
+	presenter.join();
+
+	CpuPipelineStats stats;
+	stats.Frames = rendered;
+	stats.TotalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	stats.AverageInFlight = ring.AverageInFlight();
+	stats.MaxInFlight = ring.MaxInFlight();
+	stats.Update = ring.Stats(UpdateStageIndex);
+	stats.Render = ring.Stats(RenderStageIndex);
+	stats.Present = ring.Stats(PresentStageIndex);
+	return stats;
+}
\ No newline at end of file
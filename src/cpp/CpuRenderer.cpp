@@ -0,0 +1,1123 @@
+#include "CpuRenderer.h"
+#include "Random.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	float Saturate(float x)
+	{
+		return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+	}
+
+	std::uint32_t PackColor(float r, float g, float b, float a)
+	{
+		std::uint32_t R = (std::uint32_t)(Saturate(r) * 255.0f + 0.5f);
+		std::uint32_t G = (std::uint32_t)(Saturate(g) * 255.0f + 0.5f);
+		std::uint32_t B = (std::uint32_t)(Saturate(b) * 255.0f + 0.5f);
+		std::uint32_t A = (std::uint32_t)(Saturate(a) * 255.0f + 0.5f);
+		return R | (G << 8) | (B << 16) | (A << 24);
+	}
+
+	float Channel(std::uint32_t color, int channel)
+	{
+		return (float)((color >> (8 * channel)) & 0xFF) / 255.0f;
+	}
+
+	template<typename T>
+	Vec3T<T> ToVec(const Vec3d& v)
+	{
+		return Vec3T<T>(T(v.x), T(v.y), T(v.z));
+	}
+
+	// Every other bit of v, packed into the low 16 bits.
+	std::uint32_t CompactBits(std::uint32_t v)
+	{
+		v &= 0x55555555u;
+		v = (v | (v >> 1)) & 0x33333333u;
+		v = (v | (v >> 2)) & 0x0F0F0F0Fu;
+		v = (v | (v >> 4)) & 0x00FF00FFu;
+		v = (v | (v >> 8)) & 0x0000FFFFu;
+		return v;
+	}
+
+	// Calls visit(x, y) for every cell of a width x height grid in Morton (Z) order.
+	template<typename Visit>
+	void VisitMorton(int width, int height, Visit visit)
+	{
+		int side = 1;
+		while (side < width || side < height)
+			side *= 2;
+
+		// Codes over the enclosing power-of-two square; cells outside the grid are skipped.
+		for (std::uint32_t code = 0; code < (std::uint32_t)side * side; ++code)
+		{
+			int x = (int)CompactBits(code);
+			int y = (int)CompactBits(code >> 1);
+			if (x < width && y < height)
+				visit(x, y);
+		}
+	}
+
+	// Scratch arena of the thread running tiles, set by ProcessTiles.
+	thread_local Arena* tTileArena = nullptr;
+}
+
+Vec3d CpuCamera::Forward() const
+{
+	return Vec3d(
+		sin(Phi) * cos(Theta),
+		cos(Phi),
+		sin(Phi) * sin(Theta));
+}
+
+const char* PrecisionName(Precision precision)
+{
+	switch (precision)
+	{
+	case Precision::Float: return "float";
+	case Precision::Double: return "double";
+	case Precision::DoubleDouble: return "double-double";
+	}
+	return "unknown";
+}
+
+void CpuFramebuffer::Resize(int width, int height)
+{
+	Width = width;
+	Height = height;
+
+	std::size_t count = (std::size_t)width * height;
+	Color.assign(count, 0);
+	Depth.assign(count, 0.0f);
+	Iterations.assign(count, 0);
+	Steps.assign(count, 0);
+	Samples.assign(count, 0);
+}
+
+CpuRenderer::CpuRenderer(int threadCount) :
+	mNextTile(0),
+	mRays(0),
+	mDistanceEvaluations(0),
+	mSupersampledPixels(0),
+	mRemarchedPixels(0),
+	mShadowRays(0),
+	mShadowEvaluations(0),
+	mLaneEvaluations(0),
+	mLaneSlots(0)
+{
+	if (threadCount <= 0)
+		threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+
+	for (int i = 0; i < threadCount; ++i)
+		mThreadArenas.emplace_back(new Arena());
+
+	// The calling thread works on tiles too.
+	for (int i = 1; i < threadCount; ++i)
+		mWorkers.emplace_back(&CpuRenderer::WorkerLoop, this, i);
+}
+
+CpuRenderer::~CpuRenderer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mWakeCondition.notify_all();
+
+	for (auto& worker : mWorkers)
+		worker.join();
+}
+
+int CpuRenderer::ThreadCount() const
+{
+	return (int)mWorkers.size() + 1;
+}
+
+Precision CpuRenderer::LastPrecision() const
+{
+	return mLastPrecision;
+}
+
+CpuRenderStats CpuRenderer::LastStats() const
+{
+	return mLastStats;
+}
+
+Precision CpuRenderer::SelectPrecision(const CpuCamera& camera, const RenderSettings& settings, int height)
+{
+	switch (settings.Precision)
+	{
+	case PrecisionMode::Float: return Precision::Float;
+	case PrecisionMode::Double: return Precision::Double;
+	case PrecisionMode::DoubleDouble: return Precision::DoubleDouble;
+	default: break;
+	}
+
+	int iterations = 0;
+	double surface = std::fabs(DistanceEstimate(camera.Position, settings.March.Fractal, iterations));
+	double pixelAngle = 2.0 * tan(camera.FovY * 0.5) / std::max(height, 1);
+	double footprint = std::max(surface, 1e-300) * pixelAngle;
+
+	// Coordinates must resolve a fraction of the footprint after rounding
+	// accumulates over the march, hence the generous margin.
+	const double margin = 64.0;
+	double magnitude = std::max(Length(camera.Position), 1.0);
+
+	if (FLT_EPSILON * margin * magnitude < footprint)
+		return Precision::Float;
+	if (DBL_EPSILON * margin * magnitude < footprint)
+		return Precision::Double;
+	return Precision::DoubleDouble;
+}
+
+void CpuRenderer::Render(const CpuCamera& camera, const RenderSettings& settings, CpuFramebuffer& target)
+{
+	TRACE_SCOPE("CpuRenderer::Render");
+
+	// Projection and pixel footprint follow the full image when rendering a region of it.
+	const ImageRegion& region = settings.Region;
+	const bool window = region.FullWidth > 0 && region.FullHeight > 0;
+	mJob.OutputWidth = window ? region.FullWidth : target.Width;
+	mJob.OutputHeight = window ? region.FullHeight : target.Height;
+	mJob.OffsetX = window ? region.X : 0;
+	mJob.OffsetY = window ? region.Y : 0;
+
+	mJob.Settings = &settings;
+	mJob.March = settings.March;
+	mJob.Tier = SelectPrecision(camera, settings, mJob.OutputHeight);
+
+	// Resolve formula and hybrid sequence once per frame so the march loops are fully specialized.
+	mJob.Kernel = SelectKernel(settings.March.Fractal);
+
+	// Same basis as XMMatrixLookAtLH with a world up of +Y.
+	mJob.Origin = camera.Position;
+	mJob.Forward = Normalize(camera.Forward());
+	mJob.Right = Normalize(Cross(Vec3d(0.0, 1.0, 0.0), mJob.Forward));
+	mJob.Up = Cross(mJob.Forward, mJob.Right);
+	mJob.TanHalfFovY = tan(camera.FovY * 0.5);
+	mJob.AspectRatio = (double)mJob.OutputWidth / std::max(mJob.OutputHeight, 1);
+
+	if (settings.AdaptiveEpsilon)
+		mJob.March.PixelAngle = 2.0 * mJob.TanHalfFovY / std::max(mJob.OutputHeight, 1);
+
+	mRays = 0;
+	mDistanceEvaluations = 0;
+	mSupersampledPixels = 0;
+	mRemarchedPixels = 0;
+	mShadowRays = 0;
+	mShadowEvaluations = 0;
+	mLaneEvaluations = 0;
+	mLaneSlots = 0;
+
+	// Workers are idle between frames, so their arenas can be reset from here.
+	mFrameArena.Reset();
+	for (auto& arena : mThreadArenas)
+		arena->Reset();
+
+	int factor = std::max(settings.Upsample.Factor, 1);
+	if (factor > 1)
+	{
+		int width = (target.Width + factor - 1) / factor;
+		int height = (target.Height + factor - 1) / factor;
+		if (mLowRes.Width != width || mLowRes.Height != height)
+			mLowRes.Resize(width, height);
+
+		SetTarget(mLowRes, factor);
+		mJob.Pass = Phase::Primary;
+		RunTiles();
+
+		TRACE_SCOPE("Upsample");
+		SetTarget(target, 1);
+		mJob.Remarch = SelectRemarchKernel(settings.March.Fractal);
+		mJob.Pass = Phase::Upsample;
+		RunTiles();
+	}
+	else
+	{
+		SetTarget(target, 1);
+		mJob.Pass = Phase::Primary;
+		RunTiles();
+	}
+
+	// Normals come from neighbouring depths, so lighting is its own sweep as well.
+	if (settings.Lighting.Enabled())
+	{
+		TRACE_SCOPE("Lighting");
+		mLight = mFrameArena.Allocate<float>(target.Color.size());
+		std::fill(mLight, mLight + target.Color.size(), 1.0f);
+		mJob.Light = SelectLightKernel(settings.March.Fractal);
+		mJob.Pass = Phase::Light;
+		RunTiles();
+	}
+
+	// Edges are found from the finished primary image, so the resolve pass runs
+	// as a second sweep over the tiles once every neighbour is available.
+	if (settings.AntiAlias.Enabled && settings.AntiAlias.Samples > 0)
+	{
+		TRACE_SCOPE("Anti-aliasing");
+		mPrimaryColor = mFrameArena.Allocate<std::uint32_t>(target.Color.size());
+		std::copy(target.Color.begin(), target.Color.end(), mPrimaryColor);
+		mJob.Resolve = SelectResolveKernel(settings.March.Fractal);
+		mJob.Pass = Phase::Resolve;
+		RunTiles();
+	}
+
+	mLastPrecision = mJob.Tier;
+	mLastStats.Rays = mRays;
+	mLastStats.DistanceEvaluations = mDistanceEvaluations;
+	mLastStats.SupersampledPixels = mSupersampledPixels;
+	mLastStats.RemarchedPixels = mRemarchedPixels;
+	mLastStats.ShadowRays = mShadowRays;
+	mLastStats.ShadowEvaluations = mShadowEvaluations;
+	mLastStats.LaneEvaluations = mLaneEvaluations;
+	mLastStats.LaneSlots = mLaneSlots;
+}
+
+void CpuRenderer::SetTarget(CpuFramebuffer& target, int scale)
+{
+	int tileSize = std::max(mJob.Settings->TileSize, 1);
+	mJob.Target = &target;
+	mJob.PixelScale = scale;
+	mJob.TilesX = (target.Width + tileSize - 1) / tileSize;
+	int tilesY = (target.Height + tileSize - 1) / tileSize;
+	mJob.TileCount = mJob.TilesX * tilesY;
+	mJob.TileOrder = nullptr;
+
+	if (mJob.TileCount <= 0)
+	{
+		mJob.TileCount = 0;
+		return;
+	}
+
+	if (mJob.Settings->Order == TraversalOrder::Morton)
+	{
+		int* order = mFrameArena.Allocate<int>(mJob.TileCount);
+		int count = 0;
+		VisitMorton(mJob.TilesX, tilesY, [&](int x, int y) { order[count++] = y * mJob.TilesX + x; });
+		mJob.TileOrder = order;
+	}
+}
+
+void CpuRenderer::RunTiles()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mNextTile = 0;
+		mBusyWorkers = (int)mWorkers.size();
+		++mGeneration;
+	}
+	mWakeCondition.notify_all();
+
+	ProcessTiles(*mThreadArenas[0]);
+
+	TRACE_SCOPE("Wait for workers");
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDoneCondition.wait(lock, [this] { return mBusyWorkers == 0; });
+}
+
+void CpuRenderer::WorkerLoop(int thread)
+{
+	TRACE_THREAD_NAME("Render worker");
+	std::uint64_t generation = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWakeCondition.wait(lock, [&] { return mQuit || mGeneration != generation; });
+			if (mQuit)
+				return;
+			generation = mGeneration;
+		}
+
+		ProcessTiles(*mThreadArenas[thread]);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (--mBusyWorkers == 0)
+			mDoneCondition.notify_one();
+	}
+}
+
+void CpuRenderer::ProcessTiles(Arena& scratch)
+{
+	tTileArena = &scratch;
+	for (int tile = mNextTile++; tile < mJob.TileCount; tile = mNextTile++)
+		RenderTile(tile);
+}
+
+void CpuRenderer::RenderTile(int tileIndex)
+{
+	TRACE_SCOPE("Tile");
+
+	// Scratch allocated while rendering the tile is released with it.
+	ArenaScope scratch(*tTileArena);
+
+	if (mJob.TileOrder != nullptr)
+		tileIndex = mJob.TileOrder[tileIndex];
+
+	const int tileSize = std::max(mJob.Settings->TileSize, 1);
+	int x0 = (tileIndex % mJob.TilesX) * tileSize;
+	int y0 = (tileIndex / mJob.TilesX) * tileSize;
+	int x1 = std::min(x0 + tileSize, mJob.Target->Width);
+	int y1 = std::min(y0 + tileSize, mJob.Target->Height);
+
+	if (mJob.Pass == Phase::Upsample)
+	{
+		UpsampleTile(x0, y0, x1, y1);
+		return;
+	}
+	if (mJob.Pass == Phase::Light)
+	{
+		(this->*mJob.Light)(x0, y0, x1, y1);
+		return;
+	}
+	if (mJob.Pass == Phase::Resolve)
+	{
+		ResolveTile(x0, y0, x1, y1);
+		return;
+	}
+
+	(this->*mJob.Kernel)(x0, y0, x1, y1);
+
+	// Every march step is one distance estimate; summed per tile to keep the atomics off the pixel loop.
+	const CpuFramebuffer& target = *mJob.Target;
+	std::uint64_t evaluations = 0;
+	for (int y = y0; y < y1; ++y)
+	{
+		for (int x = x0; x < x1; ++x)
+			evaluations += target.Steps[(std::size_t)y * target.Width + x];
+	}
+
+	mRays += (std::uint64_t)(x1 - x0) * (y1 - y0);
+	mDistanceEvaluations += evaluations;
+}
+
+void CpuRenderer::UpsampleTile(int x0, int y0, int x1, int y1)
+{
+	const UpsampleSettings& upsample = mJob.Settings->Upsample;
+	const CpuFramebuffer& low = mLowRes;
+	CpuFramebuffer& target = *mJob.Target;
+	const int factor = std::max(upsample.Factor, 1);
+	// Kept positive so a threshold of 0 (interpolate only equal depths) does not divide 0 by 0.
+	const float sigma = std::max(0.5f * upsample.DepthThreshold, 1e-6f);
+
+	PixelList remarch{ ArenaAllocator<QueuedPixel>(*tTileArena) };
+	remarch.reserve((std::size_t)(x1 - x0) * (y1 - y0));
+
+	for (int y = y0; y < y1; ++y)
+	{
+		// Low-resolution pixel centres sit in the middle of their factor x factor block.
+		float v = (y + 0.5f) / factor - 0.5f;
+		int ly = std::min(std::max((int)std::floor(v), 0), low.Height - 1);
+		int ly1 = std::min(ly + 1, low.Height - 1);
+		float fy = std::min(std::max(v - ly, 0.0f), 1.0f);
+
+		for (int x = x0; x < x1; ++x)
+		{
+			float u = (x + 0.5f) / factor - 0.5f;
+			int lx = std::min(std::max((int)std::floor(u), 0), low.Width - 1);
+			int lx1 = std::min(lx + 1, low.Width - 1);
+			float fx = std::min(std::max(u - lx, 0.0f), 1.0f);
+
+			const std::size_t taps[4] =
+			{
+				(std::size_t)ly * low.Width + lx,
+				(std::size_t)ly * low.Width + lx1,
+				(std::size_t)ly1 * low.Width + lx,
+				(std::size_t)ly1 * low.Width + lx1
+			};
+			const float bilinear[4] = { (1.0f - fx) * (1.0f - fy), fx * (1.0f - fy), (1.0f - fx) * fy, fx * fy };
+
+			float minDepth = low.Depth[taps[0]], maxDepth = minDepth;
+			int minIterations = low.Iterations[taps[0]], maxIterations = minIterations;
+			int nearest = 0;
+			for (int t = 1; t < 4; ++t)
+			{
+				minDepth = std::min(minDepth, low.Depth[taps[t]]);
+				maxDepth = std::max(maxDepth, low.Depth[taps[t]]);
+				minIterations = std::min(minIterations, (int)low.Iterations[taps[t]]);
+				maxIterations = std::max(maxIterations, (int)low.Iterations[taps[t]]);
+				nearest = bilinear[t] > bilinear[nearest] ? t : nearest;
+			}
+
+			// A silhouette or a change of iteration band between the taps cannot be interpolated.
+			if (maxDepth - minDepth > upsample.DepthThreshold * std::max(minDepth, 1e-6f) || maxIterations - minIterations > upsample.IterationThreshold)
+			{
+				QueuedPixel pixel;
+				pixel.X = x;
+				pixel.Y = y;
+				remarch.push_back(pixel);
+				continue;
+			}
+
+			// Joint bilateral weights: bilinear footprint times depth similarity to the nearest tap.
+			float reference = low.Depth[taps[nearest]];
+			float weights[4], total = 0.0f;
+			for (int t = 0; t < 4; ++t)
+			{
+				float d = (low.Depth[taps[t]] - reference) / (std::max(reference, 1e-6f) * sigma);
+				weights[t] = bilinear[t] * std::exp(-0.5f * d * d);
+				total += weights[t];
+			}
+
+			float rgba[4] = {}, depth = 0.0f;
+			for (int t = 0; t < 4; ++t)
+			{
+				float w = weights[t] / total;
+				for (int c = 0; c < 4; ++c)
+					rgba[c] += w * Channel(low.Color[taps[t]], c);
+				depth += w * low.Depth[taps[t]];
+			}
+
+			std::size_t index = (std::size_t)y * target.Width + x;
+			target.Color[index] = PackColor(rgba[0], rgba[1], rgba[2], rgba[3]);
+			target.Depth[index] = depth;
+			target.Iterations[index] = low.Iterations[taps[nearest]];
+			target.Steps[index] = low.Steps[taps[nearest]];
+			target.Samples[index] = 0;
+		}
+	}
+
+	if (remarch.empty())
+		return;
+
+	(this->*mJob.Remarch)(remarch);
+	mRemarchedPixels += remarch.size();
+	mRays += remarch.size();
+}
+
+float CpuRenderer::Contrast(int x, int y) const
+{
+	const AntiAliasSettings& aa = mJob.Settings->AntiAlias;
+	const CpuFramebuffer& target = *mJob.Target;
+	const std::size_t index = (std::size_t)y * target.Width + x;
+
+	const int dx[] = { -1, 1, 0, 0 };
+	const int dy[] = { 0, 0, -1, 1 };
+
+	float contrast = 0.0f;
+	for (int n = 0; n < 4; ++n)
+	{
+		int nx = x + dx[n];
+		int ny = y + dy[n];
+		if (nx < 0 || ny < 0 || nx >= target.Width || ny >= target.Height)
+			continue;
+		std::size_t neighbour = (std::size_t)ny * target.Width + nx;
+
+		float depth = target.Depth[index];
+		float otherDepth = target.Depth[neighbour];
+		float depthContrast = std::fabs(depth - otherDepth) / (std::max(std::min(depth, otherDepth), 1e-6f) * aa.DepthThreshold);
+
+		float iterationContrast = (float)std::abs((int)target.Iterations[index] - (int)target.Iterations[neighbour]) / std::max(aa.IterationThreshold, 1);
+
+		float colorContrast = 0.0f;
+		for (int c = 0; c < 3; ++c)
+			colorContrast = std::max(colorContrast, std::fabs(Channel(mPrimaryColor[index], c) - Channel(mPrimaryColor[neighbour], c)));
+		colorContrast /= aa.ColorThreshold;
+
+		contrast = std::max(contrast, std::max(depthContrast, std::max(iterationContrast, colorContrast)));
+	}
+	return contrast;
+}
+
+void CpuRenderer::TilePixels(int x0, int y0, int x1, int y1, PixelList& pixels) const
+{
+	pixels.clear();
+	pixels.reserve((std::size_t)(x1 - x0) * (y1 - y0));
+
+	auto add = [&pixels, x0, y0](int x, int y)
+	{
+		QueuedPixel pixel;
+		pixel.X = x0 + x;
+		pixel.Y = y0 + y;
+		pixels.push_back(pixel);
+	};
+
+	if (mJob.Settings->Order == TraversalOrder::Morton)
+	{
+		VisitMorton(x1 - x0, y1 - y0, add);
+		return;
+	}
+
+	for (int y = 0; y < y1 - y0; ++y)
+	{
+		for (int x = 0; x < x1 - x0; ++x)
+			add(x, y);
+	}
+}
+
+void CpuRenderer::ResolveTile(int x0, int y0, int x1, int y1)
+{
+	const AntiAliasSettings& aa = mJob.Settings->AntiAlias;
+
+	PixelList pixels{ ArenaAllocator<QueuedPixel>(*tTileArena) };
+	pixels.reserve((std::size_t)(x1 - x0) * (y1 - y0));
+
+	for (int y = y0; y < y1; ++y)
+	{
+		for (int x = x0; x < x1; ++x)
+		{
+			QueuedPixel pixel;
+			pixel.X = x;
+			pixel.Y = y;
+			pixel.Contrast = aa.Uniform ? 1e30f : Contrast(x, y);
+			if (pixel.Contrast > 1.0f)
+				pixels.push_back(pixel);
+		}
+	}
+
+	if (!aa.Uniform)
+	{
+		std::size_t budget = (std::size_t)std::max(aa.MaxSamplesPerTile, 0) / aa.Samples;
+		if (pixels.size() > budget)
+		{
+			std::nth_element(pixels.begin(), pixels.begin() + budget, pixels.end(),
+				[](const QueuedPixel& a, const QueuedPixel& b) { return a.Contrast > b.Contrast; });
+			pixels.resize(budget);
+		}
+	}
+
+	if (pixels.empty())
+		return;
+
+	// Edge samples vary wildly in length; ordering by the primary ray's step count
+	// keeps similar rays in the same packet so fewer lanes idle.
+	const CpuFramebuffer& target = *mJob.Target;
+	std::sort(pixels.begin(), pixels.end(), [&target](const QueuedPixel& a, const QueuedPixel& b)
+	{
+		return target.Steps[(std::size_t)a.Y * target.Width + a.X] < target.Steps[(std::size_t)b.Y * target.Width + b.X];
+	});
+
+	(this->*mJob.Resolve)(pixels);
+	mSupersampledPixels += pixels.size();
+	mRays += (std::uint64_t)pixels.size() * aa.Samples;
+}
+
+CpuRenderer::TileKernel CpuRenderer::SelectKernel(const FractalParams& params)
+{
+	return VisitFormula(params, [](auto tag)
+	{
+		typedef typename decltype(tag)::Type F;
+		return &CpuRenderer::RenderTileFormula<F>;
+	});
+}
+
+CpuRenderer::PixelKernel CpuRenderer::SelectResolveKernel(const FractalParams& params)
+{
+	return VisitFormula(params, [](auto tag)
+	{
+		typedef typename decltype(tag)::Type F;
+		return &CpuRenderer::ResolveFormula<F>;
+	});
+}
+
+template<typename F>
+void CpuRenderer::RenderTileFormula(int x0, int y0, int x1, int y1)
+{
+	const MarchKernel kernel = mJob.Settings->Kernel;
+
+	switch (mJob.Tier)
+	{
+	case Precision::Float:
+		if (kernel == MarchKernel::Wavefront)
+			RenderTileWavefront<F, float, 8>(x0, y0, x1, y1);
+		else if (kernel == MarchKernel::Packet)
+			RenderTilePacket<F, float, 8>(x0, y0, x1, y1);
+		else
+			RenderTileScalar<F, float>(x0, y0, x1, y1);
+		break;
+	case Precision::Double:
+		if (kernel == MarchKernel::Wavefront)
+			RenderTileWavefront<F, double, 4>(x0, y0, x1, y1);
+		else if (kernel == MarchKernel::Packet)
+			RenderTilePacket<F, double, 4>(x0, y0, x1, y1);
+		else
+			RenderTileScalar<F, double>(x0, y0, x1, y1);
+		break;
+	case Precision::DoubleDouble:
+		RenderTileScalar<F, DoubleDouble>(x0, y0, x1, y1);
+		break;
+	}
+}
+
+template<typename F, typename T, int N>
+void CpuRenderer::RenderTilePacket(int x0, int y0, int x1, int y1)
+{
+	const Vec3T<T> origin = ToVec<T>(mJob.Origin);
+
+	PixelList pixels{ ArenaAllocator<QueuedPixel>(*tTileArena) };
+	TilePixels(x0, y0, x1, y1, pixels);
+	const int count = (int)pixels.size();
+
+	T dx[N], dy[N], dz[N];
+	MarchResult results[N];
+	std::uint64_t laneEvaluations = 0;
+	std::uint64_t laneSlots = 0;
+
+	for (int first = 0; first < count; first += N)
+	{
+		// Lanes past the last pixel repeat it and are not written.
+		for (int l = 0; l < N; ++l)
+		{
+			const QueuedPixel& pixel = pixels[std::min(first + l, count - 1)];
+			Vec3d direction = PixelDirection(pixel.X + 0.5, pixel.Y + 0.5);
+			dx[l] = T(direction.x);
+			dy[l] = T(direction.y);
+			dz[l] = T(direction.z);
+		}
+
+		MarchPacket<F, T, N>(origin, dx, dy, dz, mJob.March, results);
+
+		// Every lane is evaluated until the slowest one finishes.
+		int packetSteps = 0;
+		for (int l = 0; l < N && first + l < count; ++l)
+		{
+			WritePixel(pixels[first + l].X, pixels[first + l].Y, results[l]);
+			laneEvaluations += results[l].Steps;
+			packetSteps = std::max(packetSteps, results[l].Steps);
+		}
+		laneSlots += (std::uint64_t)packetSteps * N;
+	}
+
+	mLaneEvaluations += laneEvaluations;
+	mLaneSlots += laneSlots;
+}
+
+template<typename F, typename T, int N>
+void CpuRenderer::RenderTileWavefront(int x0, int y0, int x1, int y1)
+{
+	const Vec3T<T> origin = ToVec<T>(mJob.Origin);
+
+	PixelList pixels{ ArenaAllocator<QueuedPixel>(*tTileArena) };
+	TilePixels(x0, y0, x1, y1, pixels);
+	const int count = (int)pixels.size();
+
+	RayQueue<T, ArenaAllocator<T>> rays{ ArenaAllocator<T>(*tTileArena) };
+	ArenaVector<MarchResult> results((std::size_t)count, MarchResult(), ArenaAllocator<MarchResult>(*tTileArena));
+	rays.Reserve(count + N);
+
+	for (int i = 0; i < count; ++i)
+	{
+		Vec3d direction = PixelDirection(pixels[i].X + 0.5, pixels[i].Y + 0.5);
+		rays.Push(origin, T(direction.x), T(direction.y), T(direction.z), i);
+	}
+
+	WavefrontStats stats = MarchWavefront<F, T, N>(rays, mJob.March, std::max(mJob.Settings->WavefrontSteps, 1), results.data());
+
+	for (int i = 0; i < count; ++i)
+		WritePixel(pixels[i].X, pixels[i].Y, results[i]);
+
+	mLaneEvaluations += stats.Evaluations;
+	mLaneSlots += stats.LaneSlots;
+}
+
+template<typename F, typename T>
+void CpuRenderer::RenderTileScalar(int x0, int y0, int x1, int y1)
+{
+	const Vec3T<T> origin = ToVec<T>(mJob.Origin);
+
+	for (int y = y0; y < y1; ++y)
+	{
+		for (int x = x0; x < x1; ++x)
+		{
+			Vec3T<T> direction = ToVec<T>(PixelDirection(x + 0.5, y + 0.5));
+			WritePixel(x, y, MarchFormula<F>(origin, direction, mJob.March));
+		}
+	}
+}
+
+CpuRenderer::TileKernel CpuRenderer::SelectLightKernel(const FractalParams& params)
+{
+	return VisitFormula(params, [](auto tag)
+	{
+		typedef typename decltype(tag)::Type F;
+		return &CpuRenderer::LightTileFormula<F>;
+	});
+}
+
+template<typename F>
+void CpuRenderer::LightTileFormula(int x0, int y0, int x1, int y1)
+{
+	switch (mJob.Tier)
+	{
+	case Precision::Float:
+		LightTile<F, float>(x0, y0, x1, y1);
+		break;
+	case Precision::Double:
+		LightTile<F, double>(x0, y0, x1, y1);
+		break;
+	case Precision::DoubleDouble:
+		LightTile<F, DoubleDouble>(x0, y0, x1, y1);
+		break;
+	}
+}
+
+template<typename F, typename T>
+void CpuRenderer::LightTile(int x0, int y0, int x1, int y1)
+{
+	const RenderSettings& settings = *mJob.Settings;
+	const LightingSettings& lighting = settings.Lighting;
+	CpuFramebuffer& target = *mJob.Target;
+
+	const Vec3d light = Normalize(Vec3d(lighting.LightDirection));
+	const Vec3T<T> origin = ToVec<T>(mJob.Origin);
+	const Vec3T<T> towardsLight = ToVec<T>(light);
+
+	std::uint64_t shadowRays = 0;
+	std::uint64_t shadowEvaluations = 0;
+
+	for (int y = y0; y < y1; ++y)
+	{
+		for (int x = x0; x < x1; ++x)
+		{
+			std::size_t index = (std::size_t)y * target.Width + x;
+			float depth = target.Depth[index];
+			if (depth >= settings.March.MaxDistance)
+				continue;
+
+			Vec3d direction = PixelDirection(x + 0.5, y + 0.5);
+			Vec3d normal = DepthNormal(x, y, direction);
+			double diffuse = std::max(Dot(normal, light), 0.0);
+
+			// Crevices take the march many small steps, so the step count doubles as occlusion.
+			double ao = lighting.AmbientOcclusion ? 1.0 - std::min(target.Steps[index] / (double)lighting.AoSteps, 1.0) : 1.0;
+
+			// Surfaces facing away from the light need no shadow ray.
+			double shadow = 1.0;
+			if (lighting.Shadows && diffuse > 0.0)
+			{
+				// Start a few hit thresholds off the surface along the normal.
+				double epsilon = mJob.March.PixelAngle > 0.0 ? depth * mJob.March.PixelAngle : mJob.March.Epsilon;
+				ShadowParams params = lighting.Shadow;
+				params.MinStep = std::max(params.MinStep, 2.0 * epsilon);
+
+				Vec3T<T> surface = origin + ToVec<T>(direction * (double)depth + normal * (4.0 * epsilon));
+				int steps = 0;
+				shadow = (double)SoftShadowFormula<F>(surface, towardsLight, mJob.March.Fractal, params, steps);
+
+				++shadowRays;
+				shadowEvaluations += steps;
+			}
+
+			float lit = (float)(lighting.Ambient * ao + (1.0 - lighting.Ambient) * diffuse * shadow);
+			mLight[index] = lit;
+
+			std::uint32_t color = target.Color[index];
+			target.Color[index] = PackColor(Channel(color, 0) * lit, Channel(color, 1) * lit, Channel(color, 2) * lit, Channel(color, 3));
+		}
+	}
+
+	mShadowRays += shadowRays;
+	mShadowEvaluations += shadowEvaluations;
+	mDistanceEvaluations += shadowEvaluations;
+}
+
+// Surface normal from the positions of neighbouring pixels. On each axis the
+// neighbour closer in depth is used so normals do not bend across silhouettes.
+Vec3d CpuRenderer::DepthNormal(int x, int y, const Vec3d& direction) const
+{
+	const CpuFramebuffer& target = *mJob.Target;
+	const float maxDistance = mJob.Settings->March.MaxDistance;
+	const float depth = target.Depth[(std::size_t)y * target.Width + x];
+	const Vec3d position = direction * (double)depth;
+
+	// Offset to the better neighbour along one axis, pointing in +x or +y.
+	auto tangent = [&](int dx, int dy, Vec3d& out)
+	{
+		float best = FLT_MAX;
+		for (int side = -1; side <= 1; side += 2)
+		{
+			int nx = x + side * dx;
+			int ny = y + side * dy;
+			if (nx < 0 || ny < 0 || nx >= target.Width || ny >= target.Height)
+				continue;
+
+			float other = target.Depth[(std::size_t)ny * target.Width + nx];
+			if (other >= maxDistance || std::fabs(other - depth) >= best)
+				continue;
+
+			best = std::fabs(other - depth);
+			out = (PixelDirection(nx + 0.5, ny + 0.5) * (double)other - position) * (double)side;
+		}
+		return best < FLT_MAX;
+	};
+
+	Vec3d du, dv;
+	if (!tangent(1, 0, du) || !tangent(0, 1, dv))
+		return -direction;
+
+	Vec3d normal = Cross(du, dv);
+	double length = Length(normal);
+	if (length <= 0.0)
+		return -direction;
+
+	normal = normal / length;
+	return Dot(normal, direction) > 0.0 ? -normal : normal;
+}
+
+CpuRenderer::PixelKernel CpuRenderer::SelectRemarchKernel(const FractalParams& params)
+{
+	return VisitFormula(params, [](auto tag)
+	{
+		typedef typename decltype(tag)::Type F;
+		return &CpuRenderer::RemarchFormula<F>;
+	});
+}
+
+// Re-marched pixels are scattered, so wavefronts use packets here.
+template<typename F>
+void CpuRenderer::RemarchFormula(const PixelList& pixels)
+{
+	const bool scalar = mJob.Settings->Kernel == MarchKernel::Scalar;
+
+	switch (mJob.Tier)
+	{
+	case Precision::Float:
+		if (scalar)
+			RemarchScalar<F, float>(pixels);
+		else
+			RemarchPacket<F, float, 8>(pixels);
+		break;
+	case Precision::Double:
+		if (scalar)
+			RemarchScalar<F, double>(pixels);
+		else
+			RemarchPacket<F, double, 4>(pixels);
+		break;
+	case Precision::DoubleDouble:
+		RemarchScalar<F, DoubleDouble>(pixels);
+		break;
+	}
+}
+
+// Centre rays through a list of pixels, written like a primary ray.
+template<typename F, typename T, int N>
+void CpuRenderer::RemarchPacket(const PixelList& pixels)
+{
+	const int count = (int)pixels.size();
+	const Vec3T<T> origin = ToVec<T>(mJob.Origin);
+	std::uint64_t evaluations = 0;
+
+	T dx[N], dy[N], dz[N];
+	MarchResult results[N];
+
+	for (int first = 0; first < count; first += N)
+	{
+		for (int l = 0; l < N; ++l)
+		{
+			const QueuedPixel& pixel = pixels[std::min(first + l, count - 1)];
+			Vec3d direction = PixelDirection(pixel.X + 0.5, pixel.Y + 0.5);
+			dx[l] = T(direction.x);
+			dy[l] = T(direction.y);
+			dz[l] = T(direction.z);
+		}
+
+		MarchPacket<F, T, N>(origin, dx, dy, dz, mJob.March, results);
+
+		for (int l = 0; l < N && first + l < count; ++l)
+		{
+			WritePixel(pixels[first + l].X, pixels[first + l].Y, results[l]);
+			evaluations += results[l].Steps;
+		}
+	}
+
+	mDistanceEvaluations += evaluations;
+}
+
+template<typename F, typename T>
+void CpuRenderer::RemarchScalar(const PixelList& pixels)
+{
+	const Vec3T<T> origin = ToVec<T>(mJob.Origin);
+	std::uint64_t evaluations = 0;
+
+	for (const QueuedPixel& pixel : pixels)
+	{
+		MarchResult result = MarchFormula<F>(origin, ToVec<T>(PixelDirection(pixel.X + 0.5, pixel.Y + 0.5)), mJob.March);
+		WritePixel(pixel.X, pixel.Y, result);
+		evaluations += result.Steps;
+	}
+
+	mDistanceEvaluations += evaluations;
+}
+
+template<typename F>
+void CpuRenderer::ResolveFormula(const PixelList& pixels)
+{
+	const bool scalar = mJob.Settings->Kernel == MarchKernel::Scalar;
+
+	switch (mJob.Tier)
+	{
+	case Precision::Float:
+		if (scalar)
+			ResolveScalar<F, float>(pixels);
+		else
+			ResolvePacket<F, float, 8>(pixels);
+		break;
+	case Precision::Double:
+		if (scalar)
+			ResolveScalar<F, double>(pixels);
+		else
+			ResolvePacket<F, double, 4>(pixels);
+		break;
+	case Precision::DoubleDouble:
+		ResolveScalar<F, DoubleDouble>(pixels);
+		break;
+	}
+}
+
+// Packets hold consecutive samples of the flattened (pixel, sample) list, so a
+// packet may span pixels; each lane adds its shaded colour to its own pixel.
+template<typename F, typename T, int N>
+void CpuRenderer::ResolvePacket(const PixelList& pixels)
+{
+	const int samples = mJob.Settings->AntiAlias.Samples;
+	const int total = (int)pixels.size() * samples;
+	const Vec3T<T> origin = ToVec<T>(mJob.Origin);
+
+	T dx[N], dy[N], dz[N];
+	MarchResult results[N];
+
+	float sum[4] = {};
+	std::uint64_t evaluations = 0;
+
+	for (int first = 0; first < total; first += N)
+	{
+		for (int l = 0; l < N; ++l)
+		{
+			int i = std::min(first + l, total - 1);
+			const QueuedPixel& pixel = pixels[i / samples];
+			Vec3d direction = SampleDirection(pixel.X, pixel.Y, i % samples);
+			dx[l] = T(direction.x);
+			dy[l] = T(direction.y);
+			dz[l] = T(direction.z);
+		}
+
+		MarchPacket<F, T, N>(origin, dx, dy, dz, mJob.March, results);
+
+		for (int l = 0; l < N && first + l < total; ++l)
+		{
+			int i = first + l;
+			float rgba[4];
+			Shade(results[l], rgba);
+			for (int c = 0; c < 4; ++c)
+				sum[c] += rgba[c];
+			evaluations += results[l].Steps;
+
+			if (i % samples == samples - 1)
+			{
+				ResolvePixel(pixels[i / samples], sum, samples);
+				std::fill(sum, sum + 4, 0.0f);
+			}
+		}
+	}
+
+	mDistanceEvaluations += evaluations;
+}
+
+template<typename F, typename T>
+void CpuRenderer::ResolveScalar(const PixelList& pixels)
+{
+	const int samples = mJob.Settings->AntiAlias.Samples;
+	const Vec3T<T> origin = ToVec<T>(mJob.Origin);
+	std::uint64_t evaluations = 0;
+
+	for (const QueuedPixel& pixel : pixels)
+	{
+		float sum[4] = {};
+		for (int sample = 0; sample < samples; ++sample)
+		{
+			MarchResult result = MarchFormula<F>(origin, ToVec<T>(SampleDirection(pixel.X, pixel.Y, sample)), mJob.March);
+			float rgba[4];
+			Shade(result, rgba);
+			for (int c = 0; c < 4; ++c)
+				sum[c] += rgba[c];
+			evaluations += result.Steps;
+		}
+		ResolvePixel(pixel, sum, samples);
+	}
+
+	mDistanceEvaluations += evaluations;
+}
+
+// Averages the jittered samples with the primary ray through the centre.
+void CpuRenderer::ResolvePixel(const QueuedPixel& pixel, const float sum[4], int rays)
+{
+	CpuFramebuffer& target = *mJob.Target;
+	std::size_t index = (std::size_t)pixel.Y * target.Width + pixel.X;
+
+	// Samples are lit like the pixel centre; the primary colour already is.
+	float lit = mJob.Settings->Lighting.Enabled() ? mLight[index] : 1.0f;
+
+	float scale = 1.0f / (rays + 1);
+	std::uint32_t primary = mPrimaryColor[index];
+	target.Color[index] = PackColor(
+		(sum[0] * lit + Channel(primary, 0)) * scale,
+		(sum[1] * lit + Channel(primary, 1)) * scale,
+		(sum[2] * lit + Channel(primary, 2)) * scale,
+		(sum[3] + Channel(primary, 3)) * scale);
+	target.Samples[index] = (std::uint8_t)std::min(rays + 1, 255);
+}
+
+Vec3d CpuRenderer::PixelDirection(double x, double y) const
+{
+	double ndcX = 2.0 * (mJob.OffsetX + x * mJob.PixelScale) / mJob.OutputWidth - 1.0;
+	double ndcY = 1.0 - 2.0 * (mJob.OffsetY + y * mJob.PixelScale) / mJob.OutputHeight;
+
+	return Normalize(
+		mJob.Forward
+		+ mJob.Right * (ndcX * mJob.TanHalfFovY * mJob.AspectRatio)
+		+ mJob.Up * (ndcY * mJob.TanHalfFovY));
+}
+
+// Stratified within the pixel: the first samples of a scrambled Sobol sequence,
+// with a scramble drawn per pixel so neighbouring pixels use different patterns.
+Vec3d CpuRenderer::SampleDirection(int x, int y, int sample) const
+{
+	// Keyed by the output pixel, so regions of an image jitter like the whole image.
+	std::uint64_t pixel = (std::uint64_t)(mJob.OffsetY + y) * mJob.OutputWidth + (mJob.OffsetX + x);
+	std::uint32_t scramble = RandomStream(mJob.Settings->AntiAlias.Seed, pixel).NextUInt();
+
+	float jx, jy;
+	Random::Sobol2((std::uint32_t)sample, scramble, jx, jy);
+	return PixelDirection(x + (double)jx, y + (double)jy);
+}
+
+// Same shading as Shade in shaders/SceneInfo.hlsli, before packing.
+void CpuRenderer::Shade(const MarchResult& result, float rgba[4]) const
+{
+	const RenderSettings& settings = *mJob.Settings;
+
+	float r = 0.0f, g = 0.0f, b = 0.0f;
+	if (result.Hit)
+	{
+		float colourB = Saturate((float)result.Iterations / (float)settings.March.Fractal.MaxIterations);
+		r = Saturate(colourB * settings.Color.x);
+		g = Saturate(colourB * settings.Color.y);
+		b = Saturate(colourB * settings.Color.z);
+	}
+
+	float rim = (float)result.Steps / settings.Darkness;
+	rgba[0] = Saturate((r + settings.Color.x) * rim);
+	rgba[1] = Saturate((g + settings.Color.y) * rim);
+	rgba[2] = Saturate((b + settings.Color.z) * rim);
+	rgba[3] = Saturate(rim + rim);
+}
+
+void CpuRenderer::WritePixel(int x, int y, const MarchResult& result)
+{
+	const RenderSettings& settings = *mJob.Settings;
+	CpuFramebuffer& target = *mJob.Target;
+	std::size_t index = (std::size_t)y * target.Width + x;
+
+	float rgba[4];
+	Shade(result, rgba);
+	target.Color[index] = PackColor(rgba[0], rgba[1], rgba[2], rgba[3]);
+
+	target.Depth[index] = result.Hit ? (float)result.Distance : settings.March.MaxDistance;
+	target.Iterations[index] = (std::uint8_t)std::min(result.Iterations, 255);
+	target.Steps[index] = (std::uint16_t)std::min(result.Steps, 65535);
+	target.Samples[index] = 1;
+}
\ No newline at end of file
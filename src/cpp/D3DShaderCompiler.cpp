@@ -0,0 +1,115 @@
+#include "D3DShaderCompiler.h"
+#include <cstring>
+#include <filesystem>
+#include <map>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	bool ReadFile(const std::string& path, std::string& contents)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		std::ostringstream stream;
+		stream << file.rdbuf();
+		contents = stream.str();
+		return true;
+	}
+
+	class RecordingInclude : public ID3DInclude
+	{
+	public:
+		RecordingInclude(const std::string& sourcePath, std::vector<std::string>& files) :
+			mSourceDirectory(std::filesystem::path(sourcePath).parent_path().generic_string()),
+			mFiles(files)
+		{
+		}
+
+		HRESULT __stdcall Open(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes) override
+		{
+			auto parent = mOpened.find(parentData);
+			std::string directory = parent != mOpened.end() ? parent->second.Directory : mSourceDirectory;
+			std::string path = (std::filesystem::path(directory) / fileName).lexically_normal().generic_string();
+
+			std::string contents;
+			if (!ReadFile(path, contents))
+				return E_FAIL;
+
+			char* buffer = new char[contents.size() + 1];
+			std::memcpy(buffer, contents.c_str(), contents.size() + 1);
+
+			mOpened[buffer] = { std::filesystem::path(path).parent_path().generic_string() };
+			mFiles.push_back(path);
+
+			*data = buffer;
+			*bytes = (UINT)contents.size();
+			return S_OK;
+		}
+
+		HRESULT __stdcall Close(LPCVOID data) override
+		{
+			mOpened.erase(data);
+			delete[] (const char*)data;
+			return S_OK;
+		}
+
+	private:
+		struct OpenFile
+		{
+			std::string Directory;
+		};
+
+		std::string mSourceDirectory;
+		std::vector<std::string>& mFiles;
+		std::map<LPCVOID, OpenFile> mOpened;
+	};
+}
+
+bool D3DShaderCompiler::Compile(const ShaderRequest& request, ShaderBytecode& bytecode, std::vector<std::string>& includes, std::string& errors)
+{
+	std::string source;
+	if (!ReadFile(request.Path, source))
+	{
+		errors = "cannot read " + request.Path;
+		return false;
+	}
+
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const ShaderDefine& define : request.Defines)
+		macros.push_back({ define.Name.c_str(), define.Value.c_str() });
+	macros.push_back({ nullptr, nullptr });
+
+	RecordingInclude include(request.Path, includes);
+
+	ComPtr<ID3DBlob> byteCode;
+	ComPtr<ID3DBlob> errorBlob;
+	HRESULT hr = D3DCompile(
+		source.data(),
+		source.size(),
+		request.Path.c_str(),
+		macros.data(),
+		&include,
+		request.EntryPoint.c_str(),
+		request.Target.c_str(),
+		request.Flags,
+		0,
+		&byteCode,
+		&errorBlob
+	);
+
+	if (errorBlob != nullptr)
+	{
+		errors.assign((const char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize());
+		OutputDebugStringA(errors.c_str());
+	}
+
+	if (FAILED(hr))
+		return false;
+
+	const std::uint8_t* data = (const std::uint8_t*)byteCode->GetBufferPointer();
+	bytecode.assign(data, data + byteCode->GetBufferSize());
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,263 @@
+#include "Fractal.h"
+#include "Hybrid.h"
+#include <cmath>
+
+namespace
+{
+	// For z -> z^n + c every orbit that enters the ball |z| <= R with R^n + |c| <= R stays there.
+	// R* = (1/n)^(1/(n-1)) maximizes R - R^n, so |c| <= R* - R*^n admits the largest ball.
+	struct InteriorBound
+	{
+		bool Enabled = false;
+		bool Periodicity = false;
+		float Radius = 0.0f;
+		float MaxC = 0.0f;
+	};
+
+	InteriorBound MakeInteriorBound(const FractalParams& params)
+	{
+		InteriorBound bound;
+		if (!params.InteriorDetection || params.Power <= 1.0f)
+			return bound;
+
+		bound.Enabled = true;
+		bound.Periodicity = params.PeriodicityCheck;
+		bound.Radius = powf(1.0f / params.Power, 1.0f / (params.Power - 1.0f));
+		bound.MaxC = bound.Radius - powf(bound.Radius, params.Power);
+		return bound;
+	}
+
+	// Interior points report the full iteration count so colouring matches an undetected run.
+	SceneSample InteriorSample(const FractalParams& params, int iterations, int* iterationsSaved)
+	{
+		if (iterationsSaved != nullptr)
+			*iterationsSaved = params.MaxIterations - iterations;
+
+		SceneSample sample;
+		sample.Iterations = params.MaxIterations;
+		sample.Distance = 0.0f;
+		sample.Interior = true;
+		return sample;
+	}
+
+	// Other formulas and hybrids run the renderer's kernel, without interior detection.
+	typedef float (*DistanceFunction)(const Vec3f& position, const FractalParams& params, int& iterations);
+
+	template<typename F>
+	float FormulaDistance(const Vec3f& position, const FractalParams& params, int& iterations)
+	{
+		return F::Distance(position, params, iterations);
+	}
+
+	// Null for the plain Mandelbulb, which Evaluate iterates itself.
+	DistanceFunction SelectDistance(const FractalParams& params)
+	{
+		if (params.Formula == FractalFormula::Mandelbulb && params.Hybrid == HybridPattern::None)
+			return nullptr;
+
+		return VisitFormula(params, [](auto tag)
+		{
+			typedef typename decltype(tag)::Type F;
+			return &FormulaDistance<F>;
+		});
+	}
+
+	SceneSample Evaluate(const Vec3f& position, const FractalParams& params, const InteriorBound& bound, DistanceFunction distance, int* iterationsSaved)
+	{
+		if (distance != nullptr)
+		{
+			if (iterationsSaved != nullptr)
+				*iterationsSaved = 0;
+
+			SceneSample sample;
+			sample.Distance = distance(position, params, sample.Iterations);
+			return sample;
+		}
+
+		FormulaState<float> s;
+		Mandelbulb::Init(s, position, params);
+		int iterations = 0;
+
+		float cLength = bound.Enabled ? Length(position) : 0.0f;
+		Vec3f checkpoint = position;
+		int checkpointPeriod = 1;
+		int checkpointAge = 0;
+
+		// Mandelbulb::Distance with the interior tests between its steps.
+		for (int i = 0; i < params.MaxIterations; i++)
+		{
+			++iterations;
+			s.r = sqrtf(s.x * s.x + s.y * s.y + s.z * s.z + s.w * s.w);
+
+			if (s.r > params.Bailout) break;
+
+			float zr = FormulaDetail::PowerStep(s, position, params);
+
+			if (bound.Enabled)
+			{
+				bool trapped = (s.r <= bound.Radius && cLength <= bound.MaxC)
+					|| (s.r >= cLength && zr + cLength <= s.r);
+
+				if (trapped)
+					return InteriorSample(params, iterations, iterationsSaved);
+			}
+
+			if (bound.Periodicity)
+			{
+				// Brent's cycle detection: compare against a checkpoint refreshed at doubling intervals.
+				Vec3f delta = Vec3f(s.x, s.y, s.z) - checkpoint;
+				if (Dot(delta, delta) < params.PeriodicityEpsilon * params.PeriodicityEpsilon)
+					return InteriorSample(params, iterations, iterationsSaved);
+
+				if (++checkpointAge == checkpointPeriod)
+				{
+					checkpoint = Vec3f(s.x, s.y, s.z);
+					checkpointAge = 0;
+					checkpointPeriod *= 2;
+				}
+			}
+		}
+
+		if (iterationsSaved != nullptr)
+			*iterationsSaved = 0;
+
+		SceneSample sample;
+		sample.Iterations = iterations;
+		sample.Distance = Mandelbulb::Estimate(s, params);
+		sample.Interior = false;
+		return sample;
+	}
+}
+
+const char* FormulaName(FractalFormula formula)
+{
+	switch (formula)
+	{
+	case FractalFormula::Mandelbulb: return "mandelbulb";
+	case FractalFormula::Mandelbox: return "mandelbox";
+	case FractalFormula::Juliabulb: return "juliabulb";
+	case FractalFormula::QuaternionJulia: return "quaternion-julia";
+	case FractalFormula::KaleidoscopicIFS: return "kifs";
+	}
+	return "unknown";
+}
+
+const char* HybridPatternName(HybridPattern pattern)
+{
+	switch (pattern)
+	{
+	case HybridPattern::None: return "none";
+	case HybridPattern::Alternate: return "alternate";
+	case HybridPattern::Prefix: return "prefix";
+	}
+	return "unknown";
+}
+
+FractalParams FractalParams::Defaults(FractalFormula formula)
+{
+	FractalParams params;
+	params.Formula = formula;
+
+	switch (formula)
+	{
+	case FractalFormula::Mandelbox:
+		params.MaxIterations = 12;
+		params.Bailout = 100.0f;
+		break;
+	case FractalFormula::QuaternionJulia:
+		params.JuliaC = Vec3f(-0.2f, 0.6f, 0.2f);
+		params.JuliaW = 0.2f;
+		params.Bailout = 4.0f;
+		break;
+	case FractalFormula::KaleidoscopicIFS:
+		params.MaxIterations = 12;
+		params.Bailout = 100.0f;
+		break;
+	default:
+		break;
+	}
+
+	return params;
+}
+
+void SceneQueryStats::Add(const SceneQueryStats& other)
+{
+	Samples += other.Samples;
+	InteriorSamples += other.InteriorSamples;
+	Iterations += other.Iterations;
+	IterationsSaved += other.IterationsSaved;
+}
+
+SceneSample Fractal::SceneInfo(const Vec3f& position, const FractalParams& params, int* iterationsSaved)
+{
+	return Evaluate(position, params, MakeInteriorBound(params), SelectDistance(params), iterationsSaved);
+}
+
+void Fractal::SceneInfoBulk(
+	const Vec3f* positions,
+	std::size_t count,
+	const FractalParams& params,
+	SceneSample* results,
+	SceneQueryStats* stats)
+{
+	InteriorBound bound = MakeInteriorBound(params);
+	DistanceFunction distance = SelectDistance(params);
+	SceneQueryStats local;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		int saved = 0;
+		results[i] = Evaluate(positions[i], params, bound, distance, &saved);
+
+		local.Iterations += results[i].Iterations - saved;
+		local.IterationsSaved += saved;
+		if (results[i].Interior)
+			++local.InteriorSamples;
+	}
+	local.Samples = count;
+
+	if (stats != nullptr)
+		stats->Add(local);
+}
+
+void Fractal::SceneInfoGrid(
+	const Vec3f& minCorner,
+	const Vec3f& maxCorner,
+	int resolutionX, int resolutionY, int resolutionZ,
+	const FractalParams& params,
+	SceneSample* results,
+	SceneQueryStats* stats)
+{
+	InteriorBound bound = MakeInteriorBound(params);
+	DistanceFunction distance = SelectDistance(params);
+	SceneQueryStats local;
+
+	Vec3f extent = maxCorner - minCorner;
+	float sx = resolutionX > 1 ? extent.x / (resolutionX - 1) : 0.0f;
+	float sy = resolutionY > 1 ? extent.y / (resolutionY - 1) : 0.0f;
+	float sz = resolutionZ > 1 ? extent.z / (resolutionZ - 1) : 0.0f;
+
+	std::size_t index = 0;
+	for (int k = 0; k < resolutionZ; ++k)
+	{
+		for (int j = 0; j < resolutionY; ++j)
+		{
+			for (int i = 0; i < resolutionX; ++i, ++index)
+			{
+				Vec3f p(minCorner.x + i * sx, minCorner.y + j * sy, minCorner.z + k * sz);
+
+				int saved = 0;
+				results[index] = Evaluate(p, params, bound, distance, &saved);
+
+				local.Iterations += results[index].Iterations - saved;
+				local.IterationsSaved += saved;
+				if (results[index].Interior)
+					++local.InteriorSamples;
+			}
+		}
+	}
+	local.Samples = index;
+
+	if (stats != nullptr)
+		stats->Add(local);
+}
\ No newline at end of file
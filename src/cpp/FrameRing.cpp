@@ -0,0 +1,124 @@
+#include "FrameRing.h"
+#include "Futex.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+FrameRingBase::FrameRingBase(int depth, int stageCount) :
+	mDepth(std::max(depth, 1)),
+	mStageCount(std::max(stageCount, 1)),
+	mStages(new Stage[std::max(stageCount, 1)])
+{
+}
+
+int FrameRingBase::Depth() const
+{
+	return mDepth;
+}
+
+int FrameRingBase::StageCount() const
+{
+	return mStageCount;
+}
+
+bool FrameRingBase::Ready(int stage, std::uint32_t frame) const
+{
+	// Counters wrap, so compare differences.
+	if (stage == 0)
+		return frame - mStages[mStageCount - 1].Completed.load() < (std::uint32_t)mDepth;
+
+	return (std::int32_t)(mStages[stage - 1].Completed.load() - frame) > 0;
+}
+
+bool FrameRingBase::Stopped(int stage, std::uint32_t frame) const
+{
+	if (!mClosed)
+		return false;
+	return stage == 0 || (std::int32_t)(frame - mEnd.load()) >= 0;
+}
+
+bool FrameRingBase::Begin(int stage, std::uint32_t frame)
+{
+	Stage& self = mStages[stage];
+	Stage& upstream = mStages[stage == 0 ? mStageCount - 1 : stage - 1];
+
+	if (!Ready(stage, frame) && !Stopped(stage, frame))
+	{
+		auto start = std::chrono::steady_clock::now();
+		++self.Waits;
+
+		// Handoffs are usually close; spin briefly before sleeping.
+		for (int spin = 0; spin < 256 && !Ready(stage, frame) && !Stopped(stage, frame); ++spin)
+			std::this_thread::yield();
+
+		while (!Ready(stage, frame) && !Stopped(stage, frame))
+		{
+			std::uint32_t sequence = upstream.Sequence.load();
+			upstream.Waiters.fetch_add(1);
+			if (!Ready(stage, frame) && !Stopped(stage, frame))
+				Futex::Wait(upstream.Sequence, sequence);
+			upstream.Waiters.fetch_sub(1);
+		}
+
+		self.StallNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	if (Stopped(stage, frame))
+		return false;
+
+	++self.Frames;
+	if (stage == 0)
+	{
+		int inFlight = (int)(frame - mStages[mStageCount - 1].Completed.load()) + 1;
+		mInFlightSum += inFlight;
+		mInFlightMax = std::max(mInFlightMax, inFlight);
+	}
+	return true;
+}
+
+void FrameRingBase::End(int stage, std::uint32_t frame)
+{
+	Stage& self = mStages[stage];
+	self.Completed.store(frame + 1);
+	self.Sequence.fetch_add(1);
+
+	if (self.Waiters.load() > 0)
+		Futex::WakeAll(self.Sequence);
+}
+
+void FrameRingBase::Close()
+{
+	mEnd = mStages[0].Completed.load();
+	mClosed = true;
+	for (int i = 0; i < mStageCount; ++i)
+	{
+		mStages[i].Sequence.fetch_add(1);
+		Futex::WakeAll(mStages[i].Sequence);
+	}
+}
+
+FrameRingStageStats FrameRingBase::Stats(int stage) const
+{
+	const Stage& s = mStages[stage];
+
+	FrameRingStageStats stats;
+	stats.Frames = s.Frames;
+	stats.Waits = s.Waits;
+	stats.StallMs = s.StallNs / 1e6;
+	return stats;
+}
+
+int FrameRingBase::InFlight() const
+{
+	return (int)(mStages[0].Completed.load() - mStages[mStageCount - 1].Completed.load());
+}
+
+double FrameRingBase::AverageInFlight() const
+{
+	return mStages[0].Frames > 0 ? (double)mInFlightSum / mStages[0].Frames : 0.0;
+}
+
+int FrameRingBase::MaxInFlight() const
+{
+	return mInFlightMax;
+}
\ No newline at end of file
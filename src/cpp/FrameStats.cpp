@@ -0,0 +1,468 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <cerrno>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+	typedef SOCKET SocketHandle;
+	const SocketHandle NoSocket = INVALID_SOCKET;
+
+	const int SendFlags = 0;
+
+	void CloseSocket(SocketHandle s) { closesocket(s); }
+	void EndSockets() { WSACleanup(); }
+	int ProcessId() { return (int)GetCurrentProcessId(); }
+
+	void SetSendTimeout(SocketHandle s, int timeoutMs)
+	{
+		DWORD timeout = (DWORD)timeoutMs;
+		setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+	}
+
+	bool SendTimedOut() { return WSAGetLastError() == WSAETIMEDOUT; }
+
+	// Unix sockets are reparse points; anything else at the path is left alone.
+	void RemoveStaleSocket(const std::string& path)
+	{
+		DWORD attributes = GetFileAttributesA(path.c_str());
+		if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0)
+			DeleteFileA(path.c_str());
+	}
+#else
+	typedef int SocketHandle;
+	const SocketHandle NoSocket = -1;
+
+	// A client that disconnects mid-reply must not raise SIGPIPE and end the process.
+#ifdef MSG_NOSIGNAL
+	const int SendFlags = MSG_NOSIGNAL;
+#else
+	const int SendFlags = 0;
+#endif
+
+	void CloseSocket(SocketHandle s) { close(s); }
+	void EndSockets() {}
+	int ProcessId() { return (int)getpid(); }
+
+	void SetSendTimeout(SocketHandle s, int timeoutMs)
+	{
+		timeval timeout = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+		setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	}
+
+	bool SendTimedOut() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+
+	void RemoveStaleSocket(const std::string& path)
+	{
+		struct stat info;
+		if (lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+			unlink(path.c_str());
+	}
+#endif
+
+	// Memory is sampled every few frames; reading it is a system call.
+	const std::uint64_t MemorySampleInterval = 30;
+
+	StatSummary Summarize(std::vector<double> values)
+	{
+		StatSummary summary;
+		if (values.empty())
+			return summary;
+
+		std::sort(values.begin(), values.end());
+
+		double sum = 0.0;
+		for (double v : values)
+			sum += v;
+
+		auto percentile = [&](double p)
+		{
+			return values[std::min(values.size() - 1, (std::size_t)(p * (values.size() - 1) + 0.5))];
+		};
+
+		summary.Mean = sum / values.size();
+		summary.P50 = percentile(0.50);
+		summary.P95 = percentile(0.95);
+		summary.P99 = percentile(0.99);
+		summary.Max = values.back();
+		return summary;
+	}
+
+	void AppendJson(std::string& out, const char* name, const StatSummary& s)
+	{
+		char buffer[256];
+		std::snprintf(buffer, sizeof(buffer), "\"%s\":{\"mean\":%.4f,\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f}",
+			name, s.Mean, s.P50, s.P95, s.P99, s.Max);
+		out += buffer;
+	}
+
+	bool WriteFile(const std::string& path, const std::string& text)
+	{
+		std::FILE* file = std::fopen(path.c_str(), "w");
+		if (file == nullptr)
+			return false;
+
+		bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+		return std::fclose(file) == 0 && ok;
+	}
+}
+
+FrameStats::FrameStats(int windowFrames) :
+	mWindowFrames((std::size_t)std::max(windowFrames, 1)),
+	mCreated(Clock::now())
+{
+	mWindow.reserve(mWindowFrames);
+}
+
+FrameStats::~FrameStats()
+{
+	StopServer();
+}
+
+int FrameStats::Stage(const char* name)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for (std::size_t i = 0; i < mStageNames.size(); ++i)
+	{
+		if (mStageNames[i] == name)
+			return (int)i;
+	}
+
+	mStageNames.push_back(name);
+	return (int)mStageNames.size() - 1;
+}
+
+void FrameStats::BeginFrame()
+{
+	std::size_t stageCount;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		stageCount = mStageNames.size();
+	}
+
+	std::uint64_t memory = mCurrent.MemoryBytes;
+	mCurrent = FrameSample();
+	mCurrent.Frame = mFrameIndex;
+	mCurrent.StageMs.assign(stageCount, 0.0);
+	mCurrent.MemoryBytes = memory;
+	mFrameStart = Clock::now();
+}
+
+void FrameStats::AddStageTime(int stage, double ms)
+{
+	if (stage < 0)
+		return;
+	if ((std::size_t)stage >= mCurrent.StageMs.size())
+		mCurrent.StageMs.resize(stage + 1, 0.0);
+	mCurrent.StageMs[stage] += ms;
+}
+
+void FrameStats::AddRays(std::uint64_t rays)
+{
+	mCurrent.Rays += rays;
+}
+
+void FrameStats::AddDistanceEvaluations(std::uint64_t evaluations)
+{
+	mCurrent.DistanceEvaluations += evaluations;
+}
+
+void FrameStats::EndFrame()
+{
+	Clock::time_point now = Clock::now();
+	mCurrent.FrameMs = std::chrono::duration<double, std::milli>(now - mFrameStart).count();
+	mCurrent.Time = std::chrono::duration<double>(now - mCreated).count();
+
+	if (mFrameIndex % MemorySampleInterval == 0)
+		mCurrent.MemoryBytes = CurrentMemoryUsage();
+	++mFrameIndex;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mWindow.size() < mWindowFrames)
+		mWindow.push_back(mCurrent);
+	else
+		mWindow[mNext] = mCurrent;
+	mNext = (mNext + 1) % mWindowFrames;
+}
+
+FrameStatsSummary FrameStats::Summarize() const
+{
+	std::vector<FrameSample> window;
+	FrameStatsSummary summary;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		window = mWindow;
+		summary.StageNames = mStageNames;
+	}
+
+	summary.Frames = (int)window.size();
+	if (window.empty())
+		return summary;
+
+	double first = window[0].Time - window[0].FrameMs / 1000.0;
+	double last = window[0].Time;
+	std::uint64_t latestFrame = window[0].Frame;
+
+	std::vector<double> frameMs, rays, evaluations;
+	std::vector<std::vector<double>> stageMs(summary.StageNames.size());
+
+	for (const FrameSample& sample : window)
+	{
+		frameMs.push_back(sample.FrameMs);
+		rays.push_back((double)sample.Rays);
+		evaluations.push_back((double)sample.DistanceEvaluations);
+		for (std::size_t i = 0; i < stageMs.size(); ++i)
+			stageMs[i].push_back(i < sample.StageMs.size() ? sample.StageMs[i] : 0.0);
+
+		first = std::min(first, sample.Time - sample.FrameMs / 1000.0);
+		last = std::max(last, sample.Time);
+		if (sample.Frame >= latestFrame)
+		{
+			latestFrame = sample.Frame;
+			summary.MemoryBytes = sample.MemoryBytes;
+		}
+	}
+
+	summary.Seconds = last - first;
+	summary.Fps = summary.Seconds > 0.0 ? window.size() / summary.Seconds : 0.0;
+	summary.FrameMs = ::Summarize(frameMs);
+	summary.Rays = ::Summarize(rays);
+	summary.DistanceEvaluations = ::Summarize(evaluations);
+	for (auto& values : stageMs)
+		summary.StageMs.push_back(::Summarize(values));
+
+	return summary;
+}
+
+std::string FrameStats::SummaryJson() const
+{
+	FrameStatsSummary summary = Summarize();
+
+	char buffer[256];
+	std::snprintf(buffer, sizeof(buffer), "{\"frames\":%d,\"seconds\":%.3f,\"fps\":%.2f,\"memoryBytes\":%llu,",
+		summary.Frames, summary.Seconds, summary.Fps, (unsigned long long)summary.MemoryBytes);
+
+	std::string out = buffer;
+	AppendJson(out, "frameMs", summary.FrameMs);
+	out += ",";
+	AppendJson(out, "rays", summary.Rays);
+	out += ",";
+	AppendJson(out, "distanceEvaluations", summary.DistanceEvaluations);
+	out += ",\"stagesMs\":{";
+	for (std::size_t i = 0; i < summary.StageNames.size(); ++i)
+	{
+		if (i > 0)
+			out += ",";
+		AppendJson(out, summary.StageNames[i].c_str(), summary.StageMs[i]);
+	}
+	out += "}}\n";
+	return out;
+}
+
+std::string FrameStats::WindowCsv() const
+{
+	std::vector<FrameSample> window;
+	std::vector<std::string> stageNames;
+	std::size_t next;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		window = mWindow;
+		stageNames = mStageNames;
+		next = mNext;
+	}
+
+	std::string out = "frame,time,frame_ms";
+	for (const std::string& name : stageNames)
+		out += "," + name + "_ms";
+	out += ",rays,distance_evaluations,memory_bytes\n";
+
+	// Oldest first.
+	std::size_t start = window.size() < mWindowFrames ? 0 : next;
+	for (std::size_t n = 0; n < window.size(); ++n)
+	{
+		const FrameSample& sample = window[(start + n) % window.size()];
+
+		char buffer[128];
+		std::snprintf(buffer, sizeof(buffer), "%llu,%.6f,%.4f", (unsigned long long)sample.Frame, sample.Time, sample.FrameMs);
+		out += buffer;
+
+		for (std::size_t i = 0; i < stageNames.size(); ++i)
+		{
+			std::snprintf(buffer, sizeof(buffer), ",%.4f", i < sample.StageMs.size() ? sample.StageMs[i] : 0.0);
+			out += buffer;
+		}
+
+		std::snprintf(buffer, sizeof(buffer), ",%llu,%llu,%llu\n",
+			(unsigned long long)sample.Rays, (unsigned long long)sample.DistanceEvaluations, (unsigned long long)sample.MemoryBytes);
+		out += buffer;
+	}
+	return out;
+}
+
+bool FrameStats::WriteJson(const std::string& path) const
+{
+	return WriteFile(path, SummaryJson());
+}
+
+bool FrameStats::WriteCsv(const std::string& path) const
+{
+	return WriteFile(path, WindowCsv());
+}
+
+std::string FrameStats::DefaultSocketPath()
+{
+	char buffer[256];
+#ifdef _WIN32
+	char temp[MAX_PATH];
+	GetTempPathA(MAX_PATH, temp);
+	std::snprintf(buffer, sizeof(buffer), "%sraymarching-%d.sock", temp, ProcessId());
+#else
+	std::snprintf(buffer, sizeof(buffer), "/tmp/raymarching-%d.sock", ProcessId());
+#endif
+	return buffer;
+}
+
+std::uint64_t FrameStats::CurrentMemoryUsage()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.WorkingSetSize;
+	return 0;
+#elif defined(__linux__)
+	std::FILE* file = std::fopen("/proc/self/statm", "r");
+	if (file == nullptr)
+		return 0;
+
+	unsigned long long size = 0, resident = 0;
+	int fields = std::fscanf(file, "%llu %llu", &size, &resident);
+	std::fclose(file);
+	return fields == 2 ? resident * (std::uint64_t)sysconf(_SC_PAGESIZE) : 0;
+#else
+	return 0;
+#endif
+}
+
+bool FrameStats::StartServer(const std::string& socketPath)
+{
+	StopServer();
+
+#ifdef _WIN32
+	WSADATA data;
+	if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+		return false;
+#endif
+
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path))
+	{
+		EndSockets();
+		return false;
+	}
+	std::strcpy(address.sun_path, socketPath.c_str());
+
+	SocketHandle listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener == NoSocket)
+	{
+		EndSockets();
+		return false;
+	}
+
+	// A stale socket file from a crashed run would make bind fail; any other
+	// file at the path does, rather than being deleted.
+	RemoveStaleSocket(socketPath);
+
+	if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 4) != 0)
+	{
+		CloseSocket(listener);
+		EndSockets();
+		return false;
+	}
+
+	mSocketPath = socketPath;
+	mServerRunning = true;
+	mServer = std::thread(&FrameStats::ServerLoop, this, (std::intptr_t)listener);
+	return true;
+}
+
+void FrameStats::StopServer()
+{
+	if (!mServerRunning)
+		return;
+
+	mServerRunning = false;
+	mServer.join();
+	RemoveStaleSocket(mSocketPath);
+	EndSockets();
+}
+
+void FrameStats::ServerLoop(std::intptr_t listenerHandle)
+{
+	SocketHandle listener = (SocketHandle)listenerHandle;
+
+	// select with a timeout so StopServer does not depend on closing a blocked accept.
+	auto readable = [](SocketHandle s, int timeoutMs)
+	{
+		fd_set set;
+		FD_ZERO(&set);
+		FD_SET(s, &set);
+		timeval timeout = { 0, timeoutMs * 1000 };
+		return select((int)s + 1, &set, nullptr, nullptr, &timeout) > 0;
+	};
+
+	while (mServerRunning)
+	{
+		if (!readable(listener, 100))
+			continue;
+
+		SocketHandle client = accept(listener, nullptr, nullptr);
+		if (client == NoSocket)
+			continue;
+#ifdef SO_NOSIGPIPE
+		int noSigPipe = 1;
+		setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+		// Sends time out so a client that stops reading cannot hold up StopServer's join;
+		// a slow one is waited for while the server runs.
+		SetSendTimeout(client, 100);
+
+		// An optional one-line command; clients that send nothing get the summary.
+		char command[64] = {};
+		if (readable(client, 50))
+			recv(client, command, sizeof(command) - 1, 0);
+
+		std::string reply = std::strncmp(command, "csv", 3) == 0 ? WindowCsv() : SummaryJson();
+		for (std::size_t sent = 0; sent < reply.size() && mServerRunning;)
+		{
+			int n = (int)send(client, reply.data() + sent, (int)(reply.size() - sent), SendFlags);
+			if (n < 0 && SendTimedOut())
+				continue;
+			if (n <= 0)
+				break;
+			sent += n;
+		}
+
+		CloseSocket(client);
+	}
+
+	CloseSocket(listener);
+}
\ No newline at end of file
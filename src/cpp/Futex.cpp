@@ -0,0 +1,35 @@
+#include "Futex.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <thread>
+#endif
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "futex word must be a plain 32-bit integer");
+
+void Futex::Wait(std::atomic<std::uint32_t>& word, std::uint32_t expected)
+{
+#if defined(_WIN32)
+	WaitOnAddress(&word, &expected, sizeof(expected), INFINITE);
+#elif defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+	if (word.load(std::memory_order_acquire) == expected)
+		std::this_thread::yield();
+#endif
+}
+
+void Futex::WakeAll(std::atomic<std::uint32_t>& word)
+{
+#if defined(_WIN32)
+	WakeByAddressAll(&word);
+#elif defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#endif
+}
\ No newline at end of file
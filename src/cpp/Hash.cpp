@@ -0,0 +1,13 @@
+#include "Hash.h"
+
+std::uint64_t Fnv1a(const void* data, std::size_t size, std::uint64_t seed)
+{
+	const std::uint8_t* bytes = (const std::uint8_t*)data;
+	std::uint64_t hash = seed;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
\ No newline at end of file
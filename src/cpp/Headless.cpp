@@ -0,0 +1,1625 @@
+#include "Headless.h"
+#include "Arena.h"
+#include "BatchRenderer.h"
+#include "Benchmark.h"
+#include "CameraPath.h"
+#include "Checkpoint.h"
+#include "DoubleDouble.h"
+#include "FrameStats.h"
+#include "Fractal.h"
+#include "HeapStats.h"
+#include "MathHelper.h"
+#include "PassConstantsLayout.h"
+#include "Random.h"
+#include "RingAllocator.h"
+#include "SceneInfo.h"
+#include "ShaderCache.h"
+#include "Simulation.h"
+#include "TiledRenderer.h"
+#include "TiledTiff.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	void PrintUsage()
+	{
+		std::printf(
+			"Usage:\n"
+			"  -bench [filter]     run the CPU benchmarks whose name contains filter\n"
+			"  -batch <output>     render a power sweep to numbered .ppm files (printf pattern)\n"
+			"                      or stream it to a .y4m, .rgba or .yuv file, a named pipe or - for stdout\n"
+			"  -tiled <output>     render one large image (-size) tile by tile into a tiled TIFF;\n"
+			"                      running it again resumes an interrupted render\n"
+			"Options:\n"
+			"  -runs <n>           timed runs per benchmark case (default 5)\n"
+			"  -size <w> <h>       render resolution (default 320 180)\n"
+			"  -threads <n>        worker threads (default all hardware threads)\n"
+			"  -trace <file>       record a Chrome trace (chrome://tracing, ui.perfetto.dev) of the run\n"
+			"Batch options:\n"
+			"  -power <a> <b>      FractalPower at the first and last frame (default 8 8)\n"
+			"  -frames <n>         frame count (default 60)\n"
+			"  -fps <n>            y4m frame rate (default 30)\n"
+			"  -format <f>         ppm, y4m, rgba or yuv (default from the output name, y4m for pipes)\n"
+			"  -formula <name>     mandelbulb, mandelbox, juliabulb, quaternion-julia or kifs\n"
+			"  -camera <x y z theta phi>      camera at the first frame\n"
+			"  -camera-end <x y z theta phi>  camera at the last frame (default: no motion)\n"
+			"  -aa <n>             adaptive anti-aliasing: n more jittered rays where neighbouring pixels differ\n"
+			"  -aa-uniform <n>     n more jittered rays in every pixel\n"
+			"  -upsample <f>       march at 1/f resolution (2 or 4) and upsample, re-marching at discontinuities\n"
+			"  -kernel <k>         march float and double rays with scalar (default), packet or wavefront\n"
+			"  -wavefront <n>      march wavefronts compacting live rays every n steps, 0 for lockstep packets\n"
+			"  -order <o>          tile and pixel traversal: morton (default) or row\n"
+			"  -ao                 ambient occlusion from the primary march's step counts\n"
+			"  -shadows            soft shadows, one shadow ray per lit pixel\n"
+			"Tiled images:\n"
+			"  -tile-size <n>      tile edge in pixels, a multiple of 16 (default 512)\n"
+			"  -dpi <n>            print resolution stored in the TIFF (default 300)\n"
+			"  -max-tiles <n>      stop after n tiles; run the same command again to continue\n"
+			"Checkpoints:\n"
+			"  -checkpoint <s>     checkpoint finished frames (-batch) or tiles (-tiled, always on) at most\n"
+			"                      every s seconds (default 10); -batch resumes from its checkpoint\n"
+			"  -max-frames <n>     stop -batch after n frames, as if interrupted\n"
+			"Camera paths:\n"
+			"  -path <file>        keyframe path (text) or recording (.camlog) for -batch and the path/ benchmarks;\n"
+			"                      frames default to the path's duration at -fps\n"
+			"  -replay-dt <s>      re-simulate a recording with a fixed timestep, also sets -fps\n"
+			"  -verify <file>      re-simulate a recording and report the first frame that differs\n"
+			"Shaders:\n"
+			"  -check-shader       run shaders/SceneInfo.hlsli as C++ and require the CPU renderer's float tier to match it exactly\n"
+			"  -emit-cbuffer <f>   write the PassConstants cbuffer declaration (- for stdout)\n"
+			"  -check-shader-cache exercise hashing, reuse and invalidation of the shader cache with a stub compiler\n"
+			"  -check-ring         check alignment, wrap-around and fenced reclamation of the frame allocator\n"
+			"  -check-math         compare the SIMD matrix functions with DirectXMath reference values\n"
+			"                      and check double-double exp, log and pow at their edges\n"
+			"  -check-interior     check that interior detection leaves every escaping sample unchanged\n"
+			"  -check-random       check the Philox generator, sampling distributions and Sobol/R2 sequences\n"
+			"  -check-alloc        check the arena allocators and that rendering a frame allocates nothing after warm-up\n"
+			"  -check-tiled        check tiled TIFF output, that tiles join seamlessly and that renders resume\n"
+			"  -check-checkpoint   check checkpoint manifests and that interrupted batch renders resume exactly\n"
+			"Simulation:\n"
+			"  -sim <seconds>      run the fixed-rate simulation thread against the CPU renderer and\n"
+			"                      report interpolation error and determinism\n"
+			"  -sim-rate <hz>      simulation tick rate (default 120)\n"
+			"Frame statistics (-batch and -sim):\n"
+			"  -stats <file>       write per-frame stage times, rays and distance evaluations of the\n"
+			"                      last 100000 frames to a .csv, or window percentiles to a .json\n"
+			"  -stats-socket <p>   serve the live summary on a local socket while running\n");
+	}
+
+	bool EndsWith(const std::string& s, const char* suffix)
+	{
+		std::size_t n = std::strlen(suffix);
+		return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+	}
+
+	bool ParseFormat(const std::string& name, BatchFormat& format)
+	{
+		if (name == "ppm")
+			format = BatchFormat::Ppm;
+		else if (name == "y4m")
+			format = BatchFormat::Y4m;
+		else if (name == "rgba")
+			format = BatchFormat::RawRgba;
+		else if (name == "yuv")
+			format = BatchFormat::RawYuv;
+		else
+			return false;
+		return true;
+	}
+
+	BatchFormat FormatFromPath(const std::string& path)
+	{
+		if (EndsWith(path, ".ppm"))
+			return BatchFormat::Ppm;
+		if (EndsWith(path, ".rgba"))
+			return BatchFormat::RawRgba;
+		if (EndsWith(path, ".yuv"))
+			return BatchFormat::RawYuv;
+		return BatchFormat::Y4m;
+	}
+
+	bool ParseFormula(const char* name, FractalFormula& formula)
+	{
+		const FractalFormula formulas[] = {
+			FractalFormula::Mandelbulb, FractalFormula::Mandelbox, FractalFormula::Juliabulb,
+			FractalFormula::QuaternionJulia, FractalFormula::KaleidoscopicIFS };
+
+		for (FractalFormula f : formulas)
+		{
+			if (std::strcmp(FormulaName(f), name) == 0)
+			{
+				formula = f;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int VerifyRecording(const char* file)
+	{
+		CameraRecording recording;
+		if (!recording.Load(file))
+		{
+			std::fprintf(stderr, "cannot load recording %s\n", file);
+			return 1;
+		}
+
+		int frame = recording.FirstDivergence(CameraController());
+		if (frame >= 0)
+		{
+			std::printf("%s: replay diverges at frame %d of %d\n", file, frame, (int)recording.Frames().size());
+			return 1;
+		}
+
+		std::printf("%s: %d frames replay exactly\n", file, (int)recording.Frames().size());
+		return 0;
+	}
+
+	// Renders -size with the shared shader code and with the CPU renderer's float path and
+	// compares them pixel by pixel. The renderer's kernel is its own but rounds like the
+	// shader's, so every step count and colour must match.
+	int CheckShader(const BenchmarkOptions& options)
+	{
+		const CpuCamera camera;
+		RenderSettings settings;
+		settings.Precision = PrecisionMode::Float;
+
+		CpuFramebuffer target;
+		target.Resize(options.Width, options.Height);
+		CpuRenderer renderer(options.Threads);
+
+		Vec3d forward = Normalize(camera.Forward());
+		Vec3d right = Normalize(Cross(Vec3d(0.0, 1.0, 0.0), forward));
+		Vec3d up = Cross(forward, right);
+		double tanHalfFovY = tan(camera.FovY * 0.5);
+		double aspectRatio = (double)target.Width / target.Height;
+
+		const Hlsl::float3 origin((float)camera.Position.x, (float)camera.Position.y, (float)camera.Position.z);
+		const Hlsl::float3 color(settings.Color.x, settings.Color.y, settings.Color.z);
+
+		// The renderer keeps its own kernel, written to round like the shader's; the float tier must match it exactly with every march kernel.
+		const struct
+		{
+			const char* Name;
+			MarchKernel Kernel;
+		} kernels[] = { { "scalar", MarchKernel::Scalar }, { "packet", MarchKernel::Packet }, { "wavefront", MarchKernel::Wavefront } };
+
+		bool ok = true;
+		for (const auto& kernel : kernels)
+		{
+			settings.Kernel = kernel.Kernel;
+			renderer.Render(camera, settings, target);
+
+			int stepMismatches = 0;
+			int colorMismatches = 0;
+			for (int y = 0; y < target.Height; ++y)
+			{
+				for (int x = 0; x < target.Width; ++x)
+				{
+					double ndcX = 2.0 * (x + 0.5) / target.Width - 1.0;
+					double ndcY = 1.0 - 2.0 * (y + 0.5) / target.Height;
+					Vec3d d = Normalize(forward + right * (ndcX * tanHalfFovY * aspectRatio) + up * (ndcY * tanHalfFovY));
+
+					Hlsl::MarchInfo info = Hlsl::March(origin, Hlsl::float3((float)d.x, (float)d.y, (float)d.z), settings.March.Fractal.Power);
+					Hlsl::float4 shaded = Hlsl::Shade(info, color, settings.Darkness);
+
+					std::size_t index = (std::size_t)y * target.Width + x;
+					if ((int)info.Steps != target.Steps[index])
+						++stepMismatches;
+
+					const float channels[4] = { shaded.x, shaded.y, shaded.z, shaded.w };
+					for (int c = 0; c < 4; ++c)
+					{
+						int expected = (int)(channels[c] * 255.0f + 0.5f);
+						int actual = (int)((target.Color[index] >> (8 * c)) & 0xFF);
+						if (expected != actual)
+						{
+							++colorMismatches;
+							break;
+						}
+					}
+				}
+			}
+
+			std::printf("shader reference vs CPU %s kernel at %dx%d: %d pixels with different step counts, %d with different colours\n",
+				kernel.Name, target.Width, target.Height, stepMismatches, colorMismatches);
+			ok = ok && stepMismatches == 0 && colorMismatches == 0;
+		}
+
+		std::printf("%s\n", ok ? "match" : "MISMATCH");
+		return ok ? 0 : 1;
+	}
+
+	// Stands in for D3DCompile: follows #include "..." lines like the preprocessor and
+	// returns the expanded text as "bytecode". A line starting with #error fails.
+	class StubShaderCompiler : public IShaderCompiler
+	{
+	public:
+		int Compiles = 0;
+
+		bool Compile(const ShaderRequest& request, ShaderBytecode& bytecode, std::vector<std::string>& includes, std::string& errors) override
+		{
+			++Compiles;
+
+			std::string text;
+			for (const ShaderDefine& define : request.Defines)
+				text += "#define " + define.Name + " " + define.Value + "\n";
+			text += request.EntryPoint + " " + request.Target + "\n";
+
+			if (!Expand(request.Path, text, includes, errors))
+				return false;
+
+			bytecode.assign(text.begin(), text.end());
+			return true;
+		}
+
+	private:
+		bool Expand(const std::string& path, std::string& text, std::vector<std::string>& includes, std::string& errors)
+		{
+			std::ifstream file(path);
+			if (!file)
+			{
+				errors = "cannot open " + path;
+				return false;
+			}
+
+			std::filesystem::path directory = std::filesystem::path(path).parent_path();
+			for (std::string line; std::getline(file, line);)
+			{
+				if (line.compare(0, 6, "#error") == 0)
+				{
+					errors = path + ": " + line;
+					return false;
+				}
+
+				std::size_t open = line.find("#include \"");
+				if (open == 0)
+				{
+					std::size_t close = line.find('"', 10);
+					std::string include = (directory / line.substr(10, close - 10)).lexically_normal().generic_string();
+					includes.push_back(include);
+					if (!Expand(include, text, includes, errors))
+						return false;
+					continue;
+				}
+
+				text += line + "\n";
+			}
+			return true;
+		}
+	};
+
+	void WriteText(const std::filesystem::path& path, const std::string& text)
+	{
+		std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+	}
+
+	int CheckShaderCache()
+	{
+		namespace fs = std::filesystem;
+		fs::path root = fs::temp_directory_path() / "raymarching-shader-cache-check";
+		fs::remove_all(root);
+		fs::create_directories(root / "include");
+
+		const std::string source = (root / "Scene.hlsl").generic_string();
+		const fs::path include = root / "include" / "Common.hlsli";
+		WriteText(source, "#include \"include/Common.hlsli\"\nfloat4 PS() : SV_Target { return Shade(); }\n");
+		WriteText(include, "float4 Shade() { return 1; }\n");
+
+		StubShaderCompiler compiler;
+		ShaderCache cache(compiler, (root / "cache").generic_string());
+
+		ShaderRequest request;
+		request.Path = source;
+		request.EntryPoint = "PS";
+		request.Target = "ps_5_0";
+
+		int failures = 0;
+		auto check = [&](const char* step, bool ok)
+		{
+			std::printf("%-44s %s\n", step, ok ? "ok" : "FAILED");
+			failures += ok ? 0 : 1;
+		};
+
+		ShaderBytecode first, bytecode;
+		check("first use compiles", cache.Load(request, first) && compiler.Compiles == 1);
+		check("second use is a hit", cache.Load(request, bytecode) && bytecode == first && compiler.Compiles == 1);
+
+		ShaderRequest variant = request;
+		variant.Defines.push_back({ "SCENE_MAX_STEPS", "300" });
+		check("a define is a separate permutation", cache.Load(variant, bytecode) && bytecode != first && compiler.Compiles == 2);
+		check("and is cached separately", cache.Load(variant, bytecode) && cache.Load(request, bytecode) && compiler.Compiles == 2);
+
+		WriteText(include, "float4 Shade() { return 0.5; }\n");
+		check("editing an include recompiles", cache.Load(request, bytecode) && bytecode != first && compiler.Compiles == 3);
+
+		WriteText(cache.Resolve(request), "truncated");
+		check("damaged bytecode recompiles", cache.Load(request, bytecode) && bytecode.size() > 9 && compiler.Compiles == 4);
+
+		WriteText(include, "#error broken\n");
+		std::string errors;
+		check("compile errors are reported", cache.Resolve(request, &errors).empty() && errors.find("broken") != std::string::npos);
+		check("and are not cached", cache.Resolve(request).empty() && compiler.Compiles == 6);
+
+		const ShaderCacheStats& stats = cache.Stats();
+		std::printf("%d hits, %d misses, %d invalidated, %d failures\n", stats.Hits, stats.Misses, stats.Invalidated, stats.Failures);
+
+		// The real shaders: a hit costs reading and hashing Fractal.hlsl, its includes and the bytecode.
+		if (fs::exists("shaders/Fractal.hlsl"))
+		{
+			StubShaderCompiler realCompiler;
+			ShaderCache realCache(realCompiler, (root / "real").generic_string());
+			ShaderRequest real;
+			real.Path = "shaders/Fractal.hlsl";
+			real.EntryPoint = "PS";
+			real.Target = "ps_5_0";
+
+			realCache.Resolve(real);
+			const int runs = 100;
+			for (int i = 0; i < runs; ++i)
+				realCache.Resolve(real);
+			std::printf("Fractal.hlsl cache hit: %.3f ms per lookup\n", realCache.Stats().LookupMs / (runs + 1));
+		}
+
+		fs::remove_all(root);
+		std::printf("%s\n", failures == 0 ? "all passed" : "FAILED");
+		return failures == 0 ? 0 : 1;
+	}
+
+	int CheckRingAllocator()
+	{
+		int failures = 0;
+		auto check = [&](const char* step, bool ok)
+		{
+			std::printf("%-52s %s\n", step, ok ? "ok" : "FAILED");
+			failures += ok ? 0 : 1;
+		};
+
+		HostMemoryBackend memory(4096);
+		LinearRingAllocator allocator(memory);
+		check("backend is 256-byte aligned", (std::uintptr_t)memory.CpuAddress() % 256 == 0);
+
+		RingAllocation a = allocator.Allocate(100);
+		RingAllocation b = allocator.Allocate(100);
+		RingAllocation c = allocator.Allocate(8, 16);
+		check("allocations are aligned and packed", a.Offset == 0 && b.Offset == 256 && c.Offset == 368);
+		allocator.EndFrame(1);
+
+		RingAllocation d = allocator.Allocate(3800);
+		check("an allocation that does not fit fails", !d && allocator.Stats().Failures == 1);
+
+		allocator.Reclaim(0);
+		check("an incomplete fence frees nothing", allocator.Used() == 376);
+
+		RingAllocation e = allocator.Allocate(3400);
+		allocator.EndFrame(2);
+		allocator.Reclaim(1);
+		check("a completed fence frees its frame", e && e.Offset == 512 && allocator.Used() == 3400 + 136);
+
+		RingAllocation f = allocator.Allocate(300);
+		check("an allocation crossing the end wraps to offset 0", f && f.Offset == 0 && allocator.Stats().WrapBytes == 4096 - 3912);
+
+		RingAllocation g = allocator.Allocate(100);
+		check("the wrapped ring stops at frames in flight", !g);
+		allocator.EndFrame(3);
+		allocator.Reclaim(3);
+		check("reclaiming every frame empties the ring", allocator.Used() == 0 && allocator.Allocate(100));
+
+		RingAllocation h = allocator.Push(PassConstantsLayout::Size);
+		check("Push copies the value", h && std::memcmp(h.Cpu, &PassConstantsLayout::Size, sizeof(std::size_t)) == 0);
+
+		const RingAllocatorStats& stats = allocator.Stats();
+		std::printf("%llu allocations, %llu failed, fragmentation %.1f%%, peak %zu of %zu bytes\n",
+			(unsigned long long)stats.Allocations, (unsigned long long)stats.Failures,
+			stats.Fragmentation() * 100.0, stats.PeakUsed, allocator.Capacity());
+		std::printf("%s\n", failures == 0 ? "all passed" : "FAILED");
+		return failures == 0 ? 0 : 1;
+	}
+
+	bool NearlyEqual(const Simd::Matrix& m, const Simd::Float4x4& expected, float tolerance)
+	{
+		Simd::Float4x4 actual;
+		Simd::StoreFloat4x4(&actual, m);
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				if (std::fabs(actual.m[i][j] - expected.m[i][j]) > tolerance * std::max(1.0f, std::fabs(expected.m[i][j])))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	int CheckMath()
+	{
+		using namespace Simd;
+
+		int failures = 0;
+		auto check = [&](const char* step, bool ok)
+		{
+			std::printf("%-52s %s\n", step, ok ? "ok" : "FAILED");
+			failures += ok ? 0 : 1;
+		};
+
+#if defined(SIMD_MATH_FMA)
+		std::printf("SSE with FMA\n");
+#elif defined(SIMD_MATH_SSE)
+		std::printf("SSE\n");
+#else
+		std::printf("scalar\n");
+#endif
+
+		// Reference values are what XMMatrixLookAtLH and XMMatrixPerspectiveFovLH return
+		// for the default camera and projection.
+		const float tolerance = 1e-5f;
+		Matrix view = MatrixLookAtLH(VectorSet(3.0f, 0.0f, -3.0f, 1.0f), VectorZero(), VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		check("MatrixLookAtLH", NearlyEqual(view, Float4x4(
+			0.707106781f, 0.0f, -0.707106781f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.707106781f, 0.0f, 0.707106781f, 0.0f,
+			0.0f, 0.0f, 4.24264069f, 1.0f), tolerance));
+
+		Matrix proj = MatrixPerspectiveFovLH(.25f * MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+		check("MatrixPerspectiveFovLH", NearlyEqual(proj, Float4x4(
+			1.35799513f, 0.0f, 0.0f, 0.0f,
+			0.0f, 2.41421356f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.001001f, 1.0f,
+			0.0f, 0.0f, -1.001001f, 0.0f), tolerance));
+
+		check("MatrixMultiply (view * proj)", NearlyEqual(view * proj, Float4x4(
+			0.960247564f, 0.0f, -0.707814596f, -0.707106781f,
+			0.0f, 2.41421356f, 0.0f, 0.0f,
+			0.960247564f, 0.0f, 0.707814596f, 0.707106781f,
+			0.0f, 0.0f, 3.24588657f, 4.24264069f), tolerance));
+
+		Float4 origin = VectorToFloat4(Vector4Transform(VectorSet(0.0f, 0.0f, 0.0f, 1.0f), view));
+		check("Vector4Transform puts the focus on +z", std::fabs(origin.x) < tolerance && std::fabs(origin.y) < tolerance
+			&& std::fabs(origin.z - 4.24264069f) < tolerance && origin.w == 1.0f);
+
+		Matrix a = MatrixSet(
+			2.0f, 0.0f, 1.0f, 3.0f,
+			1.0f, 4.0f, 0.0f, -1.0f,
+			0.0f, 2.0f, 5.0f, 1.0f,
+			3.0f, -1.0f, 2.0f, 6.0f);
+		check("MatrixTranspose", NearlyEqual(MatrixTranspose(a), Float4x4(
+			2.0f, 1.0f, 0.0f, 3.0f,
+			0.0f, 4.0f, 2.0f, -1.0f,
+			1.0f, 0.0f, 5.0f, 2.0f,
+			3.0f, -1.0f, 1.0f, 6.0f), 0.0f));
+
+		Float4 det = VectorToFloat4(MatrixDeterminant(a));
+		check("MatrixDeterminant is replicated", std::fabs(det.x - 30.0f) < 1e-4f && det.x == det.y && det.x == det.z && det.x == det.w);
+
+		Vector inverseDet;
+		Matrix inverse = MatrixInverse(&inverseDet, a);
+		check("MatrixInverse", NearlyEqual(inverse, Float4x4(
+			103.0f / 30.0f, -7.0f / 15.0f, 1.0f / 30.0f, -9.0f / 5.0f,
+			-43.0f / 30.0f, 7.0f / 15.0f, -1.0f / 30.0f, 4.0f / 5.0f,
+			31.0f / 30.0f, -4.0f / 15.0f, 7.0f / 30.0f, -3.0f / 5.0f,
+			-23.0f / 10.0f, 2.0f / 5.0f, -1.0f / 10.0f, 7.0f / 5.0f), tolerance)
+			&& std::fabs(VectorGetX(inverseDet) - 30.0f) < 1e-4f);
+		check("M * inverse(M) is the identity", NearlyEqual(a * inverse, MathHelper::Identity4x4(), tolerance));
+
+		Matrix viewProj = view * proj;
+		check("inverse of a view-projection", NearlyEqual(MatrixInverse(nullptr, viewProj) * viewProj, MathHelper::Identity4x4(), tolerance));
+
+		Vector cross = Vector3Cross(VectorSet(1.0f, 0.0f, 0.0f, 5.0f), VectorSet(0.0f, 1.0f, 0.0f, 7.0f));
+		Float4 z = VectorToFloat4(cross);
+		check("Vector3Cross clears w", z.x == 0.0f && z.y == 0.0f && z.z == 1.0f && z.w == 0.0f);
+
+		Float4 unit = VectorToFloat4(Vector3Normalize(VectorSet(3.0f, 4.0f, 0.0f, 0.0f)));
+		check("Vector3Normalize", std::fabs(unit.x - 0.6f) < tolerance && std::fabs(unit.y - 0.8f) < tolerance);
+
+		// Double-double edge cases; the marcher reaches pow(0, power) at the origin.
+		const double infinity = std::numeric_limits<double>::infinity();
+		check("double-double exp saturates out of range", exp(DoubleDouble(1000.0)).hi == infinity && exp(DoubleDouble(-1000.0)).hi == 0.0
+			&& exp(DoubleDouble(infinity)).hi == infinity && exp(DoubleDouble(-infinity)).hi == 0.0);
+		check("double-double log(0) is -inf", log(DoubleDouble(0.0)).hi == -infinity);
+		check("double-double pow(0, 8) is 0", pow(DoubleDouble(0.0), DoubleDouble(8.0)).hi == 0.0
+			&& std::fabs(pow(DoubleDouble(2.0), DoubleDouble(10.0)).hi - 1024.0) < 1e-9);
+
+		std::printf("%s\n", failures == 0 ? "all passed" : "FAILED");
+		return failures == 0 ? 0 : 1;
+	}
+
+	int CheckInterior()
+	{
+		int failures = 0;
+		auto check = [&](const char* step, bool ok)
+		{
+			std::printf("%-52s %s\n", step, ok ? "ok" : "FAILED");
+			failures += ok ? 0 : 1;
+		};
+
+		// Every sample the trap does not catch must come out bit for bit as without
+		// detection, and every sample it does catch must never escape without it.
+		const int resolution = 48;
+		const std::size_t count = (std::size_t)resolution * resolution * resolution;
+		std::vector<SceneSample> plain(count), detected(count), periodic(count);
+
+		for (float power : { 2.0f, 3.0f, 8.0f })
+		{
+			FractalParams params;
+			params.Power = power;
+			params.MaxIterations = 30;
+			Fractal::SceneInfoGrid(Vec3f(-1.5f, -1.5f, -1.5f), Vec3f(1.5f, 1.5f, 1.5f), resolution, resolution, resolution, params, plain.data());
+
+			params.InteriorDetection = true;
+			SceneQueryStats stats;
+			Fractal::SceneInfoGrid(Vec3f(-1.5f, -1.5f, -1.5f), Vec3f(1.5f, 1.5f, 1.5f), resolution, resolution, resolution, params, detected.data(), &stats);
+
+			params.PeriodicityCheck = true;
+			Fractal::SceneInfoGrid(Vec3f(-1.5f, -1.5f, -1.5f), Vec3f(1.5f, 1.5f, 1.5f), resolution, resolution, resolution, params, periodic.data());
+
+			int exteriorChanged = 0;
+			int interiorEscaped = 0;
+			int periodicMisreported = 0;
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				bool bounded = plain[i].Iterations == params.MaxIterations;
+				if (detected[i].Interior)
+					interiorEscaped += bounded ? 0 : 1;
+				else
+					exteriorChanged += detected[i].Iterations != plain[i].Iterations || std::memcmp(&detected[i].Distance, &plain[i].Distance, sizeof(float)) != 0 ? 1 : 0;
+				periodicMisreported += periodic[i].Interior && !bounded ? 1 : 0;
+			}
+
+			std::printf("power %g: %llu of %zu samples trapped, %.1f%% of iterations saved; "
+				"the periodicity heuristic misreports %d escaping samples\n",
+				power, (unsigned long long)stats.InteriorSamples, count,
+				100.0 * stats.IterationsSaved / std::max<std::uint64_t>(stats.Iterations + stats.IterationsSaved, 1), periodicMisreported);
+
+			char step[64];
+			std::snprintf(step, sizeof(step), "power %g: exterior samples are unchanged", power);
+			check(step, exteriorChanged == 0);
+			std::snprintf(step, sizeof(step), "power %g: trapped samples never escape", power);
+			check(step, interiorEscaped == 0);
+		}
+
+		// Without interior detection every query must give the renderer's distances,
+		// including the Mandelbulb's own loop.
+		std::vector<Vec3f> positions;
+		for (int i = 0; i < 4096; ++i)
+			positions.push_back(Vec3f(-1.5f + (i % 16) * 0.2f, -1.5f + (i / 16 % 16) * 0.2f, -1.5f + (i / 256) * 0.2f));
+
+		FractalParams bulb;
+		FractalParams box = FractalParams::Defaults(FractalFormula::Mandelbox);
+		FractalParams hybrid;
+		hybrid.Hybrid = HybridPattern::Alternate;
+		const struct
+		{
+			const char* Name;
+			FractalParams Params;
+		} queries[] =
+		{
+			{ "mandelbulb queries match the renderer", bulb },
+			{ "mandelbox queries use the mandelbox", box },
+			{ "hybrid queries use the hybrid", hybrid },
+		};
+		for (const auto& query : queries)
+		{
+			const FractalParams& params = query.Params;
+			std::vector<SceneSample> samples(positions.size());
+			Fractal::SceneInfoBulk(positions.data(), positions.size(), params, samples.data());
+
+			int differing = 0;
+			for (std::size_t i = 0; i < positions.size(); ++i)
+			{
+				int iterations = 0;
+				float distance = DistanceEstimate(positions[i], params, iterations);
+				differing += distance != samples[i].Distance || iterations != samples[i].Iterations ? 1 : 0;
+			}
+			check(query.Name, differing == 0);
+		}
+
+		std::printf("%s\n", failures == 0 ? "all passed" : "FAILED");
+		return failures == 0 ? 0 : 1;
+	}
+
+	int CheckRandom()
+	{
+		int failures = 0;
+		auto check = [&](const char* step, bool ok)
+		{
+			std::printf("%-52s %s\n", step, ok ? "ok" : "FAILED");
+			failures += ok ? 0 : 1;
+		};
+
+		// Known-answer vectors from the Random123 distribution.
+		struct Kat { std::uint32_t Counter[4]; std::uint32_t Key[2]; std::uint32_t Expected[4]; };
+		const Kat kats[] =
+		{
+			{ { 0, 0, 0, 0 }, { 0, 0 }, { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+			{ { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }, { 0xffffffff, 0xffffffff }, { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+			{ { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, { 0xa4093822, 0x299f31d0 }, { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+		};
+		bool katsMatch = true;
+		for (const Kat& kat : kats)
+		{
+			std::uint32_t out[4];
+			Philox4x32::Generate(kat.Counter, kat.Key, out);
+			katsMatch = katsMatch && std::memcmp(out, kat.Expected, sizeof(out)) == 0;
+		}
+		check("Philox4x32-10 known answers", katsMatch);
+
+		std::uint32_t counter[4] = { 5, 0, 7, 0 };
+		std::uint32_t key[2] = { 11, 0 };
+		std::uint32_t scalar[4];
+		Philox4x32::Generate(counter, key, scalar);
+		std::uint32_t packet[4][8];
+		Philox4x32::GeneratePacket<8>(0, 7, 11, packet);
+		check("packet lanes match the scalar generator", packet[0][5] == scalar[0] && packet[3][5] == scalar[3]);
+
+		RandomStream a(42, 3), b(42, 3), other(42, 4);
+		std::vector<std::uint32_t> batch(1000);
+		a.Fill(batch.data(), batch.size());
+		bool same = true, differs = false;
+		for (std::uint32_t value : batch)
+		{
+			same = same && b.NextUInt() == value;
+			differs = differs || other.NextUInt() != value;
+		}
+		check("a batch equals the same stream drawn one at a time", same);
+		check("another stream id gives another sequence", differs);
+
+		b.Seek(100);
+		check("Seek jumps to a block", b.NextUInt() == batch[400]);
+
+		const int count = 1 << 16;
+		std::vector<float> u(count);
+		RandomStream stream(1);
+		stream.Floats(u.data(), count);
+		double mean = 0.0, variance = 0.0;
+		bool inRange = true;
+		for (float f : u)
+		{
+			mean += f;
+			inRange = inRange && f >= 0.0f && f < 1.0f;
+		}
+		mean /= count;
+		for (float f : u)
+			variance += (f - mean) * (f - mean);
+		variance /= count;
+		check("floats are uniform in [0, 1)", inRange && std::fabs(mean - 0.5) < 0.01 && std::fabs(variance - 1.0 / 12.0) < 0.002);
+
+		bool draws = true;
+		for (int i = 0; i < 10000; ++i)
+		{
+			int r = stream.NextInt(-1, 1);
+			draws = draws && r >= -1 && r <= 1;
+		}
+		check("NextInt stays within [a, b]", draws);
+
+		std::vector<float> x(count), y(count), z(count);
+		stream.UnitVectors(x.data(), y.data(), z.data(), count);
+		double cx = 0.0, cy = 0.0, cz = 0.0;
+		bool unit = true;
+		for (int i = 0; i < count; ++i)
+		{
+			unit = unit && std::fabs(x[i] * x[i] + y[i] * y[i] + z[i] * z[i] - 1.0f) < 1e-5f;
+			cx += x[i];
+			cy += y[i];
+			cz += z[i];
+		}
+		check("unit vectors are unit length and centred", unit && std::fabs(cx / count) < 0.01 && std::fabs(cy / count) < 0.01 && std::fabs(cz / count) < 0.01);
+
+		const float nx = 0.0f, ny = 0.6f, nz = 0.8f;
+		stream.HemisphereVectors(nx, ny, nz, x.data(), y.data(), z.data(), count);
+		double meanCos = 0.0;
+		bool upper = true;
+		for (int i = 0; i < count; ++i)
+		{
+			float c = x[i] * nx + y[i] * ny + z[i] * nz;
+			upper = upper && c >= -1e-6f;
+			meanCos += c;
+		}
+		check("hemisphere: upper half, mean cosine 1/2", upper && std::fabs(meanCos / count - 0.5) < 0.01);
+
+		stream.CosineHemisphereVectors(nx, ny, nz, x.data(), y.data(), z.data(), count);
+		meanCos = 0.0;
+		upper = true;
+		for (int i = 0; i < count; ++i)
+		{
+			float c = x[i] * nx + y[i] * ny + z[i] * nz;
+			upper = upper && c >= -1e-6f;
+			meanCos += c;
+		}
+		check("cosine hemisphere: upper half, mean cosine 2/3", upper && std::fabs(meanCos / count - 2.0 / 3.0) < 0.01);
+
+		float sx[4], sy[4];
+		for (int i = 0; i < 4; ++i)
+			Random::Sobol2(i, 0, sx[i], sy[i]);
+		check("Sobol starts (0, 0) (.5, .5) (.25, .75) (.75, .25)",
+			sx[0] == 0.0f && sy[0] == 0.0f && sx[1] == 0.5f && sy[1] == 0.5f && sx[2] == 0.25f && sy[2] == 0.75f && sx[3] == 0.75f && sy[3] == 0.25f);
+
+		// The first 2^2k Sobol points put exactly one point in each cell of every 2^k x 2^k grid,
+		// with or without scrambling; R2 spreads them over nearly all of the cells.
+		auto occupied = [](int k, auto point)
+		{
+			const int n = 1 << k;
+			std::vector<int> cells(n * n, 0);
+			for (int i = 0; i < n * n; ++i)
+			{
+				float px, py;
+				point(i, px, py);
+				++cells[(int)(py * n) * n + (int)(px * n)];
+			}
+			return (int)std::count_if(cells.begin(), cells.end(), [](int c) { return c > 0; });
+		};
+		bool stratified = true;
+		for (std::uint32_t scramble : { 0u, 0x12345678u })
+			stratified = stratified && occupied(4, [scramble](int i, float& px, float& py) { Random::Sobol2(i, scramble, px, py); }) == 256;
+		check("Sobol points are stratified", stratified);
+
+		int r2Cells = occupied(4, [](int i, float& px, float& py) { Random::R2(i, px, py); });
+		int randomCells = occupied(4, [&stream](int i, float& px, float& py) { px = stream.NextFloat(); py = stream.NextFloat(); });
+		std::printf("cells of a 16x16 grid hit by 256 points: Sobol 256, R2 %d, random %d\n", r2Cells, randomCells);
+		check("R2 covers the grid better than random points", r2Cells > randomCells && r2Cells >= 200);
+
+		std::printf("%s\n", failures == 0 ? "all passed" : "FAILED");
+		return failures == 0 ? 0 : 1;
+	}
+
+	int CheckAllocations()
+	{
+		int failures = 0;
+		auto check = [&](const char* step, bool ok)
+		{
+			std::printf("%-52s %s\n", step, ok ? "ok" : "FAILED");
+			failures += ok ? 0 : 1;
+		};
+
+		// Kept alive so the allocation cannot be optimized away.
+		static std::unique_ptr<int[]> escaped;
+		std::uint64_t before = HeapStats::Allocations();
+		escaped.reset(new int[4]);
+		check("heap counter sees operator new", HeapStats::Allocations() == before + 1);
+
+		Arena arena(1024);
+		void* a = arena.Allocate(10, 1);
+		void* b = arena.Allocate(16, 64);
+		check("arena honours alignment", a != b && ((std::uintptr_t)b & 63) == 0);
+
+		Arena::Marker marker = arena.Mark();
+		void* c = arena.Allocate(100);
+		arena.Rewind(marker);
+		check("rewind hands out the same memory again", arena.Allocate(100) == c);
+
+		for (int i = 0; i < 10; ++i)
+			arena.Allocate(700);
+		std::size_t peak = arena.PeakUsed();
+		arena.Reset();
+		std::uint64_t blocks = arena.HeapAllocations();
+		for (int i = 0; i < 10; ++i)
+			arena.Allocate(700);
+		check("reset merges a spilled frame into one block", arena.HeapAllocations() == blocks && arena.Capacity() >= peak);
+
+		std::size_t used = arena.Used();
+		{
+			ArenaScope scope(arena);
+			before = HeapStats::Allocations();
+			ArenaVector<int> values{ ArenaAllocator<int>(arena) };
+			values.reserve(100);
+			for (int i = 0; i < 100; ++i)
+				values.push_back(i);
+			check("arena vector stays off the heap", HeapStats::Allocations() == before && values[99] == 99);
+		}
+		check("scope rewinds on exit", arena.Used() == used);
+
+		// Every renderer path, on two threads so worker arenas are covered too.
+		struct Config
+		{
+			const char* Name;
+			RenderSettings Settings;
+		};
+		std::vector<Config> configs(10);
+		configs[0].Name = "default";
+		configs[1].Name = "packets";
+		configs[1].Settings.Kernel = MarchKernel::Packet;
+		configs[2].Name = "double";
+		configs[2].Settings.Precision = PrecisionMode::Double;
+		configs[3].Name = "double-double";
+		configs[3].Settings.Precision = PrecisionMode::DoubleDouble;
+		configs[4].Name = "upsample 2";
+		configs[4].Settings.Upsample.Factor = 2;
+		configs[5].Name = "ao + shadows";
+		configs[5].Settings.Lighting.AmbientOcclusion = true;
+		configs[5].Settings.Lighting.Shadows = true;
+		configs[6].Name = "aa 4";
+		configs[6].Settings.AntiAlias.Enabled = true;
+		configs[7].Name = "all passes";
+		configs[7].Settings.Upsample.Factor = 4;
+		configs[7].Settings.Lighting.AmbientOcclusion = true;
+		configs[7].Settings.Lighting.Shadows = true;
+		configs[7].Settings.AntiAlias.Enabled = true;
+		configs[8].Name = "wavefront";
+		configs[8].Settings.Kernel = MarchKernel::Wavefront;
+		configs[9].Name = "packets, all passes";
+		configs[9].Settings = configs[7].Settings;
+		configs[9].Settings.Kernel = MarchKernel::Packet;
+
+		CpuRenderer renderer(2);
+		CpuFramebuffer target;
+		target.Resize(128, 72);
+
+		for (const Config& config : configs)
+		{
+			for (int frame = 0; frame < 2; ++frame)
+				renderer.Render(CpuCamera(), config.Settings, target);
+
+			before = HeapStats::Allocations();
+			for (int frame = 0; frame < 3; ++frame)
+				renderer.Render(CpuCamera(), config.Settings, target);
+			std::uint64_t allocations = HeapStats::Allocations() - before;
+
+			char step[128];
+			std::snprintf(step, sizeof(step), "%s: %llu heap allocations in 3 frames", config.Name, (unsigned long long)allocations);
+			check(step, allocations == 0);
+		}
+
+		std::printf("%s\n", failures == 0 ? "all passed" : "FAILED");
+		return failures == 0 ? 0 : 1;
+	}
+	int CheckTiled()
+	{
+		int failures = 0;
+		auto check = [&](const char* step, bool ok)
+		{
+			std::printf("%-52s %s\n", step, ok ? "ok" : "FAILED");
+			failures += ok ? 0 : 1;
+		};
+
+		const std::filesystem::path directory = std::filesystem::temp_directory_path();
+		check("40000 x 40000 needs BigTIFF", TiledTiff::NeedsBigTiff(40000, 40000, 512));
+		check("8192 x 8192 fits a classic TIFF", !TiledTiff::NeedsBigTiff(8192, 8192, 512));
+
+		// Both layouts, with partial edge tiles: write a pattern, reopen, read it back.
+		for (bool bigTiff : { false, true })
+		{
+			std::string path = (directory / (bigTiff ? "check_tiled_big.tif" : "check_tiled.tif")).string();
+			TiledTiff tiff;
+			bool ok = tiff.Create(path, 40, 24, 16, 300, bigTiff);
+
+			std::vector<std::uint8_t> tile(tiff.TileBytes());
+			for (int t = 0; ok && t < tiff.TilesX() * tiff.TilesY(); ++t)
+			{
+				for (std::size_t i = 0; i < tile.size(); ++i)
+					tile[i] = (std::uint8_t)(i * 7 + t * 31);
+				ok = tiff.WriteTile(t % tiff.TilesX(), t / tiff.TilesX(), tile.data());
+			}
+			ok = ok && tiff.Close() && tiff.Open(path, 40, 24, 16, 300, bigTiff);
+
+			for (int t = 0; ok && t < tiff.TilesX() * tiff.TilesY(); ++t)
+			{
+				ok = tiff.ReadTile(t % tiff.TilesX(), t / tiff.TilesX(), tile.data());
+				for (std::size_t i = 0; ok && i < tile.size(); ++i)
+					ok = tile[i] == (std::uint8_t)(i * 7 + t * 31);
+			}
+			tiff.Close();
+
+			TiledTiff other;
+			bool rejected = !other.Open(path, 40, 24, 32, 300, bigTiff);
+
+			// Cut short under an open file, the last tile fails to read and the next write still works.
+			const std::uintmax_t size = std::filesystem::file_size(path);
+			bool recovered = tiff.Open(path, 40, 24, 16, 300, bigTiff);
+			std::filesystem::resize_file(path, size - 1);
+			recovered = recovered && !tiff.ReadTile(tiff.TilesX() - 1, tiff.TilesY() - 1, tile.data()) && tiff.WriteTile(0, 0, tile.data());
+			tiff.Close();
+
+			std::filesystem::resize_file(path, size - 1);
+			bool truncated = !other.Open(path, 40, 24, 16, 300, bigTiff);
+			std::remove(path.c_str());
+
+			check(bigTiff ? "BigTIFF tiles read back after reopening" : "TIFF tiles read back after reopening", ok);
+			check(bigTiff ? "BigTIFF with another layout is not reopened" : "TIFF with another layout is not reopened", rejected);
+			check(bigTiff ? "BigTIFF writes after a failed read" : "TIFF writes after a failed read", recovered);
+			check(bigTiff ? "truncated BigTIFF is not reopened" : "truncated TIFF is not reopened", truncated);
+		}
+
+		// Tiles must match one render of the whole image, including the passes that read neighbours.
+		struct Config
+		{
+			const char* Name;
+			RenderSettings Settings;
+		};
+		std::vector<Config> configs(2);
+		configs[0].Name = "tiles match a single render";
+		configs[1].Name = "tiles match with upsampling, lighting and aa";
+		configs[1].Settings.Upsample.Factor = 2;
+		configs[1].Settings.Lighting.AmbientOcclusion = true;
+		configs[1].Settings.Lighting.Shadows = true;
+		configs[1].Settings.AntiAlias.Enabled = true;
+
+		TiledRenderOptions options;
+		options.Width = 200;
+		options.Height = 120;
+		options.TileSize = 64;
+		options.Threads = 2;
+		options.Output = (directory / "check_tiled_render.tif").string();
+
+		// A factor that does not divide the tiles would shift the low-resolution grid per tile.
+		TiledRenderOptions uneven = options;
+		uneven.Settings.Upsample.Factor = 3;
+		check("an upsample factor of 3 is rejected", !TiledRenderer(uneven).Run());
+
+		TiledRenderOptions noTiles = options;
+		noTiles.TileSize = 0;
+		TiledRenderer noTilesRenderer(noTiles);
+		check("a tile size of 0 is rejected", !noTilesRenderer.Run() && noTilesRenderer.Error().find("tile size") != std::string::npos);
+
+		TiledRenderOptions empty = options;
+		empty.Width = 0;
+		TiledRenderer emptyRenderer(empty);
+		check("an empty image is rejected", !emptyRenderer.Run() && emptyRenderer.Error().find("image size") != std::string::npos);
+
+		auto compare = [&](const CpuFramebuffer& whole, int& differing)
+		{
+			TiledTiff tiff;
+			if (!tiff.Open(options.Output, options.Width, options.Height, options.TileSize, options.Dpi, false))
+				return false;
+
+			differing = 0;
+			std::vector<std::uint8_t> tile(tiff.TileBytes());
+			for (int ty = 0; ty < tiff.TilesY(); ++ty)
+			{
+				for (int tx = 0; tx < tiff.TilesX(); ++tx)
+				{
+					tiff.ReadTile(tx, ty, tile.data());
+					for (int y = ty * options.TileSize; y < std::min((ty + 1) * options.TileSize, options.Height); ++y)
+					{
+						for (int x = tx * options.TileSize; x < std::min((tx + 1) * options.TileSize, options.Width); ++x)
+						{
+							const std::uint8_t* rgb = &tile[((std::size_t)(y - ty * options.TileSize) * options.TileSize + (x - tx * options.TileSize)) * 3];
+							std::uint32_t color = whole.Color[(std::size_t)y * whole.Width + x];
+							differing += rgb[0] != (color & 0xFF) || rgb[1] != ((color >> 8) & 0xFF) || rgb[2] != ((color >> 16) & 0xFF) ? 1 : 0;
+						}
+					}
+				}
+			}
+			return true;
+		};
+
+		CpuRenderer renderer(2);
+		for (const Config& config : configs)
+		{
+			options.Settings = config.Settings;
+			CpuFramebuffer whole;
+			whole.Resize(options.Width, options.Height);
+			renderer.Render(options.Camera, options.Settings, whole);
+
+			TiledRenderer tiled(options);
+			int differing = -1;
+			bool ok = tiled.Run() && tiled.Finished() && compare(whole, differing);
+			std::printf("%s: %d pixels differ\n", config.Name, differing);
+			check(config.Name, ok && differing == 0);
+		}
+
+		// Interrupt after a few tiles, then finish the image in a second run.
+		std::remove(options.Output.c_str());
+		options.Settings = RenderSettings();
+		options.MaxTiles = 4;
+		TiledRenderer first(options);
+		bool interrupted = first.Run() && !first.Finished() && std::filesystem::exists(first.CheckpointPath());
+		check("an interrupted render keeps a checkpoint", interrupted && first.Stats().Rendered == 4);
+
+		// A checkpointed tile that did not reach the disk intact.
+		{
+			TiledTiff tiff;
+			std::vector<std::uint8_t> garbage;
+			bool opened = tiff.Open(options.Output, options.Width, options.Height, options.TileSize, options.Dpi, false);
+			garbage.assign(tiff.TileBytes(), 0x5A);
+			check("a checkpointed tile can be damaged", opened && tiff.WriteTile(0, 0, garbage.data()) && tiff.Close());
+		}
+
+		options.MaxTiles = 0;
+		TiledRenderer second(options);
+		bool resumed = second.Run() && second.Finished() && second.Stats().Resumed;
+		check("a second run renders only the missing tiles", resumed && second.Stats().Skipped == 3 && second.Stats().Rendered == second.Stats().Tiles - 3);
+		check("the damaged tile fails its checksum", second.Stats().Damaged == 1);
+		check("the checkpoint is removed when done", !std::filesystem::exists(second.CheckpointPath()));
+
+		CpuFramebuffer whole;
+		whole.Resize(options.Width, options.Height);
+		renderer.Render(options.Camera, options.Settings, whole);
+		int differing = -1;
+		check("the resumed image matches a single render", compare(whole, differing) && differing == 0);
+		std::remove(options.Output.c_str());
+
+		std::printf("%s\n", failures == 0 ? "all passed" : "FAILED");
+		return failures == 0 ? 0 : 1;
+	}
+
+
+	int CheckCheckpoint()
+	{
+		int failures = 0;
+		auto check = [&](const char* step, bool ok)
+		{
+			std::printf("%-52s %s\n", step, ok ? "ok" : "FAILED");
+			failures += ok ? 0 : 1;
+		};
+
+		auto readAll = [](const std::string& path)
+		{
+			std::ifstream file(path, std::ios::binary);
+			return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		};
+		auto writeAll = [](const std::string& path, const std::string& bytes)
+		{
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			file.write(bytes.data(), bytes.size());
+		};
+
+		const std::filesystem::path directory = std::filesystem::temp_directory_path();
+		const std::string manifest = (directory / "check_checkpoint.checkpoint").string();
+
+		{
+			Checkpoint saved(manifest, "render a", 0.0);
+			saved.Add(0, 0x1234);
+			saved.Add(7, 0xFFFFFFFFFFFFFFFFull);
+			saved.Add(3, 0);
+			bool ok = saved.Save() && !std::filesystem::exists(manifest + ".tmp");
+
+			Checkpoint loaded(manifest, "render a", 0.0);
+			check("a manifest loads back", ok && loaded.Load() && loaded.Items() == saved.Items());
+
+			Checkpoint other(manifest, "render b", 0.0);
+			check("the manifest of another render is ignored", !other.Load());
+
+			std::string text = readAll(manifest);
+			text[text.find("1234")] = '5';
+			writeAll(manifest, text);
+			check("a damaged manifest is ignored", !loaded.Load() && loaded.Items().empty());
+
+			saved.Discard();
+			check("a discarded manifest is gone", !std::filesystem::exists(manifest));
+		}
+
+		// A setting left out of the signature would resume a render with the wrong pixels.
+		{
+			void (*changes[])(RenderSettings&) =
+			{
+				[](RenderSettings& s) { s.Color.y += 0.5f; },
+				[](RenderSettings& s) { s.Darkness += 1.0f; },
+				[](RenderSettings& s) { s.March.MaxDistance += 1.0f; },
+				[](RenderSettings& s) { s.March.Fractal.Bailout += 1.0f; },
+				[](RenderSettings& s) { s.March.Fractal.JuliaW += 0.1f; },
+				[](RenderSettings& s) { s.March.Fractal.BoxScale += 0.1f; },
+				[](RenderSettings& s) { s.March.Fractal.IfsOffset.z += 0.1f; },
+				[](RenderSettings& s) { s.March.Fractal.HybridPrefixIterations += 1; },
+				[](RenderSettings& s) { s.March.Fractal.BoxFoldLimit += 0.1f; },
+				[](RenderSettings& s) { s.Upsample.DepthThreshold *= 2.0f; },
+				[](RenderSettings& s) { s.AntiAlias.ColorThreshold *= 2.0f; },
+				[](RenderSettings& s) { s.Lighting.LightDirection.y = 0.0f; },
+				[](RenderSettings& s) { s.Lighting.AoSteps += 1.0f; },
+				[](RenderSettings& s) { s.Lighting.Shadow.Softness += 1.0f; }
+			};
+
+			const std::string base = SettingsSignature(RenderSettings());
+			int unchanged = 0;
+			for (auto change : changes)
+			{
+				RenderSettings settings;
+				change(settings);
+				unchanged += SettingsSignature(settings) == base ? 1 : 0;
+			}
+			check("the signature is stable", SettingsSignature(RenderSettings()) == base);
+			check("every pixel setting changes the signature", unchanged == 0);
+		}
+
+		BatchOptions options;
+		options.Width = 160;
+		options.Height = 90;
+		options.FrameCount = 6;
+		options.PowerStart = 8.0f;
+		options.PowerEnd = 9.0f;
+		options.Threads = 2;
+		options.CheckpointSeconds = 0.0;
+
+		// Interrupt a render, damage a frame it wrote and finish it in a second run; the
+		// output must match an uninterrupted render byte for byte.
+		struct Case
+		{
+			BatchFormat Format;
+			const char* Name;
+		};
+		for (const Case& c : { Case{ BatchFormat::Y4m, "y4m" }, Case{ BatchFormat::Ppm, "ppm" } })
+		{
+			const bool ppm = c.Format == BatchFormat::Ppm;
+			std::string extension = std::string(".") + c.Name;
+			options.Format = c.Format;
+			options.Resumable = false;
+			options.MaxFrames = 0;
+			options.Output = (directory / ((ppm ? "check_reference_%03d" : "check_reference") + extension)).string();
+			BatchRenderer reference(options);
+			bool ok = reference.Run();
+
+			options.Resumable = true;
+			options.MaxFrames = 3;
+			options.Output = (directory / ((ppm ? "check_resume_%03d" : "check_resume") + extension)).string();
+			BatchRenderer first(options);
+			std::remove(first.CheckpointPath().c_str());
+			ok = ok && first.Run() && !first.Finished() && std::filesystem::exists(first.CheckpointPath());
+
+			char step[64];
+			std::snprintf(step, sizeof(step), "%s: an interrupted render keeps a checkpoint", c.Name);
+			check(step, ok && first.Stats().Frames == 3);
+
+			// Flip a byte in frame 1; a stream keeps only frame 0, numbered files lose only frame 1.
+			std::string damaged = ppm ? (directory / "check_resume_001.ppm").string() : options.Output;
+			std::string bytes = readAll(damaged);
+			bytes[bytes.size() / 2] ^= 0x40;
+			writeAll(damaged, bytes);
+
+			options.MaxFrames = 0;
+			BatchRenderer second(options);
+			ok = second.Run() && second.Finished();
+			std::snprintf(step, sizeof(step), "%s: the damaged frame fails its checksum", c.Name);
+			check(step, ok && second.Stats().Damaged == (ppm ? 1 : 2) && second.Stats().Resumed == (ppm ? 2 : 1));
+
+			auto outputPath = [&](const char* run, int frame)
+			{
+				char name[64];
+				std::snprintf(name, sizeof(name), ppm ? "check_%s_%03d.ppm" : "check_%s.y4m", run, frame);
+				return (directory / name).string();
+			};
+
+			bool same = true;
+			for (int i = 0; i < (ppm ? options.FrameCount : 1); ++i)
+			{
+				std::string expected = readAll(outputPath("reference", i));
+				same = same && !expected.empty() && readAll(outputPath("resume", i)) == expected;
+				std::remove(outputPath("reference", i).c_str());
+				std::remove(outputPath("resume", i).c_str());
+			}
+			std::snprintf(step, sizeof(step), "%s: the resumed output matches one run", c.Name);
+			check(step, same);
+			std::snprintf(step, sizeof(step), "%s: the checkpoint is removed when done", c.Name);
+			check(step, !std::filesystem::exists(second.CheckpointPath()));
+		}
+
+		std::printf("%s\n", failures == 0 ? "all passed" : "FAILED");
+		return failures == 0 ? 0 : 1;
+	}
+
+	// Scripted input: power grows at .1/s while the camera turns and flies forward for the first second.
+	void SimulationScript(std::uint64_t tick, CameraInput& input, double tickRate)
+	{
+		input.PowerSteps = tick == 0 ? 10 : 0;
+		input.MouseDx = 1;
+		input.Vertical = tick < (std::uint64_t)tickRate ? 1.0f : 0.0f;
+	}
+
+	int RunSimulation(const BenchmarkOptions& options, double seconds, double tickRate, FrameStats* stats)
+	{
+		Simulation simulation(tickRate);
+		CpuRenderer renderer(options.Threads);
+		CpuFramebuffer target;
+		target.Resize(options.Width, options.Height);
+		RenderSettings settings;
+
+		int sampleStage = stats != nullptr ? stats->Stage("sample") : -1;
+		int renderStage = stats != nullptr ? stats->Stage("render") : -1;
+
+		const CameraState initial;
+		simulation.Start(initial, [tickRate](std::uint64_t tick, CameraInput& input) { SimulationScript(tick, input, tickRate); });
+
+		// Power is linear in time once the first tick has run, and sampling one tick
+		// behind should reproduce the ideal curve delayed by exactly one tick.
+		const double speed = 0.1;
+		double maxError = 0.0;
+		int frames = 0;
+
+		FrameStats unused(1);
+		FrameStats& frameStats = stats != nullptr ? *stats : unused;
+
+		for (double now = simulation.Now(); now < seconds; now = simulation.Now())
+		{
+			frameStats.BeginFrame();
+
+			CameraState state;
+			{
+				FrameStageTimer timer(frameStats, sampleStage);
+				state = simulation.Sample(now);
+			}
+
+			if (now > 2.0 * simulation.Dt())
+			{
+				double ideal = initial.Power + speed * (now - simulation.Dt());
+				maxError = std::max(maxError, std::fabs(state.Power - ideal));
+			}
+
+			settings.March.Fractal.Power = state.Power;
+			{
+				FrameStageTimer timer(frameStats, renderStage);
+				renderer.Render(CameraController::ToCpuCamera(state), settings, target);
+			}
+			frameStats.AddRays(renderer.LastStats().Rays);
+			frameStats.AddDistanceEvaluations(renderer.LastStats().DistanceEvaluations);
+			frameStats.EndFrame();
+			++frames;
+		}
+
+		double elapsed = simulation.Now();
+		simulation.Stop();
+		CameraState final = simulation.Sample(1e30);
+
+		// Replaying the same script with the same fixed timestep must land on the same state.
+		CameraController controller;
+		CameraState replay = initial;
+		for (std::uint64_t tick = 0; tick < simulation.Ticks(); ++tick)
+		{
+			CameraInput input;
+			SimulationScript(tick, input, tickRate);
+			controller.Step(replay, input, (float)simulation.Dt());
+		}
+
+		std::printf("%llu ticks in %.2f s (%.1f Hz target %.1f), %d frames rendered (%.1f fps)\n",
+			(unsigned long long)simulation.Ticks(), elapsed, simulation.Ticks() / elapsed, tickRate, frames, frames / elapsed);
+		std::printf("max interpolated power error %.5f (%.2f ticks of motion)\n", maxError, maxError / (speed * simulation.Dt()));
+		std::printf("replay %s\n", replay == final ? "matches" : "DIFFERS");
+		return replay == final ? 0 : 1;
+	}
+
+	int RunMode(bool bench, bool batch, bool checkShader, double simSeconds, double simRate, const BenchmarkOptions& benchOptions, const BatchOptions& batchOptions,
+		bool tiled, const TiledRenderOptions& tiledOptions)
+	{
+		if (checkShader)
+			return CheckShader(benchOptions);
+
+		if (bench)
+			return Benchmark::RunDefault(benchOptions);
+
+		if (simSeconds > 0.0)
+			return RunSimulation(benchOptions, simSeconds, simRate, batchOptions.Stats.get());
+
+		if (batch)
+			return BatchRenderer::RunDefault(batchOptions);
+
+		if (tiled)
+			return TiledRenderer::RunDefault(tiledOptions);
+
+		PrintUsage();
+		return 1;
+	}
+
+	CpuCamera ParseCamera(char** argv)
+	{
+		CpuCamera camera;
+		camera.Position = Vec3d(std::atof(argv[0]), std::atof(argv[1]), std::atof(argv[2]));
+		camera.Theta = std::atof(argv[3]);
+		camera.Phi = std::atof(argv[4]);
+		return camera;
+	}
+}
+
+bool IsHeadlessCommandLine(const char* cmdLine)
+{
+	while (cmdLine != nullptr && (*cmdLine == ' ' || *cmdLine == '\t'))
+		++cmdLine;
+
+	return cmdLine != nullptr && *cmdLine == '-';
+}
+
+int RunHeadless(int argc, char** argv)
+{
+	BenchmarkOptions benchOptions;
+	bool bench = false;
+
+	BatchOptions batchOptions;
+	bool batch = false;
+	TiledRenderOptions tiledOptions;
+	bool tiled = false;
+	bool checkShader = false;
+	bool cameraEnd = false;
+	bool formatSet = false;
+	bool framesSet = false;
+	bool fpsSet = false;
+
+	std::string pathFile;
+	float replayDt = 0.0f;
+
+	double simSeconds = 0.0;
+	double simRate = 120.0;
+
+	std::string traceFile;
+	std::string statsFile;
+	std::string statsSocket;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "-bench")
+		{
+			bench = true;
+			if (hasValue && argv[i + 1][0] != '-')
+				benchOptions.Filter = argv[++i];
+		}
+		else if (arg == "-batch" && hasValue)
+		{
+			batch = true;
+			batchOptions.Output = argv[++i];
+		}
+		else if (arg == "-tiled" && hasValue)
+		{
+			tiled = true;
+			tiledOptions.Output = argv[++i];
+		}
+		else if (arg == "-tile-size" && hasValue)
+			tiledOptions.TileSize = std::atoi(argv[++i]);
+		else if (arg == "-dpi" && hasValue)
+			tiledOptions.Dpi = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "-max-tiles" && hasValue)
+			tiledOptions.MaxTiles = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "-checkpoint" && hasValue)
+		{
+			batchOptions.Resumable = true;
+			batchOptions.CheckpointSeconds = std::max(0.0, std::atof(argv[++i]));
+			tiledOptions.CheckpointSeconds = batchOptions.CheckpointSeconds;
+		}
+		else if (arg == "-max-frames" && hasValue)
+			batchOptions.MaxFrames = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "-format" && hasValue)
+		{
+			if (!ParseFormat(argv[++i], batchOptions.Format))
+			{
+				PrintUsage();
+				return 1;
+			}
+			formatSet = true;
+		}
+		else if (arg == "-power" && i + 2 < argc)
+		{
+			batchOptions.PowerStart = (float)std::atof(argv[++i]);
+			batchOptions.PowerEnd = (float)std::atof(argv[++i]);
+		}
+		else if (arg == "-frames" && hasValue)
+		{
+			batchOptions.FrameCount = std::atoi(argv[++i]);
+			framesSet = true;
+		}
+		else if (arg == "-fps" && hasValue)
+		{
+			batchOptions.Fps = std::atoi(argv[++i]);
+			fpsSet = true;
+		}
+		else if (arg == "-path" && hasValue)
+			pathFile = argv[++i];
+		else if (arg == "-replay-dt" && hasValue)
+			replayDt = (float)std::atof(argv[++i]);
+		else if (arg == "-trace" && hasValue)
+			traceFile = argv[++i];
+		else if (arg == "-stats" && hasValue)
+			statsFile = argv[++i];
+		else if (arg == "-stats-socket" && hasValue)
+			statsSocket = argv[++i];
+		else if (arg == "-sim" && hasValue)
+			simSeconds = std::atof(argv[++i]);
+		else if (arg == "-sim-rate" && hasValue)
+			simRate = std::atof(argv[++i]);
+		else if (arg == "-emit-cbuffer" && hasValue)
+		{
+			std::string file = argv[++i];
+			if (file == "-")
+			{
+				std::fputs(PassConstantsLayout::Hlsl().c_str(), stdout);
+				return 0;
+			}
+			return PassConstantsLayout::WriteHlsl(file) ? 0 : 1;
+		}
+		else if (arg == "-check-shader-cache")
+			return CheckShaderCache();
+		else if (arg == "-check-ring")
+			return CheckRingAllocator();
+		else if (arg == "-check-math")
+			return CheckMath();
+		else if (arg == "-check-interior")
+			return CheckInterior();
+		else if (arg == "-check-random")
+			return CheckRandom();
+		else if (arg == "-check-alloc")
+			return CheckAllocations();
+		else if (arg == "-check-tiled")
+			return CheckTiled();
+		else if (arg == "-check-checkpoint")
+			return CheckCheckpoint();
+		else if (arg == "-check-shader")
+			checkShader = true;
+		else if (arg == "-verify" && hasValue)
+			return VerifyRecording(argv[++i]);
+		else if (arg == "-formula" && hasValue)
+		{
+			FractalFormula formula;
+			if (!ParseFormula(argv[++i], formula))
+			{
+				PrintUsage();
+				return 1;
+			}
+			batchOptions.Settings.March.Fractal = FractalParams::Defaults(formula);
+		}
+		else if ((arg == "-aa" || arg == "-aa-uniform") && hasValue)
+		{
+			AntiAliasSettings& aa = batchOptions.Settings.AntiAlias;
+			aa.Enabled = true;
+			aa.Uniform = arg == "-aa-uniform";
+			aa.Samples = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "-upsample" && hasValue)
+		{
+			int factor = std::atoi(argv[++i]);
+			if (factor != 1 && factor != 2 && factor != 4)
+			{
+				PrintUsage();
+				return 1;
+			}
+			batchOptions.Settings.Upsample.Factor = factor;
+		}
+		else if (arg == "-kernel" && hasValue)
+		{
+			std::string kernel = argv[++i];
+			if (kernel == "scalar")
+				batchOptions.Settings.Kernel = MarchKernel::Scalar;
+			else if (kernel == "packet")
+				batchOptions.Settings.Kernel = MarchKernel::Packet;
+			else if (kernel == "wavefront")
+				batchOptions.Settings.Kernel = MarchKernel::Wavefront;
+			else
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if (arg == "-wavefront" && hasValue)
+		{
+			int steps = std::max(0, std::atoi(argv[++i]));
+			batchOptions.Settings.Kernel = steps > 0 ? MarchKernel::Wavefront : MarchKernel::Packet;
+			batchOptions.Settings.WavefrontSteps = std::max(steps, 1);
+		}
+		else if (arg == "-order" && hasValue)
+			batchOptions.Settings.Order = std::strcmp(argv[++i], "row") == 0 ? TraversalOrder::RowMajor : TraversalOrder::Morton;
+		else if (arg == "-ao")
+			batchOptions.Settings.Lighting.AmbientOcclusion = true;
+		else if (arg == "-shadows")
+			batchOptions.Settings.Lighting.Shadows = true;
+		else if (arg == "-camera" && i + 5 < argc)
+		{
+			batchOptions.CameraStart = ParseCamera(argv + i + 1);
+			i += 5;
+		}
+		else if (arg == "-camera-end" && i + 5 < argc)
+		{
+			batchOptions.CameraEnd = ParseCamera(argv + i + 1);
+			cameraEnd = true;
+			i += 5;
+		}
+		else if (arg == "-runs" && hasValue)
+			benchOptions.Runs = std::atoi(argv[++i]);
+		else if (arg == "-size" && i + 2 < argc)
+		{
+			benchOptions.Width = std::atoi(argv[++i]);
+			benchOptions.Height = std::atoi(argv[++i]);
+			if (benchOptions.Width <= 0 || benchOptions.Height <= 0)
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if (arg == "-threads" && hasValue)
+		{
+			benchOptions.Threads = std::atoi(argv[++i]);
+			if (benchOptions.Threads <= 0)
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (!pathFile.empty())
+	{
+		auto path = std::make_shared<CameraPath>();
+		if (!path->LoadAny(pathFile, replayDt))
+		{
+			std::fprintf(stderr, "cannot load camera path %s\n", pathFile.c_str());
+			return 1;
+		}
+
+		if (replayDt > 0.0f && !fpsSet)
+			batchOptions.Fps = std::max(1, (int)std::lround(1.0 / replayDt));
+		if (!framesSet)
+			batchOptions.FrameCount = (int)(path->Duration() * std::max(batchOptions.Fps, 1)) + 1;
+
+		batchOptions.Path = path;
+		benchOptions.Path = path;
+		benchOptions.PathFps = batchOptions.Fps;
+	}
+
+	if (batch)
+	{
+		batchOptions.Width = benchOptions.Width;
+		batchOptions.Height = benchOptions.Height;
+		batchOptions.Threads = benchOptions.Threads;
+		if (!cameraEnd)
+			batchOptions.CameraEnd = batchOptions.CameraStart;
+		if (!formatSet)
+			batchOptions.Format = FormatFromPath(batchOptions.Output);
+	}
+
+	if (tiled)
+	{
+		tiledOptions.Width = benchOptions.Width;
+		tiledOptions.Height = benchOptions.Height;
+		tiledOptions.Threads = benchOptions.Threads;
+		tiledOptions.Camera = batchOptions.CameraStart;
+		tiledOptions.Settings = batchOptions.Settings;
+		tiledOptions.Settings.March.Fractal.Power = batchOptions.PowerStart;
+	}
+
+	if (!statsFile.empty() || !statsSocket.empty())
+	{
+		// A CSV keeps every frame of a long run; the JSON and the socket summarize the recent window.
+		batchOptions.Stats = std::make_shared<FrameStats>(EndsWith(statsFile, ".csv") ? 100000 : 600);
+		if (!statsSocket.empty() && !batchOptions.Stats->StartServer(statsSocket))
+		{
+			std::fprintf(stderr, "cannot listen on %s\n", statsSocket.c_str());
+			return 1;
+		}
+	}
+
+	if (!traceFile.empty())
+	{
+		TRACE_THREAD_NAME("Main");
+		Trace::Start();
+	}
+
+	int result = RunMode(bench, batch, checkShader, simSeconds, simRate, benchOptions, batchOptions, tiled, tiledOptions);
+
+	if (!traceFile.empty())
+	{
+		Trace::Stop();
+		if (!Trace::WriteJson(traceFile))
+		{
+			std::fprintf(stderr, "cannot write %s\n", traceFile.c_str());
+			return 1;
+		}
+	}
+
+	if (!statsFile.empty())
+	{
+		const FrameStats& stats = *batchOptions.Stats;
+		if (!(EndsWith(statsFile, ".csv") ? stats.WriteCsv(statsFile) : stats.WriteJson(statsFile)))
+		{
+			std::fprintf(stderr, "cannot write %s\n", statsFile.c_str());
+			return 1;
+		}
+	}
+
+	return result;
+}
+
+#ifndef _WIN32
+int main(int argc, char** argv)
+{
+	return RunHeadless(argc, argv);
+}
+#endif
\ No newline at end of file
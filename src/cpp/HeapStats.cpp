@@ -0,0 +1,36 @@
+#include "HeapStats.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<std::uint64_t> gAllocations(0);
+}
+
+namespace HeapStats
+{
+	std::uint64_t Allocations()
+	{
+		return gAllocations.load(std::memory_order_relaxed);
+	}
+}
+
+// The array and nothrow forms forward to these in the standard library.
+void* operator new(std::size_t size)
+{
+	gAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* pointer = std::malloc(size > 0 ? size : 1))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t size) noexcept
+{
+	std::free(pointer);
+}
\ No newline at end of file
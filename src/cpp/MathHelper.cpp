@@ -2,7 +2,7 @@
 #include <float.h>
 #include <cmath>
 
-using namespace DirectX;
+using namespace Simd;
 
 const float MathHelper::Infinity = FLT_MAX;
 const float MathHelper::Pi = 3.1415926535f;
@@ -28,37 +28,25 @@ float MathHelper::AngleFromXY(float x, float y)
 	return theta;
 }
 
-XMVECTOR MathHelper::RandUnitVec3()
+Vector MathHelper::RandUnitVec3()
 {
-	XMVECTOR One = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
+	RandomStream& random = ThreadRandom();
+	float u = random.NextFloat();
+	float v = random.NextFloat();
 
-	while (true)
-	{
-		XMVECTOR v = XMVectorSet(MathHelper::Rand(-1.0f, 1.0f), MathHelper::Rand(-1.0f, 1.0f), MathHelper::Rand(-1.0f, 1.0f), .0f);
-		
-		if (XMVector3Greater(XMVector3LengthSq(v), One))
-			continue;
-		
-		return XMVector3Normalize(v);
-	}
+	float x, y, z;
+	Random::UnitVector(u, v, x, y, z);
+	return VectorSet(x, y, z, .0f);
 }
 
-XMVECTOR MathHelper::RandHemisphereUnitVec3(XMVECTOR n)
+Vector MathHelper::RandHemisphereUnitVec3(Vector n)
 {
-	XMVECTOR One = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
-
-	while (true)
-	{
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), .0f);
-	
-		if (XMVector3Greater(XMVector3LengthSq(v), One))
-			continue;
-
-		if (XMVector3Less(XMVector3Dot(n, v), Zero))
-			continue;
-
-		return XMVector3Normalize(v);
-	}
+	RandomStream& random = ThreadRandom();
+	float u = random.NextFloat();
+	float v = random.NextFloat();
+
+	Float4 normal = VectorToFloat4(Vector3Normalize(n));
+	float x, y, z;
+	Random::HemisphereVector(u, v, normal.x, normal.y, normal.z, x, y, z);
+	return VectorSet(x, y, z, .0f);
 }
\ No newline at end of file
@@ -0,0 +1,32 @@
+#include "PassConstantsLayout.h"
+#include <cstdio>
+
+std::string PassConstantsLayout::Hlsl()
+{
+	return "// Generated from PASS_CONSTANTS_FIELDS in src/include/PassConstantsLayout.h; do not edit.\n"
+		+ CbLayout::Emit("cbPerObject", 0, Fields, FieldCount);
+}
+
+bool PassConstantsLayout::WriteHlsl(const std::string& path)
+{
+	const std::string text = Hlsl();
+
+	if (std::FILE* file = std::fopen(path.c_str(), "rb"))
+	{
+		std::string existing;
+		char buffer[4096];
+		for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), file)) > 0;)
+			existing.append(buffer, n);
+		std::fclose(file);
+
+		if (existing == text)
+			return true;
+	}
+
+	std::FILE* file = std::fopen(path.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+
+	bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+	return std::fclose(file) == 0 && ok;
+}
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "Random.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace
+{
+	const float TwoPi = 6.28318530718f;
+
+	// Vectors per batch step; two uniforms each, so one Philox packet of 16 blocks.
+	const int BatchVectors = 32;
+
+	std::atomic<std::uint64_t> gNextThreadStream(0);
+
+	std::uint32_t ReverseBits(std::uint32_t v)
+	{
+		v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+		v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+		v = ((v >> 4) & 0x0F0F0F0Fu) | ((v & 0x0F0F0F0Fu) << 4);
+		v = ((v >> 8) & 0x00FF00FFu) | ((v & 0x00FF00FFu) << 8);
+		return (v >> 16) | (v << 16);
+	}
+}
+
+void Philox4x32::Generate(const std::uint32_t counter[4], const std::uint32_t key[2], std::uint32_t out[4])
+{
+	std::uint32_t c[4] = { counter[0], counter[1], counter[2], counter[3] };
+	std::uint32_t k0 = key[0];
+	std::uint32_t k1 = key[1];
+
+	for (int round = 0; round < 10; ++round)
+	{
+		std::uint64_t p0 = (std::uint64_t)0xD2511F53u * c[0];
+		std::uint64_t p1 = (std::uint64_t)0xCD9E8D57u * c[2];
+		std::uint32_t n0 = (std::uint32_t)(p1 >> 32) ^ c[1] ^ k0;
+		std::uint32_t n2 = (std::uint32_t)(p0 >> 32) ^ c[3] ^ k1;
+		c[0] = n0;
+		c[1] = (std::uint32_t)p1;
+		c[2] = n2;
+		c[3] = (std::uint32_t)p0;
+		k0 += 0x9E3779B9u;
+		k1 += 0xBB67AE85u;
+	}
+
+	for (int i = 0; i < 4; ++i)
+		out[i] = c[i];
+}
+
+RandomStream::RandomStream(std::uint64_t seed, std::uint64_t stream) :
+	mKey(seed),
+	mStream(stream)
+{
+}
+
+void RandomStream::Refill()
+{
+	std::uint32_t out[4][1];
+	Philox4x32::GeneratePacket<1>(mCounter++, mStream, mKey, out);
+	for (int i = 0; i < 4; ++i)
+		mBuffer[i] = out[i][0];
+	mBuffered = 4;
+}
+
+std::uint32_t RandomStream::NextUInt()
+{
+	if (mBuffered == 0)
+		Refill();
+	return mBuffer[4 - mBuffered--];
+}
+
+float RandomStream::NextFloat()
+{
+	return Random::ToFloat(NextUInt());
+}
+
+float RandomStream::NextFloat(float a, float b)
+{
+	return a + NextFloat() * (b - a);
+}
+
+int RandomStream::NextInt(int a, int b)
+{
+	// Lemire's multiply-shift: no modulo and no bias worth measuring for ranges this small.
+	std::uint64_t range = (std::uint64_t)((std::int64_t)b - a) + 1;
+	return (int)(a + (std::int64_t)(((std::uint64_t)NextUInt() * range) >> 32));
+}
+
+void RandomStream::Fill(std::uint32_t* out, std::size_t count)
+{
+	const int N = 16;
+	std::uint32_t block[4][N];
+
+	std::size_t i = 0;
+	while (i < count)
+	{
+		Philox4x32::GeneratePacket<N>(mCounter, mStream, mKey, block);
+		mCounter += N;
+
+		// Interleave the words back into counter order so a batch matches NextUInt.
+		std::size_t n = std::min<std::size_t>(count - i, 4 * N);
+		for (std::size_t j = 0; j < n; ++j)
+			out[i + j] = block[j % 4][j / 4];
+		i += n;
+	}
+}
+
+void RandomStream::Floats(float* out, std::size_t count)
+{
+	std::uint32_t bits[64];
+	for (std::size_t i = 0; i < count; i += 64)
+	{
+		std::size_t n = std::min<std::size_t>(count - i, 64);
+		Fill(bits, n);
+		for (std::size_t j = 0; j < n; ++j)
+			out[i + j] = Random::ToFloat(bits[j]);
+	}
+}
+
+void RandomStream::UnitVectors(float* x, float* y, float* z, std::size_t count)
+{
+	float u[2 * BatchVectors];
+	for (std::size_t i = 0; i < count; i += BatchVectors)
+	{
+		std::size_t n = std::min<std::size_t>(count - i, BatchVectors);
+		Floats(u, 2 * n);
+		for (std::size_t j = 0; j < n; ++j)
+			Random::UnitVector(u[2 * j], u[2 * j + 1], x[i + j], y[i + j], z[i + j]);
+	}
+}
+
+void RandomStream::HemisphereVectors(float nx, float ny, float nz, float* x, float* y, float* z, std::size_t count)
+{
+	float u[2 * BatchVectors];
+	for (std::size_t i = 0; i < count; i += BatchVectors)
+	{
+		std::size_t n = std::min<std::size_t>(count - i, BatchVectors);
+		Floats(u, 2 * n);
+		for (std::size_t j = 0; j < n; ++j)
+			Random::HemisphereVector(u[2 * j], u[2 * j + 1], nx, ny, nz, x[i + j], y[i + j], z[i + j]);
+	}
+}
+
+void RandomStream::CosineHemisphereVectors(float nx, float ny, float nz, float* x, float* y, float* z, std::size_t count)
+{
+	float u[2 * BatchVectors];
+	for (std::size_t i = 0; i < count; i += BatchVectors)
+	{
+		std::size_t n = std::min<std::size_t>(count - i, BatchVectors);
+		Floats(u, 2 * n);
+		for (std::size_t j = 0; j < n; ++j)
+			Random::CosineHemisphereVector(u[2 * j], u[2 * j + 1], nx, ny, nz, x[i + j], y[i + j], z[i + j]);
+	}
+}
+
+std::uint64_t RandomStream::Stream() const
+{
+	return mStream;
+}
+
+std::uint64_t RandomStream::Counter() const
+{
+	return mCounter;
+}
+
+void RandomStream::Seek(std::uint64_t counter)
+{
+	mCounter = counter;
+	mBuffered = 0;
+}
+
+RandomStream& ThreadRandom()
+{
+	thread_local RandomStream stream(0, gNextThreadStream++);
+	return stream;
+}
+
+void SeedThreadRandom(std::uint64_t seed)
+{
+	// Keep the thread's stream id so reseeded threads still never share a sequence.
+	RandomStream& stream = ThreadRandom();
+	stream = RandomStream(seed, stream.Stream());
+}
+
+namespace Random
+{
+	void UnitVector(float u, float v, float& x, float& y, float& z)
+	{
+		// z uniform in [-1, 1] and a uniform angle give a uniform point on the sphere (Archimedes).
+		float cz = 1.0f - 2.0f * u;
+		float r = std::sqrt(std::max(0.0f, 1.0f - cz * cz));
+		float phi = TwoPi * v;
+		x = r * std::cos(phi);
+		y = r * std::sin(phi);
+		z = cz;
+	}
+
+	void HemisphereVector(float u, float v, float nx, float ny, float nz, float& x, float& y, float& z)
+	{
+		UnitVector(u, v, x, y, z);
+
+		// Mirror the lower half through the tangent plane instead of rejecting it.
+		float d = 2.0f * std::min(x * nx + y * ny + z * nz, 0.0f);
+		x -= d * nx;
+		y -= d * ny;
+		z -= d * nz;
+	}
+
+	void CosineHemisphereVector(float u, float v, float nx, float ny, float nz, float& x, float& y, float& z)
+	{
+		// Normal plus a uniform unit vector is cosine distributed about the normal.
+		UnitVector(u, v, x, y, z);
+		x += nx;
+		y += ny;
+		z += nz;
+
+		float lengthSq = x * x + y * y + z * z;
+		bool degenerate = lengthSq < 1e-12f;
+		float inv = 1.0f / std::sqrt(degenerate ? 1.0f : lengthSq);
+		x = degenerate ? nx : x * inv;
+		y = degenerate ? ny : y * inv;
+		z = degenerate ? nz : z * inv;
+	}
+
+	void Sobol2(std::uint32_t index, std::uint32_t scramble, float& x, float& y)
+	{
+		// Dimension 0 is the van der Corput sequence; dimension 1 uses the direction
+		// numbers of the primitive polynomial x + 1, where each one is v ^ (v >> 1).
+		std::uint32_t s0 = ReverseBits(index);
+		std::uint32_t s1 = 0;
+		for (std::uint32_t v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1)
+			s1 ^= (index & 1u) ? v : 0u;
+
+		x = Random::ToFloat(s0 ^ scramble);
+		y = Random::ToFloat(s1 ^ (scramble * 0x9E3779B9u));
+	}
+
+	void R2(std::uint32_t index, float& x, float& y)
+	{
+		// 1/g and 1/g^2 for the plastic number g, the 2D analogue of the golden ratio.
+		const double a1 = 0.7548776662466927;
+		const double a2 = 0.5698402909980532;
+		double fx = 0.5 + a1 * index;
+		double fy = 0.5 + a2 * index;
+		const float belowOne = 0.99999994f;
+		x = std::min((float)(fx - std::floor(fx)), belowOne);
+		y = std::min((float)(fy - std::floor(fy)), belowOne);
+	}
+}
\ No newline at end of file
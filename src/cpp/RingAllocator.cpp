@@ -0,0 +1,118 @@
+#include "RingAllocator.h"
+#include <algorithm>
+
+HostMemoryBackend::HostMemoryBackend(std::size_t size) :
+	mStorage(new std::uint8_t[size + LinearRingAllocator::DefaultAlignment]),
+	mSize(size)
+{
+	std::uintptr_t address = (std::uintptr_t)mStorage.get();
+	std::uintptr_t aligned = (address + LinearRingAllocator::DefaultAlignment - 1) & ~(std::uintptr_t)(LinearRingAllocator::DefaultAlignment - 1);
+	mBase = mStorage.get() + (aligned - address);
+}
+
+std::uint8_t* HostMemoryBackend::CpuAddress()
+{
+	return mBase;
+}
+
+std::uint64_t HostMemoryBackend::GpuAddress() const
+{
+	return 0;
+}
+
+std::size_t HostMemoryBackend::Size() const
+{
+	return mSize;
+}
+
+double RingAllocatorStats::Fragmentation() const
+{
+	std::uint64_t consumed = RequestedBytes + PaddingBytes + WrapBytes;
+	return consumed > 0 ? (double)(PaddingBytes + WrapBytes) / consumed : 0.0;
+}
+
+double RingAllocatorStats::AllocationsPerFrame() const
+{
+	return Frames > 0 ? (double)Allocations / Frames : 0.0;
+}
+
+double RingAllocatorStats::BytesPerFrame() const
+{
+	return Frames > 0 ? (double)(RequestedBytes + PaddingBytes + WrapBytes) / Frames : 0.0;
+}
+
+LinearRingAllocator::LinearRingAllocator(IMemoryBackend& backend) :
+	mBackend(backend),
+	mCapacity(backend.Size())
+{
+}
+
+RingAllocation LinearRingAllocator::Allocate(std::size_t size, std::size_t alignment)
+{
+	alignment = std::max<std::size_t>(alignment, 1);
+
+	std::size_t offset = (std::size_t)(mHead % mCapacity);
+	std::size_t padding = (alignment - offset % alignment) % alignment;
+	std::size_t wrap = 0;
+
+	// Allocations are contiguous, so one that would cross the end starts over at offset 0.
+	if (offset + padding + size > mCapacity)
+	{
+		wrap = mCapacity - offset;
+		padding = 0;
+		offset = 0;
+	}
+
+	std::uint64_t end = mHead + wrap + padding + size;
+	if (size > mCapacity || end - mTail > mCapacity)
+	{
+		++mStats.Failures;
+		return RingAllocation();
+	}
+
+	offset += padding;
+	mHead = end;
+
+	++mStats.Allocations;
+	mStats.RequestedBytes += size;
+	mStats.PaddingBytes += padding;
+	mStats.WrapBytes += wrap;
+	mStats.PeakUsed = std::max(mStats.PeakUsed, Used());
+
+	RingAllocation allocation;
+	allocation.Cpu = mBackend.CpuAddress() + offset;
+	allocation.Gpu = mBackend.GpuAddress() != 0 ? mBackend.GpuAddress() + offset : 0;
+	allocation.Offset = offset;
+	allocation.Size = size;
+	return allocation;
+}
+
+void LinearRingAllocator::EndFrame(std::uint64_t fence)
+{
+	mFrames.push_back({ fence, mHead });
+	++mStats.Frames;
+}
+
+void LinearRingAllocator::Reclaim(std::uint64_t completedFence)
+{
+	while (!mFrames.empty() && mFrames.front().Fence <= completedFence)
+	{
+		mTail = mFrames.front().End;
+		mFrames.pop_front();
+	}
+}
+
+std::size_t LinearRingAllocator::Capacity() const
+{
+	return mCapacity;
+}
+
+std::size_t LinearRingAllocator::Used() const
+{
+	return (std::size_t)(mHead - mTail);
+}
+
+const RingAllocatorStats& LinearRingAllocator::Stats() const
+{
+	return mStats;
+}
\ No newline at end of file
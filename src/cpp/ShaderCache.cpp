@@ -0,0 +1,185 @@
+#include "ShaderCache.h"
+#include "Hash.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double ElapsedMs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	bool ReadFile(const std::string& path, std::string& contents)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		std::ostringstream stream;
+		stream << file.rdbuf();
+		contents = stream.str();
+		return true;
+	}
+
+	bool WriteFile(const std::string& path, const void* data, std::size_t size)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write((const char*)data, size);
+		return (bool)file;
+	}
+
+	// Missing files hash to 0, which no recorded hash matches in practice.
+	std::uint64_t HashFile(const std::string& path)
+	{
+		std::string contents;
+		if (!ReadFile(path, contents))
+			return 0;
+		return Fnv1a(contents.data(), contents.size());
+	}
+
+	std::uint64_t HashString(const std::string& s, std::uint64_t seed)
+	{
+		// The terminator separates fields, so ("ab", "c") and ("a", "bc") differ.
+		return Fnv1a(s.c_str(), s.size() + 1, seed);
+	}
+}
+
+ShaderCache::ShaderCache(IShaderCompiler& compiler, const std::string& directory) :
+	mCompiler(compiler),
+	mDirectory(directory)
+{
+}
+
+const ShaderCacheStats& ShaderCache::Stats() const
+{
+	return mStats;
+}
+
+std::string ShaderCache::Key(const ShaderRequest& request)
+{
+	std::uint64_t hash = Fnv1aSeed;
+	hash = HashString(request.Path, hash);
+	hash = HashString(request.EntryPoint, hash);
+	hash = HashString(request.Target, hash);
+	hash = HashString(std::to_string(request.Flags), hash);
+	for (const ShaderDefine& define : request.Defines)
+	{
+		hash = HashString(define.Name, hash);
+		hash = HashString(define.Value, hash);
+	}
+
+	char key[17];
+	std::snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+	return key;
+}
+
+bool ShaderCache::IsValid(const std::string& depsPath, const std::string& bytecodePath) const
+{
+	std::ifstream deps(depsPath);
+	if (!deps)
+		return false;
+
+	// Lines of "<kind> <hash> <path>"; the bytecode line names the .cso.
+	std::string kind, path;
+	unsigned long long hash;
+	bool sawBytecode = false;
+	while (deps >> kind >> std::hex >> hash >> std::dec && std::getline(deps >> std::ws, path))
+	{
+		if (kind == "bytecode")
+		{
+			if (path != bytecodePath)
+				return false;
+			sawBytecode = true;
+		}
+
+		if (HashFile(path) != hash)
+			return false;
+	}
+
+	return sawBytecode;
+}
+
+std::string ShaderCache::Resolve(const ShaderRequest& request, std::string* errors)
+{
+	Clock::time_point start = Clock::now();
+
+	std::string stem = std::filesystem::path(request.Path).stem().string();
+	std::string base = (std::filesystem::path(mDirectory) / (stem + "." + request.EntryPoint + "." + Key(request))).generic_string();
+	std::string bytecodePath = base + ".cso";
+	std::string depsPath = base + ".deps";
+
+	bool exists = std::filesystem::exists(depsPath);
+	bool valid = exists && IsValid(depsPath, bytecodePath);
+	mStats.LookupMs += ElapsedMs(start);
+
+	if (valid)
+	{
+		++mStats.Hits;
+		return bytecodePath;
+	}
+
+	if (exists)
+		++mStats.Invalidated;
+	else
+		++mStats.Misses;
+
+	start = Clock::now();
+	ShaderBytecode bytecode;
+	std::vector<std::string> includes;
+	std::string compileErrors;
+	bool compiled = mCompiler.Compile(request, bytecode, includes, compileErrors);
+	mStats.CompileMs += ElapsedMs(start);
+
+	if (errors != nullptr)
+		*errors = compileErrors;
+
+	if (!compiled)
+	{
+		++mStats.Failures;
+		return std::string();
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(mDirectory, error);
+
+	// The manifest is written last: a crash in between leaves an entry that fails validation.
+	std::filesystem::remove(depsPath, error);
+	if (!WriteFile(bytecodePath, bytecode.data(), bytecode.size()))
+	{
+		if (errors != nullptr)
+			*errors = "cannot write " + bytecodePath;
+		++mStats.Failures;
+		return std::string();
+	}
+
+	std::ostringstream deps;
+	deps << std::hex;
+	deps << "source " << HashFile(request.Path) << " " << request.Path << "\n";
+	for (const std::string& include : includes)
+		deps << "include " << HashFile(include) << " " << include << "\n";
+	deps << "bytecode " << Fnv1a(bytecode.data(), bytecode.size()) << " " << bytecodePath << "\n";
+
+	std::string text = deps.str();
+	WriteFile(depsPath, text.data(), text.size());
+	return bytecodePath;
+}
+
+bool ShaderCache::Load(const ShaderRequest& request, ShaderBytecode& bytecode, std::string* errors)
+{
+	std::string path = Resolve(request, errors);
+	if (path.empty())
+		return false;
+
+	std::string contents;
+	if (!ReadFile(path, contents))
+		return false;
+
+	bytecode.assign(contents.begin(), contents.end());
+	return true;
+}
\ No newline at end of file
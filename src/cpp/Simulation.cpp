@@ -0,0 +1,172 @@
+#include "Simulation.h"
+#include "Trace.h"
+#include <algorithm>
+
+Simulation::Simulation(double tickRate) :
+	mTickRate(std::max(tickRate, 1.0)),
+	mDt(1.0 / std::max(tickRate, 1.0))
+{
+}
+
+Simulation::~Simulation()
+{
+	Stop();
+}
+
+void Simulation::Start(const CameraState& initial, InputScript script)
+{
+	Stop();
+
+	mState = initial;
+	mScript = script;
+	mTicks = 0;
+	mStart = std::chrono::steady_clock::now();
+
+	SimulationSnapshot& snapshot = mSnapshots.Back();
+	snapshot = SimulationSnapshot();
+	snapshot.Previous = initial;
+	snapshot.Current = initial;
+	mSnapshots.Publish();
+
+	mRunning = true;
+	mThread = std::thread(&Simulation::ThreadLoop, this);
+}
+
+void Simulation::Stop()
+{
+	mRunning = false;
+	if (mThread.joinable())
+		mThread.join();
+}
+
+double Simulation::TickRate() const
+{
+	return mTickRate;
+}
+
+double Simulation::Dt() const
+{
+	return mDt;
+}
+
+std::uint64_t Simulation::Ticks() const
+{
+	return mTicks;
+}
+
+double Simulation::Now() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+}
+
+void Simulation::Submit(const CameraInput& input)
+{
+	std::lock_guard<std::mutex> lock(mInputMutex);
+
+	int mouseDx = mPendingInput.MouseDx + input.MouseDx;
+	int mouseDy = mPendingInput.MouseDy + input.MouseDy;
+	int powerSteps = mPendingInput.PowerSteps + input.PowerSteps;
+
+	mPendingInput = input;
+	mPendingInput.MouseDx = mouseDx;
+	mPendingInput.MouseDy = mouseDy;
+	mPendingInput.PowerSteps = powerSteps;
+}
+
+CameraState Simulation::Sample(double now)
+{
+	mSnapshots.Update();
+	const SimulationSnapshot& snapshot = mSnapshots.Front();
+
+	// Rendering one tick behind keeps the result between two known states.
+	double t = (now - snapshot.Time) * mTickRate;
+	return Interpolate(snapshot.Previous, snapshot.Current, (float)std::min(std::max(t, 0.0), 1.0));
+}
+
+CameraState Simulation::Sample()
+{
+	return Sample(Now());
+}
+
+void Simulation::StartRecording()
+{
+	std::lock_guard<std::mutex> lock(mInputMutex);
+	mRecordingRequested = true;
+}
+
+bool Simulation::StopRecording(const std::string& path)
+{
+	CameraRecording recording;
+	{
+		std::lock_guard<std::mutex> lock(mInputMutex);
+		mRecordingRequested = false;
+		mRecordingActive = false;
+		recording = mRecording;
+	}
+	return recording.Save(path);
+}
+
+CameraState Simulation::Interpolate(const CameraState& a, const CameraState& b, float t)
+{
+	CameraState state = b;
+	state.Position = a.Position + (b.Position - a.Position) * t;
+	state.Theta = a.Theta + (b.Theta - a.Theta) * t;
+	state.Phi = a.Phi + (b.Phi - a.Phi) * t;
+	state.Power = a.Power + (b.Power - a.Power) * t;
+	return state;
+}
+
+void Simulation::ThreadLoop()
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const Clock::duration dt = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(mDt));
+	const float stepDt = (float)mDt;
+	TRACE_THREAD_NAME("Simulation");
+	Clock::time_point next = mStart;
+
+	while (mRunning)
+	{
+		next += dt;
+		std::this_thread::sleep_until(next);
+
+		// After a long stall (debugger, suspended machine) drop the backlog instead of fast-forwarding.
+		Clock::time_point now = Clock::now();
+		if (now - next > dt * 8)
+			next = now;
+
+		TRACE_SCOPE("Simulation tick");
+
+		CameraInput input;
+		CameraState previous = mState;
+		{
+			std::lock_guard<std::mutex> lock(mInputMutex);
+			input = mPendingInput;
+			mPendingInput.ResetFrameDeltas();
+
+			if (mRecordingRequested && !mRecordingActive)
+			{
+				mRecording.Clear(mState);
+				mRecordingActive = true;
+			}
+		}
+
+		if (mScript)
+			mScript(mTicks, input);
+
+		mController.Step(mState, input, stepDt);
+
+		{
+			std::lock_guard<std::mutex> lock(mInputMutex);
+			if (mRecordingActive)
+				mRecording.Append(stepDt, input, mState);
+		}
+
+		SimulationSnapshot& snapshot = mSnapshots.Back();
+		snapshot.Tick = ++mTicks;
+		snapshot.Time = Now();
+		snapshot.Previous = previous;
+		snapshot.Current = mState;
+		mSnapshots.Publish();
+	}
+}
\ No newline at end of file
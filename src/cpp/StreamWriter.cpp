@@ -0,0 +1,271 @@
+#include "StreamWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifndef _WIN32
+	// Drops the first n bytes of an iovec list, returns the index of the first non-empty entry.
+	int Advance(std::vector<iovec>& iov, int first, std::size_t n)
+	{
+		while (first < (int)iov.size() && n >= iov[first].iov_len)
+		{
+			n -= iov[first].iov_len;
+			++first;
+		}
+		if (first < (int)iov.size())
+		{
+			iov[first].iov_base = (char*)iov[first].iov_base + n;
+			iov[first].iov_len -= n;
+		}
+		return first;
+	}
+
+	std::vector<iovec> ToIovec(const OutputSpan* spans, int count)
+	{
+		std::vector<iovec> iov;
+		for (int i = 0; i < count; ++i)
+		{
+			if (spans[i].Size > 0)
+				iov.push_back(iovec{ const_cast<void*>(spans[i].Data), spans[i].Size });
+		}
+		return iov;
+	}
+#endif
+}
+
+StreamWriter::StreamWriter()
+{
+}
+
+StreamWriter::~StreamWriter()
+{
+	Close();
+}
+
+bool StreamWriter::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	if (path == "-")
+	{
+		mFd = _fileno(stdout);
+		_setmode(mFd, _O_BINARY);
+	}
+	else
+	{
+		mFd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+		mOwnsFd = mFd >= 0;
+	}
+#else
+	if (path == "-")
+		mFd = STDOUT_FILENO;
+	else
+	{
+		mFd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		mOwnsFd = mFd >= 0;
+	}
+
+#ifdef __linux__
+	struct stat info;
+	if (mFd >= 0 && fstat(mFd, &info) == 0 && S_ISFIFO(info.st_mode))
+	{
+		int capacity = fcntl(mFd, F_GETPIPE_SZ);
+		mSplice = capacity > 0;
+		mPipeCapacity = capacity > 0 ? (std::size_t)capacity : 0;
+	}
+#endif
+#endif
+
+	mBytesWritten = 0;
+	return mFd >= 0;
+}
+
+bool StreamWriter::Reopen(const std::string& path, std::uint64_t size)
+{
+	Close();
+
+#ifdef _WIN32
+	mFd = _open(path.c_str(), _O_WRONLY | _O_BINARY);
+	bool ok = mFd >= 0 && _chsize_s(mFd, (__int64)size) == 0 && _lseeki64(mFd, (__int64)size, SEEK_SET) == (__int64)size;
+#else
+	mFd = open(path.c_str(), O_WRONLY);
+	bool ok = mFd >= 0 && ftruncate(mFd, (off_t)size) == 0 && lseek(mFd, (off_t)size, SEEK_SET) == (off_t)size;
+#endif
+
+	mOwnsFd = mFd >= 0;
+	mBytesWritten = 0;
+	if (!ok)
+		Close();
+	return ok;
+}
+
+bool StreamWriter::Close()
+{
+	bool ok = true;
+	if (mOwnsFd)
+	{
+#ifdef _WIN32
+		ok = _close(mFd) == 0;
+#else
+		ok = close(mFd) == 0;
+#endif
+	}
+
+	mFd = -1;
+	mOwnsFd = false;
+	mSplice = false;
+	mPipeCapacity = 0;
+	return ok;
+}
+
+bool StreamWriter::IsOpen() const
+{
+	return mFd >= 0;
+}
+
+std::size_t StreamWriter::RetainBytes() const
+{
+	return mSplice ? mPipeCapacity : 0;
+}
+
+std::uint64_t StreamWriter::BytesWritten() const
+{
+	return mBytesWritten;
+}
+
+bool StreamWriter::Write(const OutputSpan* spans, int count)
+{
+	if (mFd < 0)
+		return false;
+
+	// A splice that fails before the first byte (e.g. unsupported) switches to copying.
+	if (mSplice)
+		return WriteSplice(spans, count) || (!mSplice && WriteCopy(spans, count));
+
+	return WriteCopy(spans, count);
+}
+
+#ifdef _WIN32
+
+bool StreamWriter::WriteCopy(const OutputSpan* spans, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		const char* data = (const char*)spans[i].Data;
+		std::size_t left = spans[i].Size;
+		while (left > 0)
+		{
+			int chunk = (int)std::min<std::size_t>(left, 1 << 30);
+			int written = _write(mFd, data, chunk);
+			if (written <= 0)
+				return false;
+			data += written;
+			left -= written;
+			mBytesWritten += written;
+		}
+	}
+	return true;
+}
+
+bool StreamWriter::WriteSplice(const OutputSpan* spans, int count)
+{
+	return false;
+}
+
+void StreamWriter::Drain()
+{
+}
+
+#else
+
+bool StreamWriter::WriteCopy(const OutputSpan* spans, int count)
+{
+	std::vector<iovec> iov = ToIovec(spans, count);
+
+	int first = 0;
+	while (first < (int)iov.size())
+	{
+		int n = std::min((int)iov.size() - first, IOV_MAX);
+		ssize_t written = writev(mFd, &iov[first], n);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+
+		mBytesWritten += written;
+		first = Advance(iov, first, (std::size_t)written);
+	}
+	return true;
+}
+
+bool StreamWriter::WriteSplice(const OutputSpan* spans, int count)
+{
+#ifdef __linux__
+	std::vector<iovec> iov = ToIovec(spans, count);
+
+	int first = 0;
+	while (first < (int)iov.size())
+	{
+		int n = std::min((int)iov.size() - first, IOV_MAX);
+		ssize_t written = vmsplice(mFd, &iov[first], n, 0);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+		{
+			if (mBytesWritten == 0)
+				mSplice = false;
+			return false;
+		}
+
+		mBytesWritten += written;
+		first = Advance(iov, first, (std::size_t)written);
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void StreamWriter::Drain()
+{
+#ifdef __linux__
+	if (!mSplice)
+		return;
+
+	// A reader that exits leaves the data unread: POLLERR says so. One that stops
+	// reading is given up on after a while rather than hanging the writer.
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+	int pending = 0;
+	while (ioctl(mFd, FIONREAD, &pending) == 0 && pending > 0)
+	{
+		pollfd fd = { mFd, 0, 0 };
+		if (poll(&fd, 1, 0) > 0 && (fd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0)
+			return;
+		if (std::chrono::steady_clock::now() >= deadline)
+			return;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+#endif
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "TiledRenderer.h"
+#include "Checkpoint.h"
+#include "Hash.h"
+#include "TiledTiff.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+
+TiledRenderer::TiledRenderer(const TiledRenderOptions& options) :
+	mOptions(options)
+{
+}
+
+bool TiledRenderer::Run()
+{
+	typedef std::chrono::steady_clock Clock;
+	auto start = Clock::now();
+
+	const int width = mOptions.Width;
+	const int height = mOptions.Height;
+	const int tileSize = mOptions.TileSize;
+
+	mStats = TiledRenderStats();
+	if (const char* error = TiledTiff::LayoutError(width, height, tileSize))
+	{
+		mError = error;
+		return false;
+	}
+	if (mOptions.Settings.AntiAlias.Enabled && tileSize % std::max(mOptions.Settings.TileSize, 1) != 0)
+	{
+		mError = "with anti-aliasing the tile size must be a multiple of the render tile size";
+		return false;
+	}
+
+	// Tiles are multiples of 16, so these factors keep every tile on the low-resolution grid.
+	const int factor = mOptions.Settings.Upsample.Factor;
+	if (factor != 1 && factor != 2 && factor != 4)
+	{
+		mError = "the upsample factor must be 1, 2 or 4";
+		return false;
+	}
+
+	const bool bigTiff = TiledTiff::NeedsBigTiff(width, height, tileSize);
+	TiledTiff tiff;
+	Checkpoint checkpoint(CheckpointPath(), Signature(), mOptions.CheckpointSeconds);
+	mStats.Resumed = checkpoint.Load() && tiff.Open(mOptions.Output, width, height, tileSize, mOptions.Dpi, bigTiff);
+
+	if (!mStats.Resumed)
+	{
+		checkpoint.Discard();
+		if (!tiff.Create(mOptions.Output, width, height, tileSize, mOptions.Dpi, bigTiff))
+		{
+			mError = tiff.Error();
+			return false;
+		}
+	}
+
+	std::vector<std::uint8_t> rgb(tiff.TileBytes());
+	std::vector<bool> done((std::size_t)tiff.TilesX() * tiff.TilesY(), false);
+
+	// Tiles whose data did not reach the disk before an interruption are rendered again.
+	std::vector<int> damaged;
+	for (const auto& item : checkpoint.Items())
+	{
+		int index = item.first;
+		bool valid = index >= 0 && index < (int)done.size() && tiff.ReadTile(index % tiff.TilesX(), index / tiff.TilesX(), rgb.data())
+			&& Fnv1a(rgb.data(), rgb.size()) == item.second;
+		if (valid)
+			done[index] = true;
+		else
+			damaged.push_back(index);
+	}
+	for (int index : damaged)
+		checkpoint.Remove(index);
+	mStats.Damaged = (int)damaged.size();
+
+	CpuRenderer renderer(mOptions.Threads);
+	CpuFramebuffer target;
+
+	RenderSettings settings = mOptions.Settings;
+	settings.Region.FullWidth = width;
+	settings.Region.FullHeight = height;
+	const int apron = Apron();
+
+	mStats.Tiles = (int)done.size();
+	for (int ty = 0; ty < tiff.TilesY(); ++ty)
+	{
+		for (int tx = 0; tx < tiff.TilesX(); ++tx)
+		{
+			int index = ty * tiff.TilesX() + tx;
+			if (done[index])
+			{
+				++mStats.Skipped;
+				continue;
+			}
+			if (mOptions.MaxTiles > 0 && mStats.Rendered >= mOptions.MaxTiles)
+				continue;
+
+			int x0 = tx * tileSize;
+			int y0 = ty * tileSize;
+			int x1 = std::min(x0 + tileSize, width);
+			int y1 = std::min(y0 + tileSize, height);
+
+			int wx0 = std::max(x0 - apron, 0);
+			int wy0 = std::max(y0 - apron, 0);
+			int wx1 = std::min(x1 + apron, width);
+			int wy1 = std::min(y1 + apron, height);
+			if (target.Width != wx1 - wx0 || target.Height != wy1 - wy0)
+				target.Resize(wx1 - wx0, wy1 - wy0);
+
+			settings.Region.X = wx0;
+			settings.Region.Y = wy0;
+			renderer.Render(mOptions.Camera, settings, target);
+
+			// Crop the apron; the padding of edge tiles stays black.
+			std::fill(rgb.begin(), rgb.end(), 0);
+			for (int y = y0; y < y1; ++y)
+			{
+				for (int x = x0; x < x1; ++x)
+				{
+					std::uint32_t color = target.Color[(std::size_t)(y - wy0) * target.Width + (x - wx0)];
+					std::uint8_t* out = &rgb[((std::size_t)(y - y0) * tileSize + (x - x0)) * 3];
+					out[0] = (std::uint8_t)color;
+					out[1] = (std::uint8_t)(color >> 8);
+					out[2] = (std::uint8_t)(color >> 16);
+				}
+			}
+
+			if (!tiff.WriteTile(tx, ty, rgb.data()))
+			{
+				mError = tiff.Error();
+				return false;
+			}
+
+			checkpoint.Add(index, Fnv1a(rgb.data(), rgb.size()));
+			if (!checkpoint.Update())
+			{
+				mError = "cannot write " + checkpoint.Path();
+				return false;
+			}
+			done[index] = true;
+			++mStats.Rendered;
+			mStats.BytesWritten += tiff.TileBytes();
+		}
+	}
+
+	if (!tiff.Close())
+	{
+		mError = tiff.Error();
+		return false;
+	}
+
+	if (Finished())
+		checkpoint.Discard();
+	else if (!checkpoint.Save())
+	{
+		mError = "cannot write " + checkpoint.Path();
+		return false;
+	}
+
+	mStats.CheckpointMs = checkpoint.SaveMs();
+
+	mStats.TotalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	return true;
+}
+
+bool TiledRenderer::Finished() const
+{
+	return mStats.Tiles > 0 && mStats.Rendered + mStats.Skipped == mStats.Tiles;
+}
+
+const TiledRenderStats& TiledRenderer::Stats() const
+{
+	return mStats;
+}
+
+const std::string& TiledRenderer::Error() const
+{
+	return mError;
+}
+
+std::string TiledRenderer::CheckpointPath() const
+{
+	return mOptions.Output + ".checkpoint";
+}
+
+std::string TiledRenderer::Signature() const
+{
+	char buffer[64];
+	std::snprintf(buffer, sizeof(buffer), "tiled %dx%d tile %d dpi %d ", mOptions.Width, mOptions.Height, mOptions.TileSize, mOptions.Dpi);
+	return buffer + CameraSignature(mOptions.Camera) + " " + SettingsSignature(mOptions.Settings);
+}
+
+int TiledRenderer::Apron() const
+{
+	// Covers the widest neighbourhood a pass reads: the upsampling taps, one
+	// low-resolution pixel away. It is a multiple of the factor, so windows keep
+	// the low-resolution grid of the whole image.
+	int apron = 4 * std::max(mOptions.Settings.Upsample.Factor, 1);
+
+	// Anti-aliasing spends a sample budget per render tile, so windows must also
+	// keep the render tile grid of the whole image.
+	if (mOptions.Settings.AntiAlias.Enabled)
+	{
+		int grid = std::lcm(std::max(mOptions.Settings.TileSize, 1), std::max(mOptions.Settings.Upsample.Factor, 1));
+		apron = (apron + grid - 1) / grid * grid;
+	}
+	return apron;
+}
+
+int TiledRenderer::RunDefault(const TiledRenderOptions& options)
+{
+	TiledRenderer renderer(options);
+	bool ok = renderer.Run();
+	if (!ok)
+	{
+		std::fprintf(stderr, "tiled render failed: %s\n", renderer.Error().c_str());
+		return 1;
+	}
+
+	const TiledRenderStats& stats = renderer.Stats();
+	double pixels = (double)stats.Rendered * options.TileSize * options.TileSize;
+	std::fprintf(stderr, "%d of %d tiles rendered%s in %.1f s (%.2f Mpixel/s), %.1f MB written\n",
+		stats.Rendered, stats.Tiles, stats.Resumed ? " (resumed)" : "",
+		stats.TotalMs / 1000.0, pixels / 1e3 / std::max(stats.TotalMs, 1e-3), stats.BytesWritten / 1e6);
+	if (stats.Damaged > 0)
+		std::fprintf(stderr, "%d checkpointed tiles failed their checksum and were rendered again\n", stats.Damaged);
+	std::fprintf(stderr, "checkpoints took %.1f ms (%.2f%% of the run)\n", stats.CheckpointMs, 100.0 * stats.CheckpointMs / std::max(stats.TotalMs, 1e-3));
+
+	if (!renderer.Finished())
+		std::fprintf(stderr, "%d tiles left; run the same command again to continue\n", stats.Tiles - stats.Rendered - stats.Skipped);
+	return 0;
+}
\ No newline at end of file
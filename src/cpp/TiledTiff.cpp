@@ -0,0 +1,287 @@
+#include "TiledTiff.h"
+#include <cstring>
+
+namespace
+{
+	enum TiffType : std::uint16_t
+	{
+		TypeShort = 3,
+		TypeLong = 4,
+		TypeRational = 5,
+		TypeLong8 = 16
+	};
+
+	struct Entry
+	{
+		std::uint16_t Tag;
+		std::uint16_t Type;
+		std::uint64_t Count;
+		std::vector<std::uint8_t> Value; // little endian
+	};
+
+	void Put(std::vector<std::uint8_t>& out, std::uint64_t value, int bytes)
+	{
+		for (int i = 0; i < bytes; ++i)
+			out.push_back((std::uint8_t)(value >> (8 * i)));
+	}
+
+	void PutAt(std::vector<std::uint8_t>& out, std::size_t offset, std::uint64_t value, int bytes)
+	{
+		for (int i = 0; i < bytes; ++i)
+			out[offset + i] = (std::uint8_t)(value >> (8 * i));
+	}
+
+	Entry Values(std::uint16_t tag, std::uint16_t type, const std::vector<std::uint64_t>& values)
+	{
+		int bytes = type == TypeShort ? 2 : (type == TypeLong ? 4 : 8);
+		Entry entry = { tag, type, values.size(), {} };
+		for (std::uint64_t value : values)
+			Put(entry.Value, value, bytes);
+		return entry;
+	}
+
+	Entry Rational(std::uint16_t tag, std::uint32_t numerator, std::uint32_t denominator)
+	{
+		Entry entry = { tag, TypeRational, 1, {} };
+		Put(entry.Value, numerator, 4);
+		Put(entry.Value, denominator, 4);
+		return entry;
+	}
+
+	// Data starts at a round offset, well clear of the tables.
+	const std::uint64_t DataAlignment = 4096;
+}
+
+const char* TiledTiff::LayoutError(int width, int height, int tileSize)
+{
+	if (width <= 0 || height <= 0)
+		return "image size must be positive";
+	if (tileSize <= 0 || tileSize % 16 != 0)
+		return "tile size must be a positive multiple of 16";
+	return nullptr;
+}
+
+bool TiledTiff::NeedsBigTiff(int width, int height, int tileSize)
+{
+	if (LayoutError(width, height, tileSize) != nullptr)
+		return false;
+
+	std::uint64_t tiles = (std::uint64_t)((width + tileSize - 1) / tileSize) * ((height + tileSize - 1) / tileSize);
+	std::uint64_t data = tiles * tileSize * tileSize * 3;
+
+	// Generous room for the classic header and its two tile tables.
+	return data + tiles * 8 + 2 * DataAlignment > 0xFFFFFFFFull;
+}
+
+void TiledTiff::SetLayout(int width, int height, int tileSize, int dpi, bool bigTiff)
+{
+	mWidth = width;
+	mHeight = height;
+	mTileSize = tileSize;
+	mDpi = dpi;
+	mBigTiff = bigTiff;
+	mTilesX = (width + tileSize - 1) / tileSize;
+	mTilesY = (height + tileSize - 1) / tileSize;
+
+	// The header size does not depend on the offsets it holds, so it is built once to measure it.
+	mDataOffset = 0;
+	std::uint64_t size = BuildHeader().size();
+	mDataOffset = (size + DataAlignment - 1) / DataAlignment * DataAlignment;
+}
+
+std::vector<std::uint8_t> TiledTiff::BuildHeader() const
+{
+	const std::uint64_t tiles = (std::uint64_t)mTilesX * mTilesY;
+	const std::uint16_t offsetType = mBigTiff ? TypeLong8 : TypeLong;
+
+	std::vector<std::uint64_t> offsets(tiles);
+	std::vector<std::uint64_t> counts(tiles, TileBytes());
+	for (std::uint64_t i = 0; i < tiles; ++i)
+		offsets[i] = mDataOffset + i * TileBytes();
+
+	// Tags in ascending order, as TIFF requires.
+	std::vector<Entry> entries;
+	entries.push_back(Values(256, TypeLong, { (std::uint64_t)mWidth }));     // ImageWidth
+	entries.push_back(Values(257, TypeLong, { (std::uint64_t)mHeight }));    // ImageLength
+	entries.push_back(Values(258, TypeShort, { 8, 8, 8 }));                  // BitsPerSample
+	entries.push_back(Values(259, TypeShort, { 1 }));                        // Compression: none
+	entries.push_back(Values(262, TypeShort, { 2 }));                        // PhotometricInterpretation: RGB
+	entries.push_back(Values(277, TypeShort, { 3 }));                        // SamplesPerPixel
+	entries.push_back(Rational(282, (std::uint32_t)mDpi, 1));                // XResolution
+	entries.push_back(Rational(283, (std::uint32_t)mDpi, 1));                // YResolution
+	entries.push_back(Values(284, TypeShort, { 1 }));                        // PlanarConfiguration: interleaved
+	entries.push_back(Values(296, TypeShort, { 2 }));                        // ResolutionUnit: inch
+	entries.push_back(Values(322, TypeLong, { (std::uint64_t)mTileSize }));  // TileWidth
+	entries.push_back(Values(323, TypeLong, { (std::uint64_t)mTileSize }));  // TileLength
+	entries.push_back(Values(324, offsetType, offsets));                     // TileOffsets
+	entries.push_back(Values(325, offsetType, counts));                      // TileByteCounts
+
+	// Classic: 8-byte header, 2-byte entry count, 12-byte entries, 4-byte offsets.
+	// BigTIFF: 16-byte header, 8-byte entry count, 20-byte entries, 8-byte offsets.
+	const int word = mBigTiff ? 8 : 4;
+	const std::size_t headerSize = mBigTiff ? 16 : 8;
+	const std::size_t entrySize = mBigTiff ? 20 : 12;
+
+	std::vector<std::uint8_t> out;
+	out.push_back('I');
+	out.push_back('I');
+	if (mBigTiff)
+	{
+		Put(out, 43, 2);
+		Put(out, 8, 2);
+		Put(out, 0, 2);
+		Put(out, headerSize, 8);
+	}
+	else
+	{
+		Put(out, 42, 2);
+		Put(out, headerSize, 4);
+	}
+
+	Put(out, entries.size(), mBigTiff ? 8 : 2);
+	std::size_t firstEntry = out.size();
+	out.resize(out.size() + entries.size() * entrySize + word, 0); // entries, then a zero next-IFD offset
+
+	// Values that do not fit in an entry go after the IFD, word aligned.
+	for (std::size_t i = 0; i < entries.size(); ++i)
+	{
+		const Entry& entry = entries[i];
+		std::size_t at = firstEntry + i * entrySize;
+		PutAt(out, at, entry.Tag, 2);
+		PutAt(out, at + 2, entry.Type, 2);
+		PutAt(out, at + 4, entry.Count, word);
+
+		if (entry.Value.size() <= (std::size_t)word)
+		{
+			std::memcpy(&out[at + 4 + word], entry.Value.data(), entry.Value.size());
+			continue;
+		}
+
+		out.resize((out.size() + word - 1) / word * word, 0);
+		PutAt(out, at + 4 + word, out.size(), word);
+		out.insert(out.end(), entry.Value.begin(), entry.Value.end());
+	}
+
+	return out;
+}
+
+bool TiledTiff::Create(const std::string& path, int width, int height, int tileSize, int dpi, bool bigTiff)
+{
+	Close();
+	if (const char* error = LayoutError(width, height, tileSize))
+		return Fail(error);
+	if (!bigTiff && NeedsBigTiff(width, height, tileSize))
+		return Fail("image too large for a classic TIFF");
+
+	SetLayout(width, height, tileSize, dpi, bigTiff);
+
+	mFile.open(path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+	if (!mFile)
+		return Fail("cannot create " + path);
+
+	std::vector<std::uint8_t> header = BuildHeader();
+	mFile.write((const char*)header.data(), header.size());
+
+	// Size the file up front (sparse where the file system allows), so every
+	// tile already has its place even if the render stops early.
+	std::uint64_t end = mDataOffset + (std::uint64_t)mTilesX * mTilesY * TileBytes();
+	mFile.seekp((std::streamoff)(end - 1));
+	mFile.put(0);
+	mFile.flush();
+
+	return mFile ? true : Fail("cannot write " + path);
+}
+
+bool TiledTiff::Open(const std::string& path, int width, int height, int tileSize, int dpi, bool bigTiff)
+{
+	Close();
+	SetLayout(width, height, tileSize, dpi, bigTiff);
+
+	mFile.open(path, std::ios::binary | std::ios::in | std::ios::out);
+	if (!mFile)
+		return Fail("cannot open " + path);
+
+	// A file with the same layout has exactly the header Create would write.
+	std::vector<std::uint8_t> expected = BuildHeader();
+	std::vector<std::uint8_t> header(expected.size());
+	mFile.read((char*)header.data(), header.size());
+	if (!mFile || header != expected)
+	{
+		Close();
+		return Fail(path + " has a different layout");
+	}
+
+	// A truncated file would leave the last tiles unreadable.
+	mFile.seekg(0, std::ios::end);
+	if ((std::uint64_t)mFile.tellg() != mDataOffset + (std::uint64_t)mTilesX * mTilesY * TileBytes())
+	{
+		Close();
+		return Fail(path + " has a different size");
+	}
+	return true;
+}
+
+bool TiledTiff::Close()
+{
+	if (!mFile.is_open())
+		return true;
+
+	mFile.flush();
+	bool ok = (bool)mFile;
+	mFile.close();
+	mFile.clear();
+	return ok;
+}
+
+bool TiledTiff::WriteTile(int tileX, int tileY, const std::uint8_t* rgb)
+{
+	std::uint64_t index = (std::uint64_t)tileY * mTilesX + tileX;
+	mFile.seekp((std::streamoff)(mDataOffset + index * TileBytes()));
+	mFile.write((const char*)rgb, TileBytes());
+	mFile.flush();
+	if (mFile)
+		return true;
+
+	// Clear the error so a failed tile does not fail every later one.
+	mFile.clear();
+	return Fail("tile write failed");
+}
+
+bool TiledTiff::ReadTile(int tileX, int tileY, std::uint8_t* rgb)
+{
+	std::uint64_t index = (std::uint64_t)tileY * mTilesX + tileX;
+	mFile.seekg((std::streamoff)(mDataOffset + index * TileBytes()));
+	mFile.read((char*)rgb, TileBytes());
+	if (mFile)
+		return true;
+
+	// A short read sets eof and fail; later writes would fail with them set.
+	mFile.clear();
+	return Fail("tile read failed");
+}
+
+int TiledTiff::TilesX() const
+{
+	return mTilesX;
+}
+
+int TiledTiff::TilesY() const
+{
+	return mTilesY;
+}
+
+std::size_t TiledTiff::TileBytes() const
+{
+	return (std::size_t)mTileSize * mTileSize * 3;
+}
+
+const std::string& TiledTiff::Error() const
+{
+	return mError;
+}
+
+bool TiledTiff::Fail(const std::string& error)
+{
+	mError = error;
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,254 @@
+#include "Trace.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	struct TraceEvent
+	{
+		const char* Name;
+		std::uint64_t Begin;
+		std::uint64_t End;
+	};
+
+	// Events are only appended by the owning thread. Count is published with
+	// release so the writer can read a consistent prefix while tracing continues.
+	struct TraceChunk
+	{
+		static const int Capacity = 4096;
+
+		TraceEvent Events[Capacity];
+		std::atomic<int> Count{ 0 };
+		std::atomic<TraceChunk*> Next{ nullptr };
+	};
+
+	struct ThreadBuffer
+	{
+		int ThreadId = 0;
+		std::string Name;
+
+		// Chunks are allocated by the first zone of a session, not for a name alone.
+		TraceChunk* Head = nullptr;
+		TraceChunk* Tail = nullptr;
+		std::uint64_t Session = 0;
+		bool Exited = false;
+
+		~ThreadBuffer()
+		{
+			FreeChunks(Head);
+		}
+
+		static void FreeChunks(TraceChunk* chunk)
+		{
+			while (chunk != nullptr)
+			{
+				TraceChunk* next = chunk->Next.load();
+				delete chunk;
+				chunk = next;
+			}
+		}
+	};
+
+	// Buffers outlive their threads so zones of finished workers still get written;
+	// they are freed once written, or when the next session starts.
+	struct Registry
+	{
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+		std::atomic<std::uint64_t> StartTime{ 0 };
+		std::atomic<std::uint64_t> Session{ 1 };
+		int NextThreadId = 1;
+
+		void FreeExited()
+		{
+			std::size_t kept = 0;
+			for (std::size_t i = 0; i < Buffers.size(); ++i)
+			{
+				if (!Buffers[i]->Exited)
+					Buffers[kept++] = std::move(Buffers[i]);
+			}
+			Buffers.resize(kept);
+		}
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local ThreadBuffer* tBuffer = nullptr;
+
+	// Hands the buffer back when its thread exits.
+	struct ThreadExit
+	{
+		~ThreadExit()
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.Mutex);
+			tBuffer->Exited = true;
+
+			// Nothing left to write unless the thread recorded zones in this session.
+			if (tBuffer->Session != registry.Session)
+			{
+				for (auto it = registry.Buffers.begin(); it != registry.Buffers.end(); ++it)
+				{
+					if (it->get() == tBuffer)
+					{
+						registry.Buffers.erase(it);
+						break;
+					}
+				}
+			}
+			tBuffer = nullptr;
+		}
+	};
+
+	ThreadBuffer& LocalBuffer()
+	{
+		if (tBuffer == nullptr)
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.Mutex);
+
+			std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+			buffer->ThreadId = registry.NextThreadId++;
+
+			tBuffer = buffer.get();
+			registry.Buffers.push_back(std::move(buffer));
+		}
+
+		thread_local ThreadExit exit;
+		return *tBuffer;
+	}
+
+	// The first zone of a thread in a session reuses the thread's first chunk and
+	// frees the rest, under the lock so WriteJson never reads a freed chunk.
+	void BeginSession(ThreadBuffer& buffer, std::uint64_t session)
+	{
+		std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+		if (buffer.Head == nullptr)
+			buffer.Head = new TraceChunk();
+
+		ThreadBuffer::FreeChunks(buffer.Head->Next.exchange(nullptr));
+		buffer.Head->Count.store(0, std::memory_order_release);
+		buffer.Tail = buffer.Head;
+		buffer.Session = session;
+	}
+
+	void WriteEscaped(std::FILE* file, const char* text)
+	{
+		for (; *text != '\0'; ++text)
+		{
+			if (*text == '"' || *text == '\\')
+				std::fputc('\\', file);
+			std::fputc(*text, file);
+		}
+	}
+}
+
+std::atomic<bool> Trace::sActive{ false };
+
+void Trace::Start()
+{
+	Registry& registry = GetRegistry();
+	{
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+		registry.FreeExited();
+	}
+
+	++registry.Session;
+	registry.StartTime = Now();
+	sActive = true;
+}
+
+void Trace::Stop()
+{
+	sActive = false;
+}
+
+std::uint64_t Trace::Now()
+{
+	return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::SetThreadName(const char* name)
+{
+	ThreadBuffer& buffer = LocalBuffer();
+
+	std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+	buffer.Name = name;
+}
+
+void Trace::Record(const char* name, std::uint64_t begin, std::uint64_t end)
+{
+	ThreadBuffer& buffer = LocalBuffer();
+	std::uint64_t session = GetRegistry().Session.load(std::memory_order_relaxed);
+	if (buffer.Session != session)
+		BeginSession(buffer, session);
+
+	TraceChunk* chunk = buffer.Tail;
+
+	int count = chunk->Count.load(std::memory_order_relaxed);
+	if (count == TraceChunk::Capacity)
+	{
+		TraceChunk* next = new TraceChunk();
+		chunk->Next.store(next, std::memory_order_release);
+		buffer.Tail = chunk = next;
+		count = 0;
+	}
+
+	chunk->Events[count] = TraceEvent{ name, begin, end };
+	chunk->Count.store(count + 1, std::memory_order_release);
+}
+
+bool Trace::WriteJson(const std::string& path)
+{
+	std::FILE* file = std::fopen(path.c_str(), "w");
+	if (file == nullptr)
+		return false;
+
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	const std::uint64_t start = registry.StartTime;
+	const std::uint64_t session = registry.Session;
+
+	std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	std::fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"RayMarching\"}}");
+
+	for (const auto& buffer : registry.Buffers)
+	{
+		if (!buffer->Name.empty())
+		{
+			std::fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"", buffer->ThreadId);
+			WriteEscaped(file, buffer->Name.c_str());
+			std::fprintf(file, "\"}}");
+		}
+
+		// A thread without zones since Start still holds the previous session's.
+		TraceChunk* head = buffer->Session == session ? buffer->Head : nullptr;
+		for (TraceChunk* chunk = head; chunk != nullptr; chunk = chunk->Next.load(std::memory_order_acquire))
+		{
+			int count = chunk->Count.load(std::memory_order_acquire);
+			for (int i = 0; i < count; ++i)
+			{
+				const TraceEvent& event = chunk->Events[i];
+				if (event.Begin < start)
+					continue;
+
+				std::fprintf(file, ",\n{\"name\":\"");
+				WriteEscaped(file, event.Name);
+				std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					buffer->ThreadId, (event.Begin - start) / 1000.0, (event.End - event.Begin) / 1000.0);
+			}
+		}
+	}
+
+	std::fprintf(file, "\n]}\n");
+	registry.FreeExited();
+	return std::fclose(file) == 0;
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "d3dApp.h"
+#include "Trace.h"
 #include <Windowsx.h>
 
 using Microsoft::WRL::ComPtr;
@@ -66,6 +67,7 @@ int D3DApp::Run()
 	MSG msg = { 0 };
 
 	mTimer.Reset();
+	TRACE_THREAD_NAME("Main");
 
 	while (msg.message != WM_QUIT)
 	{
@@ -80,9 +82,12 @@ int D3DApp::Run()
 
 			if (!mAppPaused)
 			{
-				CalculateFrameStats();
+				TRACE_SCOPE("Frame");
+				mFrameStats.BeginFrame();
 				Update(mTimer);
 				Draw(mTimer);
+				mFrameStats.EndFrame();
+				CalculateFrameStats();
 			}
 			else
 			{
@@ -104,6 +109,9 @@ bool D3DApp::Initialize()
 
 	OnResize();
 
+	// Failing to open the query socket is not fatal; the window title still shows the stats.
+	mFrameStats.StartServer(FrameStats::DefaultSocketPath());
+
 	return true;
 }
 
@@ -520,6 +528,7 @@ void D3DApp::CreateSwapChain()
 
 void D3DApp::FlushCommandQueue()
 {
+	TRACE_SCOPE("FlushCommandQueue");
 	mCurrentFence++;
 
 	ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
@@ -556,27 +565,18 @@ D3D12_CPU_DESCRIPTOR_HANDLE D3DApp::DepthStencilView() const
 
 void D3DApp::CalculateFrameStats()
 {
-	static int frameCnt = 0;
-	static float timeElapsed = 0.0f;
-
-	++frameCnt;
-
-	if ((mTimer.TotalTime() - timeElapsed) >= 1.0f)
+	if ((mTimer.TotalTime() - mTitleRefreshTime) >= 1.0f)
 	{
-		float fps = (float)frameCnt;
-		float mspf = 1000.0f / fps;
-
-		wstring fpsStr = to_wstring(fps);
-		wstring mspfStr = to_wstring(mspf);
+		FrameStatsSummary summary = mFrameStats.Summarize();
 
-		wstring windowText = mMainWndCaption +
-			L"	fps: " + fpsStr +
-			L" mspf: " + mspfStr;
+		wchar_t stats[128];
+		swprintf_s(stats, L"	fps: %.1f mspf: %.2f p95: %.2f p99: %.2f",
+			summary.Fps, summary.FrameMs.Mean, summary.FrameMs.P95, summary.FrameMs.P99);
 
+		wstring windowText = mMainWndCaption + stats;
 		SetWindowText(mhMainWnd, windowText.c_str());
 
-		frameCnt = 0;
-		timeElapsed += 1.0f;
+		mTitleRefreshTime += 1.0f;
 	}
 }
 
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bump allocator for transient data. Allocations are never freed individually:
+// Rewind drops everything allocated since a Mark, and Reset drops everything.
+// Blocks are kept, so once an arena has seen its largest frame it takes nothing
+// more from the heap. Not thread safe; give each thread its own.
+class Arena
+{
+public:
+	struct Marker
+	{
+		std::size_t Block = 0;
+		std::size_t Offset = 0;
+	};
+
+	explicit Arena(std::size_t blockSize = 256 * 1024);
+	Arena(const Arena& rhs) = delete;
+	Arena& operator=(const Arena& rhs) = delete;
+
+	void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+	// Uninitialized storage for count objects.
+	template<typename T>
+	T* Allocate(std::size_t count)
+	{
+		return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	Marker Mark() const;
+	void Rewind(const Marker& marker);
+
+	// Call at frame boundaries. A frame that spilled into several blocks leaves
+	// one block large enough for all of it, so later frames stay in one block.
+	void Reset();
+
+	std::size_t Used() const;
+	std::size_t PeakUsed() const;
+	std::size_t Capacity() const;
+
+	// Blocks taken from the heap since construction.
+	std::uint64_t HeapAllocations() const;
+
+private:
+	struct Block
+	{
+		std::unique_ptr<std::uint8_t[]> Memory;
+		std::size_t Size = 0;
+	};
+
+	void AddBlock(std::size_t size);
+
+private:
+	std::vector<Block> mBlocks;
+	std::size_t mBlock = 0;
+	std::size_t mOffset = 0;
+	std::size_t mBlockSize;
+	std::size_t mPeakUsed = 0;
+	std::uint64_t mHeapAllocations = 0;
+};
+
+// Rewinds an arena to where it was when the scope was entered.
+class ArenaScope
+{
+public:
+	explicit ArenaScope(Arena& arena) :
+		mArena(arena),
+		mMarker(arena.Mark())
+	{
+	}
+
+	ArenaScope(const ArenaScope& rhs) = delete;
+	ArenaScope& operator=(const ArenaScope& rhs) = delete;
+
+	~ArenaScope()
+	{
+		mArena.Rewind(mMarker);
+	}
+
+private:
+	Arena& mArena;
+	Arena::Marker mMarker;
+};
+
+// STL allocator over an arena. deallocate is a no-op, so containers should
+// reserve what they need up front rather than grow.
+template<typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	explicit ArenaAllocator(Arena& arena) :
+		mArena(&arena)
+	{
+	}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& rhs) :
+		mArena(rhs.GetArena())
+	{
+	}
+
+	T* allocate(std::size_t count)
+	{
+		return mArena->Allocate<T>(count);
+	}
+
+	void deallocate(T* pointer, std::size_t count)
+	{
+	}
+
+	Arena* GetArena() const
+	{
+		return mArena;
+	}
+
+private:
+	Arena* mArena;
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+	return a.GetArena() == b.GetArena();
+}
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+	return a.GetArena() != b.GetArena();
+}
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
\ No newline at end of file
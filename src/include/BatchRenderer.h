@@ -0,0 +1,144 @@
+#pragma once
+
+#include "CameraPath.h"
+#include "Checkpoint.h"
+#include "CpuRenderer.h"
+#include "FrameStats.h"
+#include "StreamWriter.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class BatchFormat
+{
+	Ppm,     // one numbered P6 image per frame
+	Y4m,     // a single YUV4MPEG2 stream, 4:2:0
+	RawRgba, // headerless RGBA8 frames, written straight from the framebuffer
+	RawYuv   // headerless I420 frames
+};
+
+// A FractalPower sweep rendered offline, the batch counterpart of holding an arrow key.
+struct BatchOptions
+{
+	float PowerStart = 8.0f;
+	float PowerEnd = 8.0f;
+	int FrameCount = 60;
+	int Fps = 30;
+
+	// The camera moves linearly from CameraStart to CameraEnd over the sweep.
+	CpuCamera CameraStart;
+	CpuCamera CameraEnd;
+
+	// If set, replaces the sweep: frame i shows the path (camera and power) at time i / Fps.
+	std::shared_ptr<const CameraPath> Path;
+
+	int Width = 640;
+	int Height = 360;
+	int Threads = 0;
+
+	RenderSettings Settings;
+
+	// A printf pattern with one integer for Ppm ("frame_%05d.ppm"); a file, named pipe
+	// or "-" for stdout for the stream formats.
+	std::string Output = "frame_%05d.ppm";
+	BatchFormat Format = BatchFormat::Ppm;
+
+	// Frames in flight between two stages.
+	int QueueDepth = 3;
+
+	// Checkpoint finished frames to <Output>.checkpoint at most every CheckpointSeconds
+	// and resume from an existing checkpoint. Needs numbered files or a regular file.
+	bool Resumable = false;
+	double CheckpointSeconds = 10.0;
+
+	// Stop after rendering this many frames, as if interrupted; 0 renders them all.
+	int MaxFrames = 0;
+
+	// If set, receives the render stage time, rays and distance evaluations of every frame.
+	std::shared_ptr<FrameStats> Stats;
+};
+
+// Time each stage spent working and waiting on its neighbours.
+struct BatchStageStats
+{
+	double BusyMs = 0.0;
+	double StallMs = 0.0;
+};
+
+struct BatchStats
+{
+	int Frames = 0;  // rendered by this run
+	int Resumed = 0; // kept from an earlier run
+	int Damaged = 0; // checkpointed, but failed their checksum and were rendered again
+	double TotalMs = 0.0;
+	std::uint64_t BytesWritten = 0;
+
+	// Checksumming frames and saving checkpoints.
+	double CheckpointMs = 0.0;
+
+	BatchStageStats Render;
+	BatchStageStats Convert;
+	BatchStageStats Write;
+};
+
+// Renders, colour-converts and writes frames on three stages over a FrameRing, so
+// the render workers keep going while earlier frames are encoded and written.
+class BatchRenderer
+{
+public:
+	explicit BatchRenderer(const BatchOptions& options);
+
+	// Returns false and sets Error() if the output could not be written.
+	bool Run();
+
+	const BatchStats& Stats() const;
+	const std::string& Error() const;
+
+	bool Finished() const;
+	std::string CheckpointPath() const;
+
+	// Power and camera of frame index.
+	float PowerAt(int frame) const;
+	CpuCamera CameraAt(int frame) const;
+
+	static int RunDefault(const BatchOptions& options);
+
+private:
+	// One slot of the frame ring. Slots move through the stages and back to the
+	// renderer, so no frame memory is allocated or copied while streaming.
+	struct Frame
+	{
+		int Index = 0;
+		CpuFramebuffer Target;
+		std::vector<std::uint8_t> Bytes;
+		char Header[32];
+
+		OutputSpan Spans[2];
+		int SpanCount = 0;
+
+		// Stream offset after this frame, for releasing spliced frames.
+		std::uint64_t StreamEnd = 0;
+	};
+
+	double PathTime(int frame) const;
+	std::size_t FrameBytes() const;
+	int StreamHeader(char* header, std::size_t size) const;
+	std::string FramePath(int frame) const;
+
+	// Identifies the sweep, so the checkpoint of a different render is never resumed.
+	std::string Signature() const;
+
+	// Marks the checkpointed frames whose output still matches their checksum as
+	// done. A stream keeps its verified leading frames; returns the bytes they span.
+	std::uint64_t VerifyFrames(Checkpoint& checkpoint, std::vector<bool>& done);
+
+	void ConvertFrame(Frame& frame) const;
+	bool WriteFrame(const Frame& frame);
+
+private:
+	BatchOptions mOptions;
+	BatchStats mStats;
+	std::string mError;
+	StreamWriter mStream;
+};
\ No newline at end of file
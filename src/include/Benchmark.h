@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CameraPath;
+
+struct BenchmarkOptions
+{
+	std::string Filter;
+	int Runs = 5;
+	int Width = 320;
+	int Height = 180;
+	int Threads = 0;
+
+	// Camera path replayed by the path/ cases, at PathFps frames per second.
+	std::shared_ptr<const CameraPath> Path;
+	int PathFps = 30;
+};
+
+struct BenchmarkResult
+{
+	std::string Name;
+	int Runs = 0;
+	double MeanMs = 0.0;
+	double MinMs = 0.0;
+	double ItemsPerSecond = 0.0;
+	std::string Note;
+};
+
+// Tiny timing harness for the headless -bench mode.
+class Benchmark
+{
+public:
+	// A case returns how many items (rays, samples, ...) one run processed
+	// and may leave a short note describing what it measured.
+	typedef std::function<std::uint64_t(std::string& note)> Body;
+
+	explicit Benchmark(const BenchmarkOptions& options);
+
+	const BenchmarkOptions& Options() const;
+
+	void Add(const std::string& name, Body body);
+	std::vector<BenchmarkResult> Run();
+
+	static void Print(const std::vector<BenchmarkResult>& results, std::FILE* out);
+
+	// Registers every built-in case, runs the ones matching the filter and prints them.
+	static int RunDefault(const BenchmarkOptions& options);
+
+private:
+	struct Case
+	{
+		std::string Name;
+		Body Run;
+	};
+
+	BenchmarkOptions mOptions;
+	std::vector<Case> mCases;
+};
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "CpuRenderer.h"
+
+// Input gathered over one frame. Held keys persist between frames; the mouse
+// deltas and power steps are per-frame and reset after each Step.
+struct CameraInput
+{
+	float Horizontal = 0.0f;
+	float Vertical = 0.0f;
+
+	bool Up = false;    // E
+	bool Down = false;  // Q
+	bool Boost = false; // left shift, actually slows movement down
+
+	// Mouse movement in pixels while the left button is held.
+	int MouseDx = 0;
+	int MouseDy = 0;
+
+	// Arrow key presses, each changes the power growth speed by .01.
+	int PowerSteps = 0;
+
+	void ResetFrameDeltas();
+};
+
+struct CameraState
+{
+	Vec3f Position = Vec3f(3.0f, 0.0f, -3.0f);
+	float Theta = 3.0f * 3.1415926535f / 4.0f;
+	float Phi = 3.1415926535f / 2.0f;
+
+	float Power = 8.0f;
+	float PowerGrowSpeed = 0.0f;
+
+	bool operator==(const CameraState& rhs) const;
+	bool operator!=(const CameraState& rhs) const { return !(*this == rhs); }
+};
+
+// The fly camera and power animation of the window, independent of Win32 so
+// recordings can be replayed headlessly with exactly the same arithmetic.
+class CameraController
+{
+public:
+	float MoveSpeedHor = 1.0f;
+	float MoveSpeedVert = 1.0f;
+	float MoveSpeedAcceleration = .1f;
+
+	void Step(CameraState& state, const CameraInput& input, float dt) const;
+
+	static Vec3f Forward(const CameraState& state);
+	static CpuCamera ToCpuCamera(const CameraState& state);
+};
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CameraRecording.h"
+#include <string>
+#include <vector>
+
+struct CameraKey
+{
+	double Time = 0.0;
+	Vec3d Position = Vec3d(3.0, 0.0, -3.0);
+	double Theta = 3.0 * 3.1415926535 / 4.0;
+	double Phi = 3.1415926535 / 2.0;
+	float Power = 8.0f;
+};
+
+// Keyframed camera and power, interpolated with a Catmull-Rom spline through the keys.
+class CameraPath
+{
+public:
+	// Keys must be added in increasing time.
+	void Add(const CameraKey& key);
+
+	const std::vector<CameraKey>& Keys() const;
+	bool Empty() const;
+	double Duration() const;
+
+	// Returns the key itself at a key's time; times outside the path clamp to the ends.
+	CameraKey Evaluate(double time) const;
+	CpuCamera CameraAt(double time) const;
+
+	// Text format, one key per line: time x y z theta phi power. '#' starts a comment.
+	bool Save(const std::string& path) const;
+	bool Load(const std::string& path);
+
+	// Loads either a text path or a binary recording (see FromRecording).
+	bool LoadAny(const std::string& path, float fixedDt = 0.0f);
+
+	// One key per recorded frame, re-simulated with fixedDt if non-zero.
+	static CameraPath FromRecording(const CameraRecording& recording, float fixedDt = 0.0f);
+
+private:
+	std::vector<CameraKey> mKeys;
+};
\ No newline at end of file
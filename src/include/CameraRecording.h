@@ -0,0 +1,39 @@
+#pragma once
+
+#include "CameraController.h"
+#include <string>
+#include <vector>
+
+// Per-frame log of the camera input, timestep and resulting state. Replaying the
+// inputs through CameraController reproduces the states exactly, either with the
+// recorded timesteps or with a fixed one.
+class CameraRecording
+{
+public:
+	struct Frame
+	{
+		float Dt = 0.0f;
+		CameraInput Input;
+		CameraState State;
+	};
+
+	void Clear(const CameraState& initial);
+	void Append(float dt, const CameraInput& input, const CameraState& state);
+
+	const CameraState& Initial() const;
+	const std::vector<Frame>& Frames() const;
+
+	// Compact little-endian binary log, 40 bytes per frame.
+	bool Save(const std::string& path) const;
+	bool Load(const std::string& path);
+
+	// Re-runs the inputs from the initial state. A fixedDt of 0 uses the recorded timesteps.
+	std::vector<CameraState> Replay(const CameraController& controller, float fixedDt = 0.0f) const;
+
+	// Index of the first frame whose replayed state differs from the recorded one, or -1.
+	int FirstDivergence(const CameraController& controller) const;
+
+private:
+	CameraState mInitial;
+	std::vector<Frame> mFrames;
+};
\ No newline at end of file
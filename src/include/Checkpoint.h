@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CpuRenderer.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Progress of a long render that survives a crash or preemption: a signature of
+// the render and a checksum of every finished item (a frame or a tile). Save
+// writes the manifest to a temporary file, flushes it to disk and renames it over
+// the previous one, so a crash leaves one complete manifest or the other. The
+// output itself is not flushed; a resumed run checks every item against its
+// checksum instead and renders the ones that did not reach the disk again.
+class Checkpoint
+{
+public:
+	// Update saves at most every intervalSeconds; 0 saves after every item.
+	Checkpoint(const std::string& path, const std::string& signature, double intervalSeconds);
+
+	// Reads the manifest; false if there is none, or it is damaged or of another render.
+	bool Load();
+
+	void Add(int index, std::uint64_t checksum);
+	void Remove(int index);
+	bool Contains(int index) const;
+	const std::map<int, std::uint64_t>& Items() const;
+
+	// Saves if items changed and the interval has passed since the last save.
+	bool Update();
+	bool Save();
+
+	// Deletes the manifest of a finished render.
+	void Discard();
+
+	const std::string& Path() const;
+	int Saves() const;
+	double SaveMs() const; // time spent in Save, for the overhead
+
+private:
+	std::string mPath;
+	std::string mSignature;
+	double mIntervalSeconds;
+
+	std::map<int, std::uint64_t> mItems;
+	bool mDirty = false;
+	double mLastSave = 0.0;
+	int mSaves = 0;
+	double mSaveMs = 0.0;
+};
+
+// Text that changes with everything that changes the rendered pixels, for signatures.
+std::string CameraSignature(const CpuCamera& camera);
+std::string SettingsSignature(const RenderSettings& settings);
\ No newline at end of file
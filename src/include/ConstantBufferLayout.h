@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// HLSL constant buffer packing, evaluated at compile time so C++ mirrors of a
+// cbuffer can be generated from and checked against one field list.
+//
+// Rules: members are packed into 16-byte registers in order, a member that would
+// straddle a register boundary starts the next register, and matrices always
+// start a new register.
+
+enum class CbKind
+{
+	Scalar,
+	Vector,
+	Matrix
+};
+
+struct CbField
+{
+	const char* HlslType;
+	const char* Name;
+	std::size_t Size;
+	CbKind Kind;
+};
+
+// Shader-side types usable in a field list. The C++ side maps the same names to
+// its own types (see PassConstants in FrameResource.h).
+namespace CbHlsl
+{
+	struct Float { static constexpr const char* Name = "float"; static constexpr std::size_t Size = 4; static constexpr CbKind Kind = CbKind::Scalar; };
+	struct Int { static constexpr const char* Name = "int"; static constexpr std::size_t Size = 4; static constexpr CbKind Kind = CbKind::Scalar; };
+	struct UInt { static constexpr const char* Name = "uint"; static constexpr std::size_t Size = 4; static constexpr CbKind Kind = CbKind::Scalar; };
+	struct Float2 { static constexpr const char* Name = "float2"; static constexpr std::size_t Size = 8; static constexpr CbKind Kind = CbKind::Vector; };
+	struct Float3 { static constexpr const char* Name = "float3"; static constexpr std::size_t Size = 12; static constexpr CbKind Kind = CbKind::Vector; };
+	struct Float4 { static constexpr const char* Name = "float4"; static constexpr std::size_t Size = 16; static constexpr CbKind Kind = CbKind::Vector; };
+	struct Float4x4 { static constexpr const char* Name = "float4x4"; static constexpr std::size_t Size = 64; static constexpr CbKind Kind = CbKind::Matrix; };
+}
+
+namespace CbLayout
+{
+	constexpr std::size_t RegisterSize = 16;
+
+	// Largest cbuffer D3D12 can bind: 4096 registers.
+	constexpr std::size_t MaxSize = 4096 * RegisterSize;
+
+	constexpr bool StartsRegister(const CbField& field, std::size_t offset)
+	{
+		return field.Kind == CbKind::Matrix || offset % RegisterSize + field.Size > RegisterSize;
+	}
+
+	// Byte offset of fields[index] in the cbuffer.
+	template<std::size_t N>
+	constexpr std::size_t Offset(const CbField (&fields)[N], std::size_t index)
+	{
+		std::size_t offset = 0;
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			if (StartsRegister(fields[i], offset))
+				offset = (offset + RegisterSize - 1) / RegisterSize * RegisterSize;
+			if (i == index)
+				break;
+			offset += fields[i].Size;
+		}
+		return offset;
+	}
+
+	template<std::size_t N>
+	constexpr std::size_t Size(const CbField (&fields)[N])
+	{
+		return Offset(fields, N - 1) + fields[N - 1].Size;
+	}
+
+	// Alignment that makes a C++ member land on its HLSL offset: members that start
+	// a register are 16-byte aligned, everything else follows its predecessor.
+	template<std::size_t N>
+	constexpr std::size_t Alignment(const CbField (&fields)[N], std::size_t index)
+	{
+		return Offset(fields, index) % RegisterSize == 0 ? RegisterSize : 4;
+	}
+
+	// The cbuffer declaration, one member per line with its offset.
+	std::string Emit(const char* name, int slot, const CbField* fields, std::size_t count);
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "CpuRenderer.h"
+#include "FrameRing.h"
+#include <cstdint>
+#include <functional>
+
+// CPU counterpart of FrameResource: everything one in-flight frame owns.
+struct CpuFrameResource
+{
+	std::uint32_t Frame = 0;
+
+	// Constants, filled by the update stage.
+	CpuCamera Camera;
+	RenderSettings Settings;
+
+	// Colour and AOVs, filled by the render stage.
+	CpuFramebuffer Target;
+};
+
+struct CpuPipelineStats
+{
+	int Frames = 0;
+	double TotalMs = 0.0;
+	double AverageInFlight = 0.0;
+	int MaxInFlight = 0;
+
+	FrameRingStageStats Update;
+	FrameRingStageStats Render;
+	FrameRingStageStats Present;
+};
+
+// Update, render and present on their own threads over a ring of Depth frame
+// resources, like gNumFrameResources for the GPU path: update can run up to
+// Depth frames ahead of present.
+class CpuPipeline
+{
+public:
+	// Fills the constants of a frame; returning false ends the run.
+	typedef std::function<bool(CpuFrameResource& frame)> UpdateStage;
+	typedef std::function<void(const CpuFrameResource& frame)> PresentStage;
+
+	CpuPipeline(int depth, int width, int height, int threads = 0);
+
+	int Depth() const;
+
+	// Runs until frameCount frames were presented or update returns false.
+	CpuPipelineStats Run(int frameCount, const UpdateStage& update, const PresentStage& present);
+
+private:
+	int mDepth;
+	int mWidth;
+	int mHeight;
+	CpuRenderer mRenderer;
+};
\ No newline at end of file
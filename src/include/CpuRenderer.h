@@ -0,0 +1,411 @@
+#pragma once
+
+#include "Arena.h"
+#include "RayMarcher.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Camera state mirroring RayMarching::UpdateMainPassCB.
+struct CpuCamera
+{
+	Vec3d Position = Vec3d(3.0, 0.0, -3.0);
+	double Theta = 3.0 * 3.1415926535 / 4.0;
+	double Phi = 3.1415926535 / 2.0;
+	double FovY = .25 * 3.1415926535;
+
+	Vec3d Forward() const;
+};
+
+enum class Precision
+{
+	Float,
+	Double,
+	DoubleDouble
+};
+
+enum class PrecisionMode
+{
+	Auto,
+	Float,
+	Double,
+	DoubleDouble
+};
+
+const char* PrecisionName(Precision precision);
+
+// Order tiles are handed to threads in, and pixels within a tile are marched in.
+// Morton order keeps rays that are marched together close on screen, so packet
+// lanes see similar surfaces and consecutive tiles share cache lines.
+enum class TraversalOrder
+{
+	RowMajor,
+	Morton
+};
+
+// How the float and double tiers march primary, re-marched and anti-aliasing rays;
+// double-double always marches one ray at a time. Packets keep N rays in SoA lanes
+// but call the scalar libm per lane, so they only pay off where the compiler
+// vectorizes those calls. Without that (GCC, -bench wavefront/) packets are about
+// 20% slower than scalar and wavefronts at best break even, so scalar is the
+// default. All three give the same pixels.
+enum class MarchKernel
+{
+	Scalar,   // one ray at a time
+	Packet,   // N rays in lockstep, each packet until its slowest lane finishes
+	Wavefront // every ray of a tile, compacting the live rays every WavefrontSteps
+};
+
+// Adaptive anti-aliasing: after one ray through every pixel centre, pixels that
+// differ from a neighbour by more than a threshold get Samples jittered rays more.
+struct AntiAliasSettings
+{
+	bool Enabled = false;
+
+	// Supersample every pixel instead, the reference adaptive AA is measured against.
+	bool Uniform = false;
+
+	int Samples = 4;
+
+	// Per tile; the highest-contrast pixels are resolved first when a tile would exceed it.
+	int MaxSamplesPerTile = 2048;
+
+	float DepthThreshold = 0.05f; // relative to the nearer of the two depths
+	int IterationThreshold = 1;
+	float ColorThreshold = 0.02f; // largest channel difference, 0-1
+
+	// Selects the jitter pattern; vary it per frame for temporal accumulation.
+	std::uint64_t Seed = 0;
+
+	template<typename Visit>
+	void VisitPixelFields(Visit&& visit) const
+	{
+		visit("aa", Enabled);
+		visit("aa-uniform", Uniform);
+		visit("aa-samples", Samples);
+		visit("aa-tile-samples", MaxSamplesPerTile);
+		visit("aa-depth", DepthThreshold);
+		visit("aa-iterations", IterationThreshold);
+		visit("aa-color", ColorThreshold);
+		visit("aa-seed", Seed);
+	}
+};
+
+// Marching at 1/Factor resolution. Full-resolution pixels are reconstructed by a
+// joint bilateral filter guided by the low-resolution depth and iteration count,
+// and marched at full resolution where their taps straddle a discontinuity.
+struct UpsampleSettings
+{
+	int Factor = 1; // 1 (native), 2 or 4
+
+	float DepthThreshold = 0.05f; // relative depth range of the taps
+	int IterationThreshold = 2;
+
+	template<typename Visit>
+	void VisitPixelFields(Visit&& visit) const
+	{
+		visit("upsample", Factor);
+		visit("upsample-depth", DepthThreshold);
+		visit("upsample-iterations", IterationThreshold);
+	}
+};
+
+// Lighting from what the primary march already produced: ambient occlusion from
+// each hit's step count and normals from the depth buffer cost no distance
+// estimates; only the soft-shadow ray (one per lit hit) marches again.
+struct LightingSettings
+{
+	bool AmbientOcclusion = false;
+	bool Shadows = false;
+
+	Vec3f LightDirection = Vec3f(0.577f, 0.577f, -0.577f); // towards the light
+	float Ambient = 0.35f; // share of the light that is not direct
+
+	// Primary march steps at which a hit counts as fully occluded.
+	float AoSteps = 60.0f;
+
+	ShadowParams Shadow;
+
+	bool Enabled() const { return AmbientOcclusion || Shadows; }
+
+	template<typename Visit>
+	void VisitPixelFields(Visit&& visit) const
+	{
+		visit("ao", AmbientOcclusion);
+		visit("shadows", Shadows);
+		visit("light-x", LightDirection.x);
+		visit("light-y", LightDirection.y);
+		visit("light-z", LightDirection.z);
+		visit("ambient", Ambient);
+		visit("ao-steps", AoSteps);
+		Shadow.VisitPixelFields(visit);
+	}
+};
+
+// The part of a larger image a render covers: the target is the window at (X, Y)
+// of a FullWidth x FullHeight image, so its rays are an off-centre part of the
+// camera's frustum. A FullWidth of 0 renders the whole image into the target.
+struct ImageRegion
+{
+	int FullWidth = 0;
+	int FullHeight = 0;
+	int X = 0;
+	int Y = 0;
+};
+
+// Per-frame render parameters, the CPU counterpart of PassConstants.
+struct RenderSettings
+{
+	MarchParams March;
+
+	Vec3f Color = Vec3f(0.0f, 0.0f, 1.0f);
+	float Darkness = 150.0f;
+
+	PrecisionMode Precision = PrecisionMode::Auto;
+
+	// Use a hit threshold of one pixel footprint instead of March.Epsilon.
+	bool AdaptiveEpsilon = false;
+
+	MarchKernel Kernel = MarchKernel::Scalar;
+
+	// Steps between compactions of the live rays with MarchKernel::Wavefront (at least 1).
+	int WavefrontSteps = 1;
+
+	TraversalOrder Order = TraversalOrder::Morton;
+
+	ImageRegion Region;
+
+	UpsampleSettings Upsample;
+	LightingSettings Lighting;
+	AntiAliasSettings AntiAlias;
+
+	int TileSize = 32;
+
+	// Calls visit(name, value) for every setting that changes the rendered pixels.
+	// Region is left out: it is chosen by whoever splits the image. Kernel and
+	// WavefrontSteps are too, since every kernel marches ray for ray alike.
+	template<typename Visit>
+	void VisitPixelFields(Visit&& visit) const
+	{
+		March.VisitPixelFields(visit);
+		visit("color-r", Color.x);
+		visit("color-g", Color.y);
+		visit("color-b", Color.z);
+		visit("darkness", Darkness);
+		visit("precision", (int)Precision);
+		visit("adaptive-epsilon", AdaptiveEpsilon);
+		visit("order", (int)Order);
+		Upsample.VisitPixelFields(visit);
+		Lighting.VisitPixelFields(visit);
+		AntiAlias.VisitPixelFields(visit);
+		visit("tile", TileSize);
+	}
+};
+
+// Colour plus the arbitrary output values later passes need.
+struct CpuFramebuffer
+{
+	int Width = 0;
+	int Height = 0;
+
+	std::vector<std::uint32_t> Color; // RGBA8, R in the low byte
+	std::vector<float> Depth;         // ray distance, MaxDistance on a miss
+	std::vector<std::uint8_t> Iterations;
+	std::vector<std::uint16_t> Steps; // of the primary ray
+	std::vector<std::uint8_t> Samples; // rays traced for the pixel, 0 if upsampled
+
+	void Resize(int width, int height);
+};
+
+// Work done by the last Render call.
+struct CpuRenderStats
+{
+	std::uint64_t Rays = 0;
+	std::uint64_t DistanceEvaluations = 0;
+	std::uint64_t SupersampledPixels = 0;
+	std::uint64_t RemarchedPixels = 0; // upsampled pixels marched again at full resolution
+	std::uint64_t ShadowRays = 0;
+	std::uint64_t ShadowEvaluations = 0; // also counted in DistanceEvaluations
+
+	// Packet lanes of the primary pass: those that advanced a ray, and all evaluated.
+	std::uint64_t LaneEvaluations = 0;
+	std::uint64_t LaneSlots = 0;
+};
+
+class CpuRenderer
+{
+public:
+	// threadCount of 0 uses every hardware thread.
+	explicit CpuRenderer(int threadCount = 0);
+	CpuRenderer(const CpuRenderer& rhs) = delete;
+	CpuRenderer& operator=(const CpuRenderer& rhs) = delete;
+	~CpuRenderer();
+
+	void Render(const CpuCamera& camera, const RenderSettings& settings, CpuFramebuffer& target);
+
+	int ThreadCount() const;
+	Precision LastPrecision() const;
+	CpuRenderStats LastStats() const;
+
+	// Picks the cheapest precision that still resolves a pixel at the surface nearest to the camera.
+	static Precision SelectPrecision(const CpuCamera& camera, const RenderSettings& settings, int height);
+
+private:
+	typedef void (CpuRenderer::*TileKernel)(int x0, int y0, int x1, int y1);
+
+	// A pixel queued for more rays, and for anti-aliasing how much it differs from its neighbours (> 1 is an edge).
+	struct QueuedPixel
+	{
+		int X = 0;
+		int Y = 0;
+		float Contrast = 0.0f;
+	};
+
+	// Lives in the tile's scratch arena.
+	typedef ArenaVector<QueuedPixel> PixelList;
+
+	typedef void (CpuRenderer::*PixelKernel)(const PixelList& pixels);
+
+	enum class Phase
+	{
+		Primary,
+		Upsample,
+		Light,
+		Resolve
+	};
+
+	struct FrameJob
+	{
+		const RenderSettings* Settings = nullptr;
+		CpuFramebuffer* Target = nullptr;
+		MarchParams March;
+		Precision Tier = Precision::Float;
+		TileKernel Kernel = nullptr;
+		PixelKernel Resolve = nullptr;
+		PixelKernel Remarch = nullptr;
+		TileKernel Light = nullptr;
+		Phase Pass = Phase::Primary;
+
+		Vec3d Origin;
+		Vec3d Forward;
+		Vec3d Right;
+		Vec3d Up;
+		double TanHalfFovY = 0.0;
+		double AspectRatio = 1.0;
+
+		// Target pixels are PixelScale output pixels wide, so directions are always
+		// computed in output pixel coordinates. The target starts at OffsetX, OffsetY
+		// of the output image when rendering a region of it.
+		double PixelScale = 1.0;
+		int OutputWidth = 0;
+		int OutputHeight = 0;
+		int OffsetX = 0;
+		int OffsetY = 0;
+
+		int TilesX = 0;
+		int TileCount = 0;
+
+		// Tile indices in dispatch order, null for row-major.
+		const int* TileOrder = nullptr;
+	};
+
+	void SetTarget(CpuFramebuffer& target, int scale);
+	void RunTiles();
+	void WorkerLoop(int thread);
+	void ProcessTiles(Arena& scratch);
+	void RenderTile(int tileIndex);
+	void UpsampleTile(int x0, int y0, int x1, int y1);
+	void ResolveTile(int x0, int y0, int x1, int y1);
+	float Contrast(int x, int y) const;
+	void TilePixels(int x0, int y0, int x1, int y1, PixelList& pixels) const;
+
+	static TileKernel SelectKernel(const FractalParams& params);
+	static PixelKernel SelectResolveKernel(const FractalParams& params);
+	static PixelKernel SelectRemarchKernel(const FractalParams& params);
+	static TileKernel SelectLightKernel(const FractalParams& params);
+
+	template<typename F>
+	void RenderTileFormula(int x0, int y0, int x1, int y1);
+
+	template<typename F, typename T, int N>
+	void RenderTilePacket(int x0, int y0, int x1, int y1);
+
+	template<typename F, typename T, int N>
+	void RenderTileWavefront(int x0, int y0, int x1, int y1);
+
+	template<typename F, typename T>
+	void RenderTileScalar(int x0, int y0, int x1, int y1);
+
+	template<typename F>
+	void LightTileFormula(int x0, int y0, int x1, int y1);
+
+	template<typename F, typename T>
+	void LightTile(int x0, int y0, int x1, int y1);
+
+	Vec3d DepthNormal(int x, int y, const Vec3d& direction) const;
+
+	template<typename F>
+	void RemarchFormula(const PixelList& pixels);
+
+	template<typename F, typename T, int N>
+	void RemarchPacket(const PixelList& pixels);
+
+	template<typename F, typename T>
+	void RemarchScalar(const PixelList& pixels);
+
+	template<typename F>
+	void ResolveFormula(const PixelList& pixels);
+
+	template<typename F, typename T, int N>
+	void ResolvePacket(const PixelList& pixels);
+
+	template<typename F, typename T>
+	void ResolveScalar(const PixelList& pixels);
+
+	void ResolvePixel(const QueuedPixel& pixel, const float sum[4], int rays);
+
+	Vec3d PixelDirection(double x, double y) const;
+	Vec3d SampleDirection(int x, int y, int sample) const;
+	void Shade(const MarchResult& result, float rgba[4]) const;
+	void WritePixel(int x, int y, const MarchResult& result);
+
+private:
+	std::vector<std::thread> mWorkers;
+	std::mutex mMutex;
+	std::condition_variable mWakeCondition;
+	std::condition_variable mDoneCondition;
+	std::uint64_t mGeneration = 0;
+	int mBusyWorkers = 0;
+	bool mQuit = false;
+
+	std::atomic<int> mNextTile;
+	FrameJob mJob;
+	Precision mLastPrecision = Precision::Float;
+
+	std::atomic<std::uint64_t> mRays;
+	std::atomic<std::uint64_t> mDistanceEvaluations;
+	std::atomic<std::uint64_t> mSupersampledPixels;
+	std::atomic<std::uint64_t> mRemarchedPixels;
+	std::atomic<std::uint64_t> mShadowRays;
+	std::atomic<std::uint64_t> mShadowEvaluations;
+	std::atomic<std::uint64_t> mLaneEvaluations;
+	std::atomic<std::uint64_t> mLaneSlots;
+	CpuRenderStats mLastStats;
+
+	// Tile scratch, one arena per thread (0 is the thread calling Render), and
+	// buffers that live for one Render call. Both are reset as a frame starts.
+	std::vector<std::unique_ptr<Arena>> mThreadArenas;
+	Arena mFrameArena;
+
+	// Primary colours, read by the resolve pass while it overwrites Color.
+	std::uint32_t* mPrimaryColor = nullptr;
+
+	CpuFramebuffer mLowRes;
+
+	// Lighting factor of each pixel, applied to anti-aliasing samples as well.
+	float* mLight = nullptr;
+};
\ No newline at end of file
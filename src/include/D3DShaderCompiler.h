@@ -0,0 +1,12 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "ShaderCache.h"
+
+// IShaderCompiler over D3DCompile. Includes resolve relative to the including file,
+// like D3D_COMPILE_STANDARD_FILE_INCLUDE, and are reported to the cache.
+class D3DShaderCompiler : public IShaderCompiler
+{
+public:
+	bool Compile(const ShaderRequest& request, ShaderBytecode& bytecode, std::vector<std::string>& includes, std::string& errors) override;
+};
\ No newline at end of file
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+// Unevaluated sum of two doubles giving ~106 bits of mantissa.
+// Used by the deep-zoom tier of the CPU marcher; the arithmetic relies on
+// strict IEEE evaluation and must not be compiled with fast-math.
+struct DoubleDouble
+{
+	double hi;
+	double lo;
+
+	DoubleDouble() : hi(0.0), lo(0.0) {}
+	DoubleDouble(double h) : hi(h), lo(0.0) {}
+	DoubleDouble(double h, double l) : hi(h), lo(l) {}
+
+	explicit operator double() const { return hi + lo; }
+	explicit operator float() const { return (float)(hi + lo); }
+
+	static DoubleDouble TwoPi() { return DoubleDouble(6.283185307179586232e+00, 2.449293598294706414e-16); }
+	static DoubleDouble HalfPi() { return DoubleDouble(1.570796326794896558e+00, 6.123233995736766036e-17); }
+	static DoubleDouble Ln2() { return DoubleDouble(6.931471805599452862e-01, 2.319046813846299558e-17); }
+};
+
+namespace DoubleDoubleDetail
+{
+	inline DoubleDouble QuickTwoSum(double a, double b)
+	{
+		double s = a + b;
+		return DoubleDouble(s, b - (s - a));
+	}
+
+	inline DoubleDouble TwoSum(double a, double b)
+	{
+		double s = a + b;
+		double bb = s - a;
+		return DoubleDouble(s, (a - (s - bb)) + (b - bb));
+	}
+
+	inline DoubleDouble TwoProd(double a, double b)
+	{
+		double p = a * b;
+		return DoubleDouble(p, std::fma(a, b, -p));
+	}
+}
+
+inline DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b)
+{
+	using namespace DoubleDoubleDetail;
+	DoubleDouble s = TwoSum(a.hi, b.hi);
+	DoubleDouble t = TwoSum(a.lo, b.lo);
+	s.lo += t.hi;
+	s = QuickTwoSum(s.hi, s.lo);
+	s.lo += t.lo;
+	return QuickTwoSum(s.hi, s.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a)
+{
+	return DoubleDouble(-a.hi, -a.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b)
+{
+	return a + (-b);
+}
+
+inline DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b)
+{
+	using namespace DoubleDoubleDetail;
+	DoubleDouble p = TwoProd(a.hi, b.hi);
+	p.lo += a.hi * b.lo + a.lo * b.hi;
+	return QuickTwoSum(p.hi, p.lo);
+}
+
+inline DoubleDouble operator/(const DoubleDouble& a, const DoubleDouble& b)
+{
+	using namespace DoubleDoubleDetail;
+	double q1 = a.hi / b.hi;
+	DoubleDouble r = a - b * q1;
+	double q2 = r.hi / b.hi;
+	r = r - b * q2;
+	double q3 = r.hi / b.hi;
+	return QuickTwoSum(q1, q2) + q3;
+}
+
+inline DoubleDouble& operator+=(DoubleDouble& a, const DoubleDouble& b) { return a = a + b; }
+inline DoubleDouble& operator-=(DoubleDouble& a, const DoubleDouble& b) { return a = a - b; }
+inline DoubleDouble& operator*=(DoubleDouble& a, const DoubleDouble& b) { return a = a * b; }
+inline DoubleDouble& operator/=(DoubleDouble& a, const DoubleDouble& b) { return a = a / b; }
+
+inline bool operator<(const DoubleDouble& a, const DoubleDouble& b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+inline bool operator>(const DoubleDouble& a, const DoubleDouble& b) { return b < a; }
+inline bool operator<=(const DoubleDouble& a, const DoubleDouble& b) { return !(b < a); }
+inline bool operator>=(const DoubleDouble& a, const DoubleDouble& b) { return !(a < b); }
+inline bool operator==(const DoubleDouble& a, const DoubleDouble& b) { return a.hi == b.hi && a.lo == b.lo; }
+inline bool operator!=(const DoubleDouble& a, const DoubleDouble& b) { return !(a == b); }
+
+// Math functions are found through ADL so generic kernels can call them unqualified.
+
+inline DoubleDouble fabs(const DoubleDouble& a)
+{
+	return a.hi < 0.0 ? -a : a;
+}
+
+inline DoubleDouble sqrt(const DoubleDouble& a)
+{
+	if (a.hi <= 0.0)
+		return DoubleDouble(std::sqrt(a.hi));
+
+	// One Newton step from the double estimate doubles the precision.
+	double x = 1.0 / std::sqrt(a.hi);
+	double ax = a.hi * x;
+	DoubleDouble ax2 = DoubleDoubleDetail::TwoProd(ax, ax);
+	return DoubleDoubleDetail::TwoSum(ax, (a - ax2).hi * (x * 0.5));
+}
+
+inline DoubleDouble exp(const DoubleDouble& a)
+{
+	const double inverseScale = 1.0 / 512.0;
+
+	// Past these the result is out of double range, and m below would not fit an int.
+	if (std::isnan(a.hi))
+		return a;
+	if (a.hi > 709.79)
+		return DoubleDouble(std::numeric_limits<double>::infinity());
+	if (a.hi < -745.2)
+		return DoubleDouble(0.0);
+
+	double m = std::floor(a.hi / DoubleDouble::Ln2().hi + 0.5);
+	DoubleDouble r = (a - DoubleDouble::Ln2() * m) * inverseScale;
+
+	// exp(r) - 1 by Taylor series, then square back up 9 times.
+	DoubleDouble s = r;
+	DoubleDouble term = r;
+	for (int i = 2; i < 20; ++i)
+	{
+		term = term * r / (double)i;
+		s += term;
+		if (std::fabs(term.hi) < 1e-33)
+			break;
+	}
+
+	for (int i = 0; i < 9; ++i)
+		s = s * 2.0 + s * s;
+
+	s += 1.0;
+	return DoubleDouble(std::ldexp(s.hi, (int)m), std::ldexp(s.lo, (int)m));
+}
+
+inline DoubleDouble log(const DoubleDouble& a)
+{
+	// 0, negative, infinite and NaN arguments: the double result is exact.
+	if (!(a.hi > 0.0) || std::isinf(a.hi))
+		return DoubleDouble(std::log(a.hi));
+
+	// Newton iteration x' = x + a * exp(-x) - 1 starting from the double result.
+	DoubleDouble x = std::log(a.hi);
+	return x + a * exp(-x) - 1.0;
+}
+
+inline DoubleDouble pow(const DoubleDouble& a, const DoubleDouble& b)
+{
+	// b * log(0) would multiply an infinity in double-double arithmetic, which gives NaN.
+	if (a.hi == 0.0)
+		return DoubleDouble(b.hi > 0.0 ? 0.0 : (b.hi == 0.0 ? 1.0 : std::numeric_limits<double>::infinity()));
+	if (a.hi < 0.0)
+		return DoubleDouble(std::numeric_limits<double>::quiet_NaN());
+
+	return exp(b * log(a));
+}
+
+namespace DoubleDoubleDetail
+{
+	// sin(t) for |t| <= pi/4
+	inline DoubleDouble SinTaylor(const DoubleDouble& t)
+	{
+		DoubleDouble t2 = t * t;
+		DoubleDouble s = t;
+		DoubleDouble term = t;
+		for (int i = 3; i < 40; i += 2)
+		{
+			term = -term * t2 / (double)(i * (i - 1));
+			s += term;
+			if (std::fabs(term.hi) < 1e-33)
+				break;
+		}
+		return s;
+	}
+
+	inline void SinCos(const DoubleDouble& a, DoubleDouble& sinA, DoubleDouble& cosA)
+	{
+		// Reduce to [-pi, pi], then to [-pi/4, pi/4] plus a quadrant.
+		DoubleDouble r = a - DoubleDouble::TwoPi() * std::floor(a.hi / DoubleDouble::TwoPi().hi + 0.5);
+		double j = std::floor(r.hi / DoubleDouble::HalfPi().hi + 0.5);
+		DoubleDouble t = r - DoubleDouble::HalfPi() * j;
+
+		DoubleDouble s = SinTaylor(t);
+		DoubleDouble c = sqrt(DoubleDouble(1.0) - s * s);
+
+		switch (((int)j % 4 + 4) % 4)
+		{
+		case 0: sinA = s; cosA = c; break;
+		case 1: sinA = c; cosA = -s; break;
+		case 2: sinA = -s; cosA = -c; break;
+		default: sinA = -c; cosA = s; break;
+		}
+	}
+}
+
+inline DoubleDouble sin(const DoubleDouble& a)
+{
+	DoubleDouble s, c;
+	DoubleDoubleDetail::SinCos(a, s, c);
+	return s;
+}
+
+inline DoubleDouble cos(const DoubleDouble& a)
+{
+	DoubleDouble s, c;
+	DoubleDoubleDetail::SinCos(a, s, c);
+	return c;
+}
+
+inline DoubleDouble atan2(const DoubleDouble& y, const DoubleDouble& x)
+{
+	if (x.hi == 0.0 && y.hi == 0.0)
+		return DoubleDouble(std::atan2(y.hi, x.hi));
+
+	// Newton step on the double estimate using the normalized point on the unit circle.
+	DoubleDouble r = sqrt(x * x + y * y);
+	DoubleDouble xx = x / r;
+	DoubleDouble yy = y / r;
+
+	DoubleDouble z = std::atan2(y.hi, x.hi);
+	DoubleDouble sinZ, cosZ;
+	DoubleDoubleDetail::SinCos(z, sinZ, cosZ);
+
+	if (std::fabs(xx.hi) > std::fabs(yy.hi))
+		return z + (yy - sinZ) / cosZ;
+	else
+		return z - (xx - cosZ) / sinZ;
+}
+
+inline DoubleDouble acos(const DoubleDouble& a)
+{
+	return atan2(sqrt(DoubleDouble(1.0) - a * a), a);
+}
\ No newline at end of file
@@ -0,0 +1,305 @@
+#pragma once
+
+#include "Fractal.h"
+#include "DoubleDouble.h"
+#include <cmath>
+
+// Fractal formulas for the CPU marcher. Each formula derives from Formula<Derived>
+// (CRTP) and only supplies Init/Step/Estimate, so the iteration loop is
+// instantiated and inlined per formula and per scalar type without virtual calls.
+
+// Iteration state of one point. w is only used by the quaternion formulas.
+template<typename T>
+struct FormulaState
+{
+	T x, y, z, w;
+	T dr;
+	T r;
+};
+
+template<typename Derived>
+struct Formula
+{
+	template<typename T>
+	static void Init(FormulaState<T>& s, const Vec3T<T>& position, const FractalParams& params)
+	{
+		s.x = position.x;
+		s.y = position.y;
+		s.z = position.z;
+		s.w = T(0.0);
+		s.dr = T(1.0);
+		s.r = T(0.0);
+	}
+
+	// Potential-based estimate used by the power formulas.
+	template<typename T>
+	static T Estimate(const FormulaState<T>& s, const FractalParams& params)
+	{
+		using std::log;
+		return T(0.5) * log(s.r) * s.r / s.dr;
+	}
+
+	// Step for iteration i. Formulas that vary per iteration (hybrids) override this.
+	template<typename T>
+	static void StepAt(FormulaState<T>& s, const Vec3T<T>& position, const FractalParams& params, int i)
+	{
+		Derived::Step(s, position, params);
+	}
+
+	// One step over all N lanes; inactive lanes keep their state.
+	template<typename T, int N>
+	static void PacketStep(
+		T* x, T* y, T* z, T* w, T* dr, const T* r, const bool* active,
+		const T* px, const T* py, const T* pz,
+		const FractalParams& params, int i)
+	{
+		for (int l = 0; l < N; ++l)
+		{
+			FormulaState<T> s = { x[l], y[l], z[l], w[l], dr[l], r[l] };
+			Derived::Step(s, Vec3T<T>(px[l], py[l], pz[l]), params);
+
+			x[l] = active[l] ? s.x : x[l];
+			y[l] = active[l] ? s.y : y[l];
+			z[l] = active[l] ? s.z : z[l];
+			w[l] = active[l] ? s.w : w[l];
+			dr[l] = active[l] ? s.dr : dr[l];
+		}
+	}
+
+	// Returns the estimated distance and the number of iterations run, like SceneInfo in the shader.
+	template<typename T>
+	static T Distance(const Vec3T<T>& position, const FractalParams& params, int& iterations)
+	{
+		using std::sqrt;
+
+		const T bailout = T(params.Bailout);
+
+		FormulaState<T> s;
+		Derived::Init(s, position, params);
+		iterations = 0;
+
+		for (int i = 0; i < params.MaxIterations; i++)
+		{
+			++iterations;
+			s.r = sqrt(s.x * s.x + s.y * s.y + s.z * s.z + s.w * s.w);
+
+			if (s.r > bailout) break;
+
+			Derived::StepAt(s, position, params, i);
+		}
+
+		return Derived::Estimate(s, params);
+	}
+
+	// Distance for N lanes in SoA layout. Escaped lanes are masked rather than branched on;
+	// each lane still calls the scalar libm, so this is not a SIMD kernel.
+	template<typename T, int N>
+	static void DistancePacket(
+		const T* px, const T* py, const T* pz,
+		const FractalParams& params,
+		T* distance, int* iterations)
+	{
+		using std::sqrt;
+
+		const T bailout = T(params.Bailout);
+
+		T x[N], y[N], z[N], w[N], dr[N], r[N];
+		bool active[N];
+
+		for (int l = 0; l < N; ++l)
+		{
+			FormulaState<T> s;
+			Derived::Init(s, Vec3T<T>(px[l], py[l], pz[l]), params);
+			x[l] = s.x;
+			y[l] = s.y;
+			z[l] = s.z;
+			w[l] = s.w;
+			dr[l] = s.dr;
+			r[l] = s.r;
+			active[l] = true;
+			iterations[l] = 0;
+		}
+
+		for (int i = 0; i < params.MaxIterations; i++)
+		{
+			int activeCount = 0;
+			for (int l = 0; l < N; ++l)
+			{
+				if (!active[l])
+					continue;
+
+				++iterations[l];
+				r[l] = sqrt(x[l] * x[l] + y[l] * y[l] + z[l] * z[l] + w[l] * w[l]);
+				active[l] = !(r[l] > bailout);
+				activeCount += active[l] ? 1 : 0;
+			}
+
+			if (activeCount == 0)
+				break;
+
+			Derived::template PacketStep<T, N>(x, y, z, w, dr, r, active, px, py, pz, params, i);
+		}
+
+		for (int l = 0; l < N; ++l)
+		{
+			FormulaState<T> s = { x[l], y[l], z[l], w[l], dr[l], r[l] };
+			distance[l] = Derived::Estimate(s, params);
+		}
+	}
+};
+
+namespace FormulaDetail
+{
+	// Power-N triplex step shared by the Mandelbulb, the Juliabulb and the interior-detecting
+	// loop in Fractal.cpp. Returns |z|^n, the radius before c is added.
+	template<typename T>
+	inline T PowerStep(FormulaState<T>& s, const Vec3T<T>& c, const FractalParams& params)
+	{
+		using std::acos;
+		using std::atan2;
+		using std::cos;
+		using std::pow;
+		using std::sin;
+
+		const T power = T(params.Power);
+
+		// convert to polar coordinates
+		T theta = acos(s.z / s.r);
+		T phi = atan2(s.y, s.x);
+		s.dr = pow(s.r, power - T(1.0)) * power * s.dr + T(1.0);
+
+		// scale and rotate the point
+		T zr = pow(s.r, power);
+		theta = theta * power;
+		phi = phi * power;
+
+		// convert back to cartesian coordinates, grouped like SceneInfo.hlsli so the
+		// float tier rounds exactly like the shader (-check-shader)
+		s.x = zr * (sin(theta) * cos(phi)) + c.x;
+		s.y = zr * (sin(phi) * sin(theta)) + c.y;
+		s.z = zr * cos(theta) + c.z;
+		return zr;
+	}
+
+	template<typename T>
+	inline T Clamp(const T& x, const T& low, const T& high)
+	{
+		return x < low ? low : (x > high ? high : x);
+	}
+}
+
+// The shader's formula: z -> z^n + position.
+struct Mandelbulb : Formula<Mandelbulb>
+{
+	template<typename T>
+	static void Step(FormulaState<T>& s, const Vec3T<T>& position, const FractalParams& params)
+	{
+		FormulaDetail::PowerStep(s, position, params);
+	}
+};
+
+// z -> z^n + c with a fixed c instead of the position.
+struct Juliabulb : Formula<Juliabulb>
+{
+	template<typename T>
+	static void Step(FormulaState<T>& s, const Vec3T<T>& position, const FractalParams& params)
+	{
+		Vec3T<T> c(T(params.JuliaC.x), T(params.JuliaC.y), T(params.JuliaC.z));
+		FormulaDetail::PowerStep(s, c, params);
+	}
+};
+
+// Box fold, sphere fold, scale and translate.
+struct Mandelbox : Formula<Mandelbox>
+{
+	template<typename T>
+	static void Step(FormulaState<T>& s, const Vec3T<T>& position, const FractalParams& params)
+	{
+		using FormulaDetail::Clamp;
+		using std::fabs;
+
+		const T limit = T(params.BoxFoldLimit);
+		const T minR2 = T(params.BoxMinRadius * params.BoxMinRadius);
+		const T fixedR2 = T(params.BoxFixedRadius * params.BoxFixedRadius);
+		const T scale = T(params.BoxScale);
+
+		s.x = Clamp(s.x, -limit, limit) * T(2.0) - s.x;
+		s.y = Clamp(s.y, -limit, limit) * T(2.0) - s.y;
+		s.z = Clamp(s.z, -limit, limit) * T(2.0) - s.z;
+
+		T r2 = s.x * s.x + s.y * s.y + s.z * s.z;
+		T factor = r2 < minR2 ? fixedR2 / minR2 : (r2 < fixedR2 ? fixedR2 / r2 : T(1.0));
+
+		s.x = s.x * factor * scale + position.x;
+		s.y = s.y * factor * scale + position.y;
+		s.z = s.z * factor * scale + position.z;
+		s.dr = s.dr * factor * fabs(scale) + T(1.0);
+	}
+
+	template<typename T>
+	static T Estimate(const FormulaState<T>& s, const FractalParams& params)
+	{
+		using std::fabs;
+		using std::sqrt;
+		return sqrt(s.x * s.x + s.y * s.y + s.z * s.z) / fabs(s.dr);
+	}
+};
+
+// q -> q^2 + c on quaternions, rendered as the w = 0 slice.
+struct QuaternionJulia : Formula<QuaternionJulia>
+{
+	template<typename T>
+	static void Step(FormulaState<T>& s, const Vec3T<T>& position, const FractalParams& params)
+	{
+		s.dr = T(2.0) * s.r * s.dr;
+
+		T x = s.x * s.x - s.y * s.y - s.z * s.z - s.w * s.w + T(params.JuliaC.x);
+		T y = T(2.0) * s.x * s.y + T(params.JuliaC.y);
+		T z = T(2.0) * s.x * s.z + T(params.JuliaC.z);
+		T w = T(2.0) * s.x * s.w + T(params.JuliaW);
+
+		s.x = x;
+		s.y = y;
+		s.z = z;
+		s.w = w;
+	}
+};
+
+// Sierpinski tetrahedron folds followed by a scale about IfsOffset.
+struct KaleidoscopicIFS : Formula<KaleidoscopicIFS>
+{
+	template<typename T>
+	static void Step(FormulaState<T>& s, const Vec3T<T>& position, const FractalParams& params)
+	{
+		const T scale = T(params.IfsScale);
+
+		T x = s.x, y = s.y, z = s.z;
+
+		bool fold = x + y < T(0.0);
+		T t = x;
+		x = fold ? -y : x;
+		y = fold ? -t : y;
+
+		fold = x + z < T(0.0);
+		t = x;
+		x = fold ? -z : x;
+		z = fold ? -t : z;
+
+		fold = y + z < T(0.0);
+		t = y;
+		y = fold ? -z : y;
+		z = fold ? -t : z;
+
+		s.x = x * scale - T(params.IfsOffset.x) * (scale - T(1.0));
+		s.y = y * scale - T(params.IfsOffset.y) * (scale - T(1.0));
+		s.z = z * scale - T(params.IfsOffset.z) * (scale - T(1.0));
+		s.dr = s.dr * scale;
+	}
+
+	template<typename T>
+	static T Estimate(const FormulaState<T>& s, const FractalParams& params)
+	{
+		using std::sqrt;
+		return sqrt(s.x * s.x + s.y * s.y + s.z * s.z) / s.dr;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Vec3.h"
+#include <cstddef>
+#include <cstdint>
+
+enum class FractalFormula
+{
+	Mandelbulb,
+	Mandelbox,
+	Juliabulb,
+	QuaternionJulia,
+	KaleidoscopicIFS
+};
+
+const char* FormulaName(FractalFormula formula);
+
+// How Formula and HybridSecond are interleaved over the iterations.
+enum class HybridPattern
+{
+	None,      // Formula only
+	Alternate, // Formula, HybridSecond, Formula, ...
+	Prefix     // Formula for HybridPrefixIterations, then HybridSecond
+};
+
+const char* HybridPatternName(HybridPattern pattern);
+
+// Per-frame fractal parameters, the CPU counterpart of the fractal part of PassConstants.
+struct FractalParams
+{
+	FractalFormula Formula = FractalFormula::Mandelbulb;
+
+	float Power = 8.0f;
+	int MaxIterations = 15;
+	float Bailout = 2.0f;
+
+	// Juliabulb and quaternion Julia constant (JuliaW is the quaternion's 4th component).
+	Vec3f JuliaC = Vec3f(0.35f, 0.35f, -0.35f);
+	float JuliaW = 0.0f;
+
+	// Mandelbox
+	float BoxScale = -1.5f;
+	float BoxMinRadius = 0.5f;
+	float BoxFixedRadius = 1.0f;
+	float BoxFoldLimit = 1.0f;
+
+	// Kaleidoscopic IFS (Sierpinski tetrahedron folds)
+	float IfsScale = 2.0f;
+	Vec3f IfsOffset = Vec3f(1.0f, 1.0f, 1.0f);
+
+	// Hybrids. The sequence is fixed per frame and compiled into its own kernel.
+	HybridPattern Hybrid = HybridPattern::None;
+	FractalFormula HybridSecond = FractalFormula::Mandelbox;
+	int HybridPrefixIterations = 2;
+
+	// Stop iterating as soon as a point is proven to stay bounded (plain Mandelbulb only).
+	// Exterior points are unaffected; interior points report a distance of 0. Only the
+	// Fractal queries below use it; the renderer always iterates in full.
+	bool InteriorDetection = false;
+
+	// With InteriorDetection, also stop when the orbit comes back within
+	// PeriodicityEpsilon of an earlier point. A heuristic, not a proof: an exterior
+	// orbit that nearly repeats before it escapes is reported as interior.
+	bool PeriodicityCheck = false;
+	float PeriodicityEpsilon = 1e-5f;
+
+	// Returns parameters that frame the given formula well from the default camera.
+	static FractalParams Defaults(FractalFormula formula);
+
+	// Calls visit(name, value) for every field that changes the rendered pixels,
+	// e.g. for checkpoint signatures. Add new fields here. Interior detection is
+	// left out: the renderer does not use it.
+	template<typename Visit>
+	void VisitPixelFields(Visit&& visit) const
+	{
+		visit("formula", (int)Formula);
+		visit("power", Power);
+		visit("iterations", MaxIterations);
+		visit("bailout", Bailout);
+		visit("julia-x", JuliaC.x);
+		visit("julia-y", JuliaC.y);
+		visit("julia-z", JuliaC.z);
+		visit("julia-w", JuliaW);
+		visit("box-scale", BoxScale);
+		visit("box-min-radius", BoxMinRadius);
+		visit("box-fixed-radius", BoxFixedRadius);
+		visit("box-fold", BoxFoldLimit);
+		visit("ifs-scale", IfsScale);
+		visit("ifs-offset-x", IfsOffset.x);
+		visit("ifs-offset-y", IfsOffset.y);
+		visit("ifs-offset-z", IfsOffset.z);
+		visit("hybrid", (int)Hybrid);
+		visit("hybrid-second", (int)HybridSecond);
+		visit("hybrid-prefix", HybridPrefixIterations);
+	}
+};
+
+struct SceneSample
+{
+	int Iterations = 0;
+	float Distance = 0.0f;
+	bool Interior = false;
+};
+
+// Counters accumulated by the bulk queries.
+struct SceneQueryStats
+{
+	std::uint64_t Samples = 0;
+	std::uint64_t InteriorSamples = 0;
+	std::uint64_t Iterations = 0;
+	std::uint64_t IterationsSaved = 0;
+
+	void Add(const SceneQueryStats& other);
+};
+
+// Scene queries for baking and meshing. Every formula and hybrid is evaluated with
+// the renderer's kernel; the plain Mandelbulb runs the renderer's power step in a
+// loop that can skip interior points.
+class Fractal
+{
+public:
+	// Returns escape iterations and estimated distance, same as SceneInfo in the shader.
+	// If iterationsSaved is not null it receives the iterations skipped by interior detection.
+	static SceneSample SceneInfo(const Vec3f& position, const FractalParams& params, int* iterationsSaved = nullptr);
+
+	// Evaluates SceneInfo for every position, e.g. when baking or meshing a volume.
+	static void SceneInfoBulk(
+		const Vec3f* positions,
+		std::size_t count,
+		const FractalParams& params,
+		SceneSample* results,
+		SceneQueryStats* stats = nullptr);
+
+	// Evaluates SceneInfo on a regular grid spanning [minCorner, maxCorner], x fastest.
+	static void SceneInfoGrid(
+		const Vec3f& minCorner,
+		const Vec3f& maxCorner,
+		int resolutionX, int resolutionY, int resolutionZ,
+		const FractalParams& params,
+		SceneSample* results,
+		SceneQueryStats* stats = nullptr);
+};
\ No newline at end of file
@@ -2,33 +2,48 @@
 
 #include "d3dUtil.h"
 #include "MathHelper.h"
-#include "UploadBuffer.h"
+#include "PassConstantsLayout.h"
+#include <cstddef>
 
+// C++ types for the CbHlsl names used in PASS_CONSTANTS_FIELDS.
+namespace CbCpu
+{
+	typedef FLOAT Float;
+	typedef INT Int;
+	typedef UINT UInt;
+	typedef Simd::Float2 Float2;
+	typedef Simd::Float3 Float3;
+	typedef Simd::Float4 Float4;
+	typedef Simd::Float4x4 Float4x4;
+}
+
+// Generated from PassConstantsLayout; members that start an HLSL register are
+// 16-byte aligned so every offset matches the cbuffer.
 struct PassConstants
 {
-	DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
-	DirectX::XMFLOAT4X4 WorldView = MathHelper::Identity4x4();
-	DirectX::XMFLOAT4X4 InvWorldView = MathHelper::Identity4x4();
-	DirectX::XMFLOAT4X4 WorldViewProj = MathHelper::Identity4x4();
-
-	DirectX::XMFLOAT3 CamPos;
-	FLOAT AspectRatio;
-
-	DirectX::XMFLOAT3 Color;
-	FLOAT Darkness;
-
-	FLOAT FractalPower;
+#define PASS_CONSTANTS_MEMBER(Type, Member, HlslName) \
+	alignas(CbLayout::Alignment(PassConstantsLayout::Fields, PassConstantsLayout::Member)) CbCpu::Type Member;
+	PASS_CONSTANTS_FIELDS(PASS_CONSTANTS_MEMBER)
+#undef PASS_CONSTANTS_MEMBER
 };
 
+#define PASS_CONSTANTS_CHECK(Type, Member, HlslName) \
+	static_assert(sizeof(CbCpu::Type) == CbHlsl::Type::Size, "PassConstants::" #Member ": C++ and HLSL sizes differ"); \
+	static_assert(offsetof(PassConstants, Member) == CbLayout::Offset(PassConstantsLayout::Fields, PassConstantsLayout::Member), \
+		"PassConstants::" #Member " is not at its HLSL packing offset");
+PASS_CONSTANTS_FIELDS(PASS_CONSTANTS_CHECK)
+#undef PASS_CONSTANTS_CHECK
+
 struct FrameResource {
-	FrameResource(ID3D12Device* device, UINT passCount);
+	FrameResource(ID3D12Device* device);
 	FrameResource(const FrameResource& rhs) = delete;
 	FrameResource& operator=(const FrameResource& rhs) = delete;
 	~FrameResource();
 
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
-	std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
+	// Per-frame constants come from the frame allocator in RayMarching and are
+	// reclaimed by the same fence.
 
 	UINT64 Fence = 0;
 };
\ No newline at end of file
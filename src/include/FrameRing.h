@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct FrameRingStageStats
+{
+	std::uint64_t Frames = 0;
+	std::uint64_t Waits = 0;
+	double StallMs = 0.0;
+};
+
+// Sequencing for an N-deep ring of frame resources shared by a fixed chain of
+// stages (e.g. update, render, present), one thread per stage. Stage s may work
+// on frame f once stage s - 1 has finished it; the first stage may start frame f
+// once the last stage has finished frame f - depth and its slot is free again.
+// Handoff is a release/acquire counter per stage; threads only sleep (on a
+// futex) when they actually have to wait.
+class FrameRingBase
+{
+public:
+	FrameRingBase(int depth, int stageCount);
+	FrameRingBase(const FrameRingBase& rhs) = delete;
+	FrameRingBase& operator=(const FrameRingBase& rhs) = delete;
+
+	int Depth() const;
+	int StageCount() const;
+
+	// Blocks until stage may process frame. Frames must be visited in order. Returns false once closed.
+	bool Begin(int stage, std::uint32_t frame);
+	void End(int stage, std::uint32_t frame);
+
+	// Stops the first stage and wakes every waiter. Later stages still get every
+	// frame the first stage had finished, then Begin fails. A frame the first stage
+	// is still working on when another thread closes the ring is dropped.
+	void Close();
+
+	// Read once the stage threads have stopped.
+	FrameRingStageStats Stats(int stage) const;
+
+	// Frames started by the first stage but not yet finished by the last one.
+	int InFlight() const;
+	double AverageInFlight() const;
+	int MaxInFlight() const;
+
+private:
+	bool Ready(int stage, std::uint32_t frame) const;
+	bool Stopped(int stage, std::uint32_t frame) const;
+
+	struct alignas(64) Stage
+	{
+		std::atomic<std::uint32_t> Completed{ 0 };
+		std::atomic<std::uint32_t> Sequence{ 0 }; // futex word, bumped by End and Close
+		std::atomic<std::uint32_t> Waiters{ 0 };
+
+		std::uint64_t Frames = 0;
+		std::uint64_t Waits = 0;
+		std::uint64_t StallNs = 0;
+	};
+
+	int mDepth;
+	int mStageCount;
+	std::unique_ptr<Stage[]> mStages;
+	std::atomic<bool> mClosed{ false };
+	std::atomic<std::uint32_t> mEnd{ 0 }; // frames the later stages still get once closed
+
+	std::uint64_t mInFlightSum = 0;
+	int mInFlightMax = 0;
+};
+
+template<typename T>
+class FrameRing : public FrameRingBase
+{
+public:
+	FrameRing(int depth, int stageCount) :
+		FrameRingBase(depth, stageCount),
+		mSlots(depth > 0 ? depth : 1)
+	{
+	}
+
+	T& Slot(std::uint32_t frame)
+	{
+		return mSlots[frame % mSlots.size()];
+	}
+
+	std::vector<T>& Slots()
+	{
+		return mSlots;
+	}
+
+private:
+	std::vector<T> mSlots;
+};
\ No newline at end of file
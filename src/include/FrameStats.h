@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FrameSample
+{
+	std::uint64_t Frame = 0;
+	double Time = 0.0; // seconds since the service was created
+	double FrameMs = 0.0;
+	std::vector<double> StageMs;
+	std::uint64_t Rays = 0;
+	std::uint64_t DistanceEvaluations = 0;
+	std::uint64_t MemoryBytes = 0;
+};
+
+struct StatSummary
+{
+	double Mean = 0.0;
+	double P50 = 0.0;
+	double P95 = 0.0;
+	double P99 = 0.0;
+	double Max = 0.0;
+};
+
+struct FrameStatsSummary
+{
+	int Frames = 0;
+	double Seconds = 0.0;
+	double Fps = 0.0;
+
+	StatSummary FrameMs;
+	std::vector<std::string> StageNames;
+	std::vector<StatSummary> StageMs;
+	StatSummary Rays;
+	StatSummary DistanceEvaluations;
+	std::uint64_t MemoryBytes = 0;
+};
+
+// Per-frame timings and counters over a rolling window of frames. Frames are
+// reported from one thread; summaries, exports and the query socket may be
+// used from any thread.
+class FrameStats
+{
+public:
+	explicit FrameStats(int windowFrames = 600);
+	FrameStats(const FrameStats& rhs) = delete;
+	FrameStats& operator=(const FrameStats& rhs) = delete;
+	~FrameStats();
+
+	// Registers a stage, or returns the index of an existing one with that name.
+	int Stage(const char* name);
+
+	void BeginFrame();
+	void AddStageTime(int stage, double ms);
+	void AddRays(std::uint64_t rays);
+	void AddDistanceEvaluations(std::uint64_t evaluations);
+	void EndFrame();
+
+	FrameStatsSummary Summarize() const;
+
+	std::string SummaryJson() const;
+	std::string WindowCsv() const;
+	bool WriteJson(const std::string& path) const;
+	bool WriteCsv(const std::string& path) const;
+
+	// Serves the summary on a local (AF_UNIX) socket: a client connects, may send
+	// "csv" for the raw window, and reads the reply until the server closes.
+	bool StartServer(const std::string& socketPath);
+	void StopServer();
+
+	static std::string DefaultSocketPath();
+
+	// Resident set size of the process.
+	static std::uint64_t CurrentMemoryUsage();
+
+private:
+	void ServerLoop(std::intptr_t listener);
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	std::size_t mWindowFrames;
+	Clock::time_point mCreated;
+
+	// Frame being recorded, owned by the reporting thread.
+	FrameSample mCurrent;
+	Clock::time_point mFrameStart;
+	std::uint64_t mFrameIndex = 0;
+
+	mutable std::mutex mMutex;
+	std::vector<std::string> mStageNames;
+	std::vector<FrameSample> mWindow; // ring of the last mWindowFrames frames
+	std::size_t mNext = 0;
+
+	std::thread mServer;
+	std::atomic<bool> mServerRunning{ false };
+	std::string mSocketPath;
+};
+
+// Adds the scope's duration to a stage.
+class FrameStageTimer
+{
+public:
+	FrameStageTimer(FrameStats& stats, int stage) :
+		mStats(stats),
+		mStage(stage),
+		mStart(std::chrono::steady_clock::now())
+	{
+	}
+
+	~FrameStageTimer()
+	{
+		mStats.AddStageTime(mStage, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStart).count());
+	}
+
+private:
+	FrameStats& mStats;
+	int mStage;
+	std::chrono::steady_clock::time_point mStart;
+};
\ No newline at end of file
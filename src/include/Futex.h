@@ -0,0 +1,14 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Blocking on a 32-bit atomic without a kernel object per wait: futex on Linux,
+// WaitOnAddress on Windows, a yield loop elsewhere.
+namespace Futex
+{
+	// Sleeps while word == expected. May return spuriously; callers re-check their condition.
+	void Wait(std::atomic<std::uint32_t>& word, std::uint32_t expected);
+
+	void WakeAll(std::atomic<std::uint32_t>& word);
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a. Not cryptographic: it names cache entries and checks that data
+// written earlier is still intact. Chain calls by passing the previous hash as seed.
+const std::uint64_t Fnv1aSeed = 0xcbf29ce484222325ull;
+
+std::uint64_t Fnv1a(const void* data, std::size_t size, std::uint64_t seed = Fnv1aSeed);
\ No newline at end of file
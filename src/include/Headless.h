@@ -0,0 +1,8 @@
+#pragma once
+
+// Entry point for the window-less modes (benchmarks, batch rendering).
+// Returns the process exit code.
+int RunHeadless(int argc, char** argv);
+
+// True if the command line asks for a headless mode instead of the window.
+bool IsHeadlessCommandLine(const char* cmdLine);
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// Global heap allocations made through operator new by any thread, for checks that
+// a steady state allocates nothing. HeapStats.cpp replaces the global operator new.
+namespace HeapStats
+{
+	std::uint64_t Allocations();
+}
\ No newline at end of file
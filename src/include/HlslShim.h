@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cmath>
+
+// Just enough of HLSL's vector types and intrinsics to compile the shared shader
+// headers (shaders/*.hlsli) as C++. Include those inside namespace Hlsl so their
+// function names stay out of the global namespace.
+
+#define SHADER_INLINE inline
+
+namespace Hlsl
+{
+	struct float2
+	{
+		float x, y;
+
+		float2() : x(0.0f), y(0.0f) {}
+		float2(float x, float y) : x(x), y(y) {}
+	};
+
+	struct float3
+	{
+		float x, y, z;
+
+		float3() : x(0.0f), y(0.0f), z(0.0f) {}
+		explicit float3(float s) : x(s), y(s), z(s) {}
+		float3(float x, float y, float z) : x(x), y(y), z(z) {}
+
+		float3& operator+=(const float3& v) { x += v.x; y += v.y; z += v.z; return *this; }
+	};
+
+	struct float4
+	{
+		float x, y, z, w;
+
+		float4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+		float4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+		float4(const float3& v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+	};
+
+	inline float3 operator+(const float3& a, const float3& b) { return float3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	inline float3 operator-(const float3& a, const float3& b) { return float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline float3 operator*(const float3& v, float s) { return float3(v.x * s, v.y * s, v.z * s); }
+	inline float3 operator*(float s, const float3& v) { return v * s; }
+
+	inline float4 operator+(const float4& a, const float4& b) { return float4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+	inline float4 operator*(const float4& v, float s) { return float4(v.x * s, v.y * s, v.z * s, v.w * s); }
+	inline float4 operator*(float s, const float4& v) { return v * s; }
+
+	inline float dot(const float3& a, const float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline float length(const float3& v) { return std::sqrt(dot(v, v)); }
+	inline float3 normalize(const float3& v) { return v * (1.0f / length(v)); }
+
+	inline float saturate(float x) { return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x); }
+	inline float3 saturate(const float3& v) { return float3(saturate(v.x), saturate(v.y), saturate(v.z)); }
+	inline float4 saturate(const float4& v) { return float4(saturate(v.x), saturate(v.y), saturate(v.z), saturate(v.w)); }
+
+	inline float acos(float x) { return std::acos(x); }
+	inline float atan2(float y, float x) { return std::atan2(y, x); }
+	inline float cos(float x) { return std::cos(x); }
+	inline float log(float x) { return std::log(x); }
+	inline float pow(float x, float y) { return std::pow(x, y); }
+	inline float sin(float x) { return std::sin(x); }
+}
\ No newline at end of file
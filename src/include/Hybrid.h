@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Formulas.h"
+
+// Hybrid formulas: two formulas interleaved over the iterations. The pattern is a
+// template parameter, so the choice of formula per iteration depends only on the
+// (lane-uniform) iteration index and is made outside the lane loops.
+
+struct AlternatePattern
+{
+	static bool UseFirst(int i, const FractalParams& params) { return (i & 1) == 0; }
+};
+
+struct PrefixPattern
+{
+	static bool UseFirst(int i, const FractalParams& params) { return i < params.HybridPrefixIterations; }
+};
+
+// Starts with A's initial state and finishes with B's distance estimate.
+template<typename A, typename B, typename Pattern>
+struct Hybrid : Formula<Hybrid<A, B, Pattern>>
+{
+	template<typename T>
+	static void Init(FormulaState<T>& s, const Vec3T<T>& position, const FractalParams& params)
+	{
+		A::Init(s, position, params);
+	}
+
+	template<typename T>
+	static T Estimate(const FormulaState<T>& s, const FractalParams& params)
+	{
+		return B::Estimate(s, params);
+	}
+
+	template<typename T>
+	static void StepAt(FormulaState<T>& s, const Vec3T<T>& position, const FractalParams& params, int i)
+	{
+		if (Pattern::UseFirst(i, params))
+			A::Step(s, position, params);
+		else
+			B::Step(s, position, params);
+	}
+
+	template<typename T, int N>
+	static void PacketStep(
+		T* x, T* y, T* z, T* w, T* dr, const T* r, const bool* active,
+		const T* px, const T* py, const T* pz,
+		const FractalParams& params, int i)
+	{
+		if (Pattern::UseFirst(i, params))
+			A::template PacketStep<T, N>(x, y, z, w, dr, r, active, px, py, pz, params, i);
+		else
+			B::template PacketStep<T, N>(x, y, z, w, dr, r, active, px, py, pz, params, i);
+	}
+};
+
+template<typename F>
+struct FormulaTag
+{
+	typedef F Type;
+};
+
+namespace HybridDetail
+{
+	template<typename Visitor, typename A, typename B>
+	inline auto VisitPattern(const FractalParams& params, const Visitor& visitor)
+	{
+		if (params.Hybrid == HybridPattern::Alternate)
+			return visitor(FormulaTag<Hybrid<A, B, AlternatePattern>>());
+		return visitor(FormulaTag<Hybrid<A, B, PrefixPattern>>());
+	}
+
+	// Hybrids are instantiated for the 3D formulas; quaternion Julia only runs on its own.
+	template<typename Visitor, typename A>
+	inline auto VisitSecond(const FractalParams& params, const Visitor& visitor)
+	{
+		switch (params.HybridSecond)
+		{
+		case FractalFormula::Mandelbox: return VisitPattern<Visitor, A, Mandelbox>(params, visitor);
+		case FractalFormula::Juliabulb: return VisitPattern<Visitor, A, Juliabulb>(params, visitor);
+		case FractalFormula::KaleidoscopicIFS: return VisitPattern<Visitor, A, KaleidoscopicIFS>(params, visitor);
+		default: return VisitPattern<Visitor, A, Mandelbulb>(params, visitor);
+		}
+	}
+
+	template<typename Visitor, typename A>
+	inline auto VisitFirst(const FractalParams& params, const Visitor& visitor)
+	{
+		if (params.Hybrid == HybridPattern::None || params.HybridSecond == FractalFormula::QuaternionJulia)
+			return visitor(FormulaTag<A>());
+		return VisitSecond<Visitor, A>(params, visitor);
+	}
+}
+
+// Calls visitor(FormulaTag<F>()) with the kernel type for params' formula and hybrid
+// settings. Resolve once per frame or tile, never inside the iteration loop.
+template<typename Visitor>
+inline auto VisitFormula(const FractalParams& params, const Visitor& visitor)
+{
+	switch (params.Formula)
+	{
+	case FractalFormula::Mandelbox: return HybridDetail::VisitFirst<Visitor, Mandelbox>(params, visitor);
+	case FractalFormula::Juliabulb: return HybridDetail::VisitFirst<Visitor, Juliabulb>(params, visitor);
+	case FractalFormula::KaleidoscopicIFS: return HybridDetail::VisitFirst<Visitor, KaleidoscopicIFS>(params, visitor);
+	case FractalFormula::QuaternionJulia: return visitor(FormulaTag<QuaternionJulia>());
+	default: return HybridDetail::VisitFirst<Visitor, Mandelbulb>(params, visitor);
+	}
+}
\ No newline at end of file
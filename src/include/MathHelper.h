@@ -1,28 +1,30 @@
 #pragma once
 
-#include <Windows.h>
-#include <DirectXMath.h>
+#include "Random.h"
+#include "SimdMath.h"
 #include <cstdint>
 
 class MathHelper
 {
 public:
+	// Random numbers come from the calling thread's ThreadRandom() stream.
+
 	// Returns random float in [0, 1)
 	static float RandF()
 	{
-		return (float)(rand()) / (float)RAND_MAX;
+		return ThreadRandom().NextFloat();
 	}
 
 	// Returns random float in [a, b)
 	static float RandF(float a, float b)
 	{
-		return a + RandF() * (b - a);
+		return ThreadRandom().NextFloat(a, b);
 	}
 
 	// Returns random int in [a, b]
 	static int Rand(int a, int b)
 	{
-		return a + rand() % ((b - a) + 1);
+		return ThreadRandom().NextInt(a, b);
 	}
 
 	// Returns min between a and b
@@ -56,9 +58,9 @@ public:
 	// Returns the polar angle of the point (x, y) in [0, 2*PI)
 	static float AngleFromXY(float x, float y);
 
-	static DirectX::XMVECTOR SphericalToCartesian(float radius, float theta, float phi)
+	static Simd::Vector SphericalToCartesian(float radius, float theta, float phi)
 	{
-		return DirectX::XMVectorSet(
+		return Simd::VectorSet(
 			radius * sinf(phi) * cosf(theta),
 			radius * cosf(phi),
 			radius * sinf(phi) * sinf(theta),
@@ -66,18 +68,17 @@ public:
 		);
 	}
 
-	static DirectX::XMMATRIX InverseTranspose(DirectX::CXMMATRIX M)
+	static Simd::Matrix InverseTranspose(const Simd::Matrix& M)
 	{
-		DirectX::XMMATRIX A = M;
-		A.r[3] = DirectX::XMVectorSet(.0f, .0f, .0f, 1.0f);
+		Simd::Matrix A = M;
+		A.r[3] = Simd::VectorSet(.0f, .0f, .0f, 1.0f);
 
-		DirectX::XMVECTOR det = DirectX::XMMatrixDeterminant(A);
-		return DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(&det, A));
+		return Simd::MatrixTranspose(Simd::MatrixInverse(nullptr, A));
 	}
 
-	static DirectX::XMFLOAT4X4 Identity4x4()
+	static Simd::Float4x4 Identity4x4()
 	{
-		static DirectX::XMFLOAT4X4 I(
+		static Simd::Float4x4 I(
 			1.0f, 0.0f, 0.0f, 0.0f,
 			0.0f, 1.0f, 0.0f, 0.0f,
 			0.0f, 0.0f, 1.0f, 0.0f,
@@ -87,8 +88,8 @@ public:
 		return I;
 	}
 
-	static DirectX::XMVECTOR RandUnitVec3();
-	static DirectX::XMVECTOR RandHemisphereUnitVec3(DirectX::XMVECTOR n);
+	static Simd::Vector RandUnitVec3();
+	static Simd::Vector RandHemisphereUnitVec3(Simd::Vector n);
 
 	static const float Infinity;
 	static const float Pi;
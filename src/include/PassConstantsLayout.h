@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ConstantBufferLayout.h"
+#include <string>
+
+// The per-pass constants, declared once. Each entry is X(type, C++ member, HLSL name)
+// with a type from CbHlsl. PassConstants (FrameResource.h) and shaders/PassConstants.hlsli
+// are both generated from this list, so new parameters only need a line here.
+#define PASS_CONSTANTS_FIELDS(X) \
+	X(Float4x4, World, gWorld) \
+	X(Float4x4, WorldView, gWorldView) \
+	X(Float4x4, InvWorldView, gInvWorldView) \
+	X(Float4x4, WorldViewProj, gWorldViewProj) \
+	X(Float3, CamPos, gCamPos) \
+	X(Float, AspectRatio, gAspectRatio) \
+	X(Float3, Color, gColor) \
+	X(Float, Darkness, gDarkness) \
+	X(Float, FractalPower, gPower)
+
+struct PassConstantsLayout
+{
+	enum FieldIndex
+	{
+#define PASS_CONSTANTS_INDEX(Type, Member, HlslName) Member,
+		PASS_CONSTANTS_FIELDS(PASS_CONSTANTS_INDEX)
+#undef PASS_CONSTANTS_INDEX
+		FieldCount
+	};
+
+	static constexpr CbField Fields[FieldCount] =
+	{
+#define PASS_CONSTANTS_FIELD(Type, Member, HlslName) { CbHlsl::Type::Name, #HlslName, CbHlsl::Type::Size, CbHlsl::Type::Kind },
+		PASS_CONSTANTS_FIELDS(PASS_CONSTANTS_FIELD)
+#undef PASS_CONSTANTS_FIELD
+	};
+
+	static constexpr std::size_t Size = CbLayout::Size(Fields);
+	static_assert(Size <= CbLayout::MaxSize, "PassConstants exceeds the largest bindable cbuffer");
+
+	static constexpr const char* HlslPath = "shaders/PassConstants.hlsli";
+
+	// Text of shaders/PassConstants.hlsli.
+	static std::string Hlsl();
+
+	// Writes Hlsl() to path unless the file already holds it. Returns false on a write error.
+	static bool WriteHlsl(const std::string& path);
+};
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+// A counter-based generator: every (counter, key) pair maps to four independent
+// 32-bit values, so any sample can be drawn from any thread without shared state.
+struct Philox4x32
+{
+	static void Generate(const std::uint32_t counter[4], const std::uint32_t key[2], std::uint32_t out[4]);
+
+	// Blocks counter .. counter + N - 1 of one stream, SoA so the rounds vectorize.
+	template<int N>
+	static void GeneratePacket(std::uint64_t counter, std::uint64_t stream, std::uint64_t key, std::uint32_t out[4][N]);
+};
+
+// Sequential view of one Philox stream. Cheap to create: a seed and a stream id
+// (thread, pixel, tile, ...) select the sequence, and the position is just a counter.
+class RandomStream
+{
+public:
+	explicit RandomStream(std::uint64_t seed = 0, std::uint64_t stream = 0);
+
+	std::uint32_t NextUInt();
+
+	// [0, 1)
+	float NextFloat();
+
+	// [a, b)
+	float NextFloat(float a, float b);
+
+	// [a, b]
+	int NextInt(int a, int b);
+
+	// Batches bypass the single-value buffer and advance the counter by whole blocks.
+	void Fill(std::uint32_t* out, std::size_t count);
+	void Floats(float* out, std::size_t count);
+
+	// Uniform on the unit sphere.
+	void UnitVectors(float* x, float* y, float* z, std::size_t count);
+
+	// Uniform and cosine-weighted on the hemisphere around the unit normal n.
+	void HemisphereVectors(float nx, float ny, float nz, float* x, float* y, float* z, std::size_t count);
+	void CosineHemisphereVectors(float nx, float ny, float nz, float* x, float* y, float* z, std::size_t count);
+
+	std::uint64_t Stream() const;
+	std::uint64_t Counter() const;
+	void Seek(std::uint64_t counter);
+
+private:
+	void Refill();
+
+private:
+	std::uint64_t mKey;
+	std::uint64_t mStream;
+	std::uint64_t mCounter = 0;
+
+	std::uint32_t mBuffer[4] = {};
+	int mBuffered = 0;
+};
+
+// A stream per thread, each on its own stream id, for code that just needs numbers.
+RandomStream& ThreadRandom();
+
+// Reseeds the calling thread's stream; other threads keep theirs.
+void SeedThreadRandom(std::uint64_t seed);
+
+namespace Random
+{
+	// 24 random bits to a float in [0, 1).
+	inline float ToFloat(std::uint32_t bits)
+	{
+		return (float)(bits >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// Branchless mappings from two uniforms in [0, 1).
+	void UnitVector(float u, float v, float& x, float& y, float& z);
+	void HemisphereVector(float u, float v, float nx, float ny, float nz, float& x, float& y, float& z);
+	void CosineHemisphereVector(float u, float v, float nx, float ny, float nz, float& x, float& y, float& z);
+
+	// Point `index` of the first two Sobol dimensions. scramble XORs the digits
+	// (random digit scrambling), so different seeds give decorrelated point sets
+	// with the same stratification.
+	void Sobol2(std::uint32_t index, std::uint32_t scramble, float& x, float& y);
+
+	// Roberts' R2 sequence, open-ended and low-discrepancy at every prefix length.
+	void R2(std::uint32_t index, float& x, float& y);
+}
+
+template<int N>
+void Philox4x32::GeneratePacket(std::uint64_t counter, std::uint64_t stream, std::uint64_t key, std::uint32_t out[4][N])
+{
+	std::uint32_t c0[N], c1[N], c2[N], c3[N];
+	for (int l = 0; l < N; ++l)
+	{
+		std::uint64_t index = counter + (std::uint64_t)l;
+		c0[l] = (std::uint32_t)index;
+		c1[l] = (std::uint32_t)(index >> 32);
+		c2[l] = (std::uint32_t)stream;
+		c3[l] = (std::uint32_t)(stream >> 32);
+	}
+
+	std::uint32_t k0 = (std::uint32_t)key;
+	std::uint32_t k1 = (std::uint32_t)(key >> 32);
+
+	for (int round = 0; round < 10; ++round)
+	{
+		for (int l = 0; l < N; ++l)
+		{
+			std::uint64_t p0 = (std::uint64_t)0xD2511F53u * c0[l];
+			std::uint64_t p1 = (std::uint64_t)0xCD9E8D57u * c2[l];
+			std::uint32_t n0 = (std::uint32_t)(p1 >> 32) ^ c1[l] ^ k0;
+			std::uint32_t n2 = (std::uint32_t)(p0 >> 32) ^ c3[l] ^ k1;
+			c1[l] = (std::uint32_t)p1;
+			c3[l] = (std::uint32_t)p0;
+			c0[l] = n0;
+			c2[l] = n2;
+		}
+		k0 += 0x9E3779B9u;
+		k1 += 0xBB67AE85u;
+	}
+
+	for (int l = 0; l < N; ++l)
+	{
+		out[0][l] = c0[l];
+		out[1][l] = c1[l];
+		out[2][l] = c2[l];
+		out[3][l] = c3[l];
+	}
+}
\ No newline at end of file
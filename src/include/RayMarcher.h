@@ -0,0 +1,360 @@
+#pragma once
+
+#include "Hybrid.h"
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Generic CPU versions of the march loop in PS, instantiated per formula and for
+// float, double and DoubleDouble. The packet variants keep lanes in SoA arrays,
+// but every lane calls the scalar math library, so they are not SIMD kernels and
+// only win where the compiler vectorizes those calls; MarchFormula is the default.
+
+struct MarchParams
+{
+	FractalParams Fractal;
+
+	int MaxSteps = 150;
+	float MaxDistance = 100.0f;
+	float Epsilon = 1e-3f;
+
+	// When non-zero the hit threshold is rayDst * PixelAngle instead of Epsilon,
+	// which keeps surface detail at the pixel scale for deep zooms.
+	double PixelAngle = 0.0;
+
+	template<typename Visit>
+	void VisitPixelFields(Visit&& visit) const
+	{
+		Fractal.VisitPixelFields(visit);
+		visit("steps", MaxSteps);
+		visit("max-distance", MaxDistance);
+		visit("epsilon", Epsilon);
+		visit("pixel-angle", PixelAngle);
+	}
+};
+
+struct ShadowParams
+{
+	int MaxSteps = 32;
+	float MaxDistance = 4.0f;
+
+	// Penumbra sharpness: the shadow factor is the smallest Softness * dist / t on the way.
+	float Softness = 8.0f;
+
+	// Start offset and smallest step, so the ray neither restarts on the surface nor stalls.
+	double MinStep = 1e-3;
+
+	template<typename Visit>
+	void VisitPixelFields(Visit&& visit) const
+	{
+		visit("shadow-steps", MaxSteps);
+		visit("shadow-distance", MaxDistance);
+		visit("shadow-softness", Softness);
+		visit("shadow-min-step", MinStep);
+	}
+};
+
+struct MarchResult
+{
+	int Steps = 0;
+	int Iterations = 0;
+	double Distance = 0.0;
+	bool Hit = false;
+};
+
+// Convenience dispatch for code outside the hot loops; kernels call F::Distance directly.
+template<typename T>
+inline T DistanceEstimate(const Vec3T<T>& position, const FractalParams& params, int& iterations)
+{
+	return VisitFormula(params, [&](auto tag)
+	{
+		typedef typename decltype(tag)::Type F;
+		return F::Distance(position, params, iterations);
+	});
+}
+
+template<typename F, typename T>
+inline MarchResult MarchFormula(const Vec3T<T>& origin, const Vec3T<T>& direction, const MarchParams& params)
+{
+	const T maxDistance = T(params.MaxDistance);
+
+	Vec3T<T> position = origin;
+	T rayDst = T(0.0);
+
+	MarchResult result;
+	while (rayDst < maxDistance && result.Steps < params.MaxSteps)
+	{
+		++result.Steps;
+
+		int iterations = 0;
+		T dist = F::Distance(position, params.Fractal, iterations);
+		T epsilon = params.PixelAngle > 0.0 ? rayDst * T(params.PixelAngle) : T(params.Epsilon);
+
+		// Ray has hit a surface
+		if (dist <= epsilon)
+		{
+			result.Hit = true;
+			result.Iterations = iterations;
+			break;
+		}
+
+		position += direction * dist;
+		rayDst += dist;
+	}
+
+	result.Distance = (double)rayDst;
+	return result;
+}
+
+template<typename T>
+inline MarchResult March(const Vec3T<T>& origin, const Vec3T<T>& direction, const MarchParams& params)
+{
+	return VisitFormula(params.Fractal, [&](auto tag)
+	{
+		typedef typename decltype(tag)::Type F;
+		return MarchFormula<F>(origin, direction, params);
+	});
+}
+
+// Soft shadow towards a light (Quilez's penumbra estimate). Returns 0 (occluded)
+// to 1 (lit); stops early once the ray is fully occluded.
+template<typename F, typename T>
+inline T SoftShadowFormula(const Vec3T<T>& origin, const Vec3T<T>& direction, const FractalParams& fractal, const ShadowParams& params, int& steps)
+{
+	const T minStep = T(params.MinStep);
+	const T maxDistance = T(params.MaxDistance);
+	const T softness = T(params.Softness);
+
+	T shadow = T(1.0);
+	T t = minStep;
+	for (steps = 0; steps < params.MaxSteps && t < maxDistance; )
+	{
+		++steps;
+
+		int iterations = 0;
+		T dist = F::Distance(origin + direction * t, fractal, iterations);
+		T penumbra = softness * dist / t;
+		if (penumbra < shadow)
+			shadow = penumbra;
+		if (shadow < T(0.01))
+			return T(0.0);
+
+		t += dist > minStep ? dist : minStep;
+	}
+	return shadow;
+}
+
+// Marches N rays that share an origin in lockstep.
+template<typename F, typename T, int N>
+inline void MarchPacket(const Vec3T<T>& origin, const T* dx, const T* dy, const T* dz, const MarchParams& params, MarchResult* results)
+{
+	const T maxDistance = T(params.MaxDistance);
+
+	T px[N], py[N], pz[N], rayDst[N], dist[N];
+	int iterations[N];
+	bool active[N];
+
+	for (int l = 0; l < N; ++l)
+	{
+		px[l] = origin.x;
+		py[l] = origin.y;
+		pz[l] = origin.z;
+		rayDst[l] = T(0.0);
+		active[l] = true;
+		results[l] = MarchResult();
+	}
+
+	for (int step = 0; step < params.MaxSteps; ++step)
+	{
+		F::template DistancePacket<T, N>(px, py, pz, params.Fractal, dist, iterations);
+
+		int activeCount = 0;
+		for (int l = 0; l < N; ++l)
+		{
+			if (!active[l])
+				continue;
+
+			++results[l].Steps;
+			T epsilon = params.PixelAngle > 0.0 ? rayDst[l] * T(params.PixelAngle) : T(params.Epsilon);
+
+			if (dist[l] <= epsilon)
+			{
+				results[l].Hit = true;
+				results[l].Iterations = iterations[l];
+				active[l] = false;
+				continue;
+			}
+
+			px[l] += dx[l] * dist[l];
+			py[l] += dy[l] * dist[l];
+			pz[l] += dz[l] * dist[l];
+			rayDst[l] += dist[l];
+
+			active[l] = rayDst[l] < maxDistance;
+			activeCount += active[l] ? 1 : 0;
+		}
+
+		if (activeCount == 0)
+			break;
+	}
+
+	for (int l = 0; l < N; ++l)
+		results[l].Distance = (double)rayDst[l];
+}
+
+// Rays sharing an origin, stored SoA for MarchWavefront. Index is the caller's id
+// for each ray; results are reported by it.
+template<typename T, typename Allocator = std::allocator<T>>
+struct RayQueue
+{
+	template<typename U>
+	using Array = std::vector<U, typename std::allocator_traits<Allocator>::template rebind_alloc<U>>;
+
+	Array<T> Px, Py, Pz;
+	Array<T> Dx, Dy, Dz;
+	Array<T> RayDst;
+	Array<int> Steps;
+	Array<int> Index;
+	int Count = 0;
+
+	explicit RayQueue(const Allocator& allocator = Allocator()) :
+		Px(allocator), Py(allocator), Pz(allocator),
+		Dx(allocator), Dy(allocator), Dz(allocator),
+		RayDst(allocator),
+		Steps(allocator),
+		Index(allocator)
+	{
+	}
+
+	// Grows the arrays to hold at least capacity rays; never shrinks them.
+	void Reserve(int capacity)
+	{
+		if ((int)Index.size() >= capacity)
+			return;
+
+		for (Array<T>* v : { &Px, &Py, &Pz, &Dx, &Dy, &Dz, &RayDst })
+			v->resize(capacity, T(0.0));
+		Steps.resize(capacity, 0);
+		Index.resize(capacity, -1);
+	}
+
+	// The queue must have been reserved for the ray.
+	void Push(const Vec3T<T>& origin, T dx, T dy, T dz, int index)
+	{
+		Px[Count] = origin.x;
+		Py[Count] = origin.y;
+		Pz[Count] = origin.z;
+		Dx[Count] = dx;
+		Dy[Count] = dy;
+		Dz[Count] = dz;
+		RayDst[Count] = T(0.0);
+		Steps[Count] = 0;
+		Index[Count] = index;
+		++Count;
+	}
+};
+
+struct WavefrontStats
+{
+	std::uint64_t Evaluations = 0; // lanes that advanced a live ray
+	std::uint64_t LaneSlots = 0;   // lanes evaluated, live or idle
+};
+
+// Marches every queued ray as one wavefront: each pass advances the live rays
+// stepsPerPass steps in packets of N, then compacts the survivors to the front of
+// the queue, so only the last packet of a pass and rays that finish mid-pass leave
+// lanes idle. Results match MarchPacket and MarchFormula ray for ray. Empties the queue.
+template<typename F, typename T, int N, typename Allocator>
+inline WavefrontStats MarchWavefront(RayQueue<T, Allocator>& rays, const MarchParams& params, int stepsPerPass, MarchResult* results)
+{
+	const T maxDistance = T(params.MaxDistance);
+	stepsPerPass = stepsPerPass > 1 ? stepsPerPass : 1;
+
+	// The last packet of a pass reads up to N - 1 slots past Count.
+	rays.Reserve(rays.Count + N);
+
+	WavefrontStats stats;
+	T dist[N];
+	int iterations[N];
+
+	while (rays.Count > 0)
+	{
+		for (int first = 0; first < rays.Count; first += N)
+		{
+			const int lanes = rays.Count - first < N ? rays.Count - first : N;
+			T* px = &rays.Px[first];
+			T* py = &rays.Py[first];
+			T* pz = &rays.Pz[first];
+			T* rayDst = &rays.RayDst[first];
+			int* steps = &rays.Steps[first];
+			int* index = &rays.Index[first];
+
+			for (int step = 0; step < stepsPerPass; ++step)
+			{
+				F::template DistancePacket<T, N>(px, py, pz, params.Fractal, dist, iterations);
+				stats.LaneSlots += N;
+
+				int live = 0;
+				for (int l = 0; l < lanes; ++l)
+				{
+					// Finished rays keep their slot until the pass compacts them away.
+					if (index[l] < 0)
+						continue;
+
+					++steps[l];
+					++stats.Evaluations;
+					T epsilon = params.PixelAngle > 0.0 ? rayDst[l] * T(params.PixelAngle) : T(params.Epsilon);
+
+					bool hit = dist[l] <= epsilon;
+					if (!hit)
+					{
+						px[l] += rays.Dx[first + l] * dist[l];
+						py[l] += rays.Dy[first + l] * dist[l];
+						pz[l] += rays.Dz[first + l] * dist[l];
+						rayDst[l] += dist[l];
+					}
+
+					if (hit || !(rayDst[l] < maxDistance) || steps[l] >= params.MaxSteps)
+					{
+						MarchResult& result = results[index[l]];
+						result.Steps = steps[l];
+						result.Iterations = hit ? iterations[l] : 0;
+						result.Distance = (double)rayDst[l];
+						result.Hit = hit;
+						index[l] = -1;
+						continue;
+					}
+					++live;
+				}
+
+				if (live == 0)
+					break;
+			}
+		}
+
+		int count = 0;
+		for (int i = 0; i < rays.Count; ++i)
+		{
+			if (rays.Index[i] < 0)
+				continue;
+
+			if (count != i)
+			{
+				rays.Px[count] = rays.Px[i];
+				rays.Py[count] = rays.Py[i];
+				rays.Pz[count] = rays.Pz[i];
+				rays.Dx[count] = rays.Dx[i];
+				rays.Dy[count] = rays.Dy[i];
+				rays.Dz[count] = rays.Dz[i];
+				rays.RayDst[count] = rays.RayDst[i];
+				rays.Steps[count] = rays.Steps[i];
+				rays.Index[count] = rays.Index[i];
+			}
+			++count;
+		}
+		rays.Count = count;
+	}
+
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+
+// Memory a LinearRingAllocator carves up: a persistently mapped upload heap on
+// D3D12 (UploadHeapBackend), or plain host memory (HostMemoryBackend).
+class IMemoryBackend
+{
+public:
+	virtual ~IMemoryBackend() = default;
+
+	// Base of the block; must be aligned to at least LinearRingAllocator::DefaultAlignment.
+	virtual std::uint8_t* CpuAddress() = 0;
+
+	// Address the GPU sees for the base, 0 when the memory is host only.
+	virtual std::uint64_t GpuAddress() const = 0;
+
+	virtual std::size_t Size() const = 0;
+};
+
+// Aligned heap memory with no GPU address. Only -check-ring and -bench ring use it;
+// the CPU renderer's scratch memory comes from its arenas (Arena.h).
+class HostMemoryBackend : public IMemoryBackend
+{
+public:
+	explicit HostMemoryBackend(std::size_t size);
+
+	std::uint8_t* CpuAddress() override;
+	std::uint64_t GpuAddress() const override;
+	std::size_t Size() const override;
+
+private:
+	std::unique_ptr<std::uint8_t[]> mStorage;
+	std::uint8_t* mBase = nullptr;
+	std::size_t mSize = 0;
+};
+
+struct RingAllocation
+{
+	std::uint8_t* Cpu = nullptr;
+	std::uint64_t Gpu = 0;
+	std::size_t Offset = 0;
+	std::size_t Size = 0;
+
+	explicit operator bool() const { return Cpu != nullptr; }
+};
+
+struct RingAllocatorStats
+{
+	std::uint64_t Allocations = 0;
+	std::uint64_t Failures = 0;
+	std::uint64_t Frames = 0;
+
+	std::uint64_t RequestedBytes = 0;
+	std::uint64_t PaddingBytes = 0; // lost to alignment
+	std::uint64_t WrapBytes = 0;    // skipped at the end of the ring when an allocation did not fit
+
+	std::size_t PeakUsed = 0;
+
+	// Share of the consumed bytes that held no data.
+	double Fragmentation() const;
+	double AllocationsPerFrame() const;
+	double BytesPerFrame() const;
+};
+
+// Bump allocator over a ring of memory for data that lives for one frame. Allocations
+// are never freed individually: EndFrame tags everything allocated since the last
+// EndFrame with a fence value, and Reclaim releases frames whose fence has completed.
+// Not thread safe; one thread records a frame at a time.
+class LinearRingAllocator
+{
+public:
+	// D3D12 constant buffer views need 256-byte aligned addresses.
+	static constexpr std::size_t DefaultAlignment = 256;
+
+	explicit LinearRingAllocator(IMemoryBackend& backend);
+	LinearRingAllocator(const LinearRingAllocator& rhs) = delete;
+	LinearRingAllocator& operator=(const LinearRingAllocator& rhs) = delete;
+
+	// Returns an empty allocation when the ring is full of frames still in flight.
+	RingAllocation Allocate(std::size_t size, std::size_t alignment = DefaultAlignment);
+
+	template<typename T>
+	RingAllocation Push(const T& value, std::size_t alignment = DefaultAlignment)
+	{
+		RingAllocation allocation = Allocate(sizeof(T), alignment);
+		if (allocation)
+			std::memcpy(allocation.Cpu, &value, sizeof(T));
+		return allocation;
+	}
+
+	void EndFrame(std::uint64_t fence);
+	void Reclaim(std::uint64_t completedFence);
+
+	std::size_t Capacity() const;
+	std::size_t Used() const;
+	const RingAllocatorStats& Stats() const;
+
+private:
+	struct FrameMark
+	{
+		std::uint64_t Fence;
+		std::uint64_t End;
+	};
+
+	IMemoryBackend& mBackend;
+	std::size_t mCapacity;
+
+	// Running byte counts; the offset into the ring is the count modulo the capacity.
+	std::uint64_t mHead = 0;
+	std::uint64_t mTail = 0;
+
+	std::deque<FrameMark> mFrames;
+	RingAllocatorStats mStats;
+};
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "HlslShim.h"
+
+// The shaders' distance estimator and march loop, compiled from the same source as
+// Fractal.hlsl. The CPU renderer has its own templated kernel (Formulas.h,
+// RayMarcher.h); -check-shader holds its float tier to this reference exactly.
+namespace Hlsl
+{
+#include "../../shaders/SceneInfo.hlsli"
+}
\ No newline at end of file
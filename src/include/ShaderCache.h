@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ShaderDefine
+{
+	std::string Name;
+	std::string Value;
+};
+
+// One shader permutation: a source file compiled for an entry point and target with a set of macros.
+struct ShaderRequest
+{
+	std::string Path;
+	std::string EntryPoint;
+	std::string Target;
+	std::vector<ShaderDefine> Defines;
+	unsigned Flags = 0;
+};
+
+typedef std::vector<std::uint8_t> ShaderBytecode;
+
+// The compiler behind the cache: D3DShaderCompiler on Windows, a stub in the headless checks.
+class IShaderCompiler
+{
+public:
+	virtual ~IShaderCompiler() = default;
+
+	// Compiles request and appends the path of every file the preprocessor opened, other
+	// than request.Path itself, to includes. Returns false and fills errors on failure.
+	virtual bool Compile(const ShaderRequest& request, ShaderBytecode& bytecode, std::vector<std::string>& includes, std::string& errors) = 0;
+};
+
+struct ShaderCacheStats
+{
+	int Hits = 0;
+	int Misses = 0;      // no cache entry yet
+	int Invalidated = 0; // the source, an include or the bytecode file changed
+	int Failures = 0;
+
+	double LookupMs = 0.0;  // hashing and validating entries
+	double CompileMs = 0.0;
+};
+
+// Bytecode cache on disk. Each permutation is keyed by a hash of its path, entry point,
+// target, flags and defines, and stored as <key>.cso plus a <key>.deps manifest with
+// content hashes of the source, every include and the bytecode. An entry is reused only
+// while all of them still match, so editing any included file recompiles its users.
+class ShaderCache
+{
+public:
+	ShaderCache(IShaderCompiler& compiler, const std::string& directory);
+
+	// Returns the path of up-to-date bytecode for request (for d3dUtil::LoadBinary),
+	// compiling it if needed, or an empty string on a compile error.
+	std::string Resolve(const ShaderRequest& request, std::string* errors = nullptr);
+
+	// Resolve and read the bytecode.
+	bool Load(const ShaderRequest& request, ShaderBytecode& bytecode, std::string* errors = nullptr);
+
+	const ShaderCacheStats& Stats() const;
+
+	static std::string Key(const ShaderRequest& request);
+
+private:
+	bool IsValid(const std::string& depsPath, const std::string& bytecodePath) const;
+
+private:
+	IShaderCompiler& mCompiler;
+	std::string mDirectory;
+	ShaderCacheStats mStats;
+};
\ No newline at end of file
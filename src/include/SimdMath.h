@@ -0,0 +1,449 @@
+#pragma once
+
+#include <cmath>
+
+// Portable 4-wide float math with the conventions of DirectXMath: row vectors,
+// v * M, row-major matrices and left-handed view/projection matrices. Uses SSE
+// on x86 (and FMA when the compiler targets AVX2), plain floats elsewhere or
+// when SIMD_MATH_SCALAR is defined.
+
+#if !defined(SIMD_MATH_SCALAR) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define SIMD_MATH_SSE 1
+#include <xmmintrin.h>
+#if defined(__FMA__) || defined(__AVX2__)
+#define SIMD_MATH_FMA 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace Simd
+{
+	// Plain storage types, layout-compatible with the XMFLOAT types.
+	struct Float2
+	{
+		float x, y;
+
+		Float2() = default;
+		Float2(float x, float y) : x(x), y(y) {}
+	};
+
+	struct Float3
+	{
+		float x, y, z;
+
+		Float3() = default;
+		Float3(float x, float y, float z) : x(x), y(y), z(z) {}
+	};
+
+	struct Float4
+	{
+		float x, y, z, w;
+
+		Float4() = default;
+		Float4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	};
+
+	struct Float4x4
+	{
+		float m[4][4];
+
+		Float4x4() = default;
+		Float4x4(
+			float m00, float m01, float m02, float m03,
+			float m10, float m11, float m12, float m13,
+			float m20, float m21, float m22, float m23,
+			float m30, float m31, float m32, float m33) :
+			m{ { m00, m01, m02, m03 }, { m10, m11, m12, m13 }, { m20, m21, m22, m23 }, { m30, m31, m32, m33 } }
+		{
+		}
+	};
+
+	struct alignas(16) Vector
+	{
+#ifdef SIMD_MATH_SSE
+		__m128 v;
+#else
+		float v[4];
+#endif
+	};
+
+	struct alignas(16) Matrix
+	{
+		Vector r[4];
+	};
+
+	inline Vector VectorSet(float x, float y, float z, float w)
+	{
+#ifdef SIMD_MATH_SSE
+		return { _mm_setr_ps(x, y, z, w) };
+#else
+		return { { x, y, z, w } };
+#endif
+	}
+
+	inline Vector VectorReplicate(float s)
+	{
+		return VectorSet(s, s, s, s);
+	}
+
+	inline Vector VectorZero()
+	{
+		return VectorReplicate(0.0f);
+	}
+
+	inline Float4 VectorToFloat4(Vector a)
+	{
+		Float4 f;
+#ifdef SIMD_MATH_SSE
+		_mm_storeu_ps(&f.x, a.v);
+#else
+		f = Float4(a.v[0], a.v[1], a.v[2], a.v[3]);
+#endif
+		return f;
+	}
+
+	inline float VectorGetX(Vector a)
+	{
+#ifdef SIMD_MATH_SSE
+		return _mm_cvtss_f32(a.v);
+#else
+		return a.v[0];
+#endif
+	}
+
+#ifdef SIMD_MATH_SSE
+	// Lanes x, y, z, w of the result are taken from lanes X, Y, Z, W of a.
+	template<int X, int Y, int Z, int W>
+	inline Vector VectorSwizzle(Vector a)
+	{
+		return { _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(W, Z, Y, X)) };
+	}
+
+	// Lanes x, y from a and z, w from b.
+	template<int X, int Y, int Z, int W>
+	inline Vector VectorShuffle(Vector a, Vector b)
+	{
+		return { _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(W, Z, Y, X)) };
+	}
+#else
+	template<int X, int Y, int Z, int W>
+	inline Vector VectorSwizzle(Vector a)
+	{
+		return { { a.v[X], a.v[Y], a.v[Z], a.v[W] } };
+	}
+
+	template<int X, int Y, int Z, int W>
+	inline Vector VectorShuffle(Vector a, Vector b)
+	{
+		return { { a.v[X], a.v[Y], b.v[Z], b.v[W] } };
+	}
+#endif
+
+	template<int I>
+	inline Vector VectorSplat(Vector a)
+	{
+		return VectorSwizzle<I, I, I, I>(a);
+	}
+
+#ifdef SIMD_MATH_SSE
+	inline Vector operator+(Vector a, Vector b) { return { _mm_add_ps(a.v, b.v) }; }
+	inline Vector operator-(Vector a, Vector b) { return { _mm_sub_ps(a.v, b.v) }; }
+	inline Vector operator*(Vector a, Vector b) { return { _mm_mul_ps(a.v, b.v) }; }
+	inline Vector operator/(Vector a, Vector b) { return { _mm_div_ps(a.v, b.v) }; }
+
+	// a * b + c
+	inline Vector VectorMultiplyAdd(Vector a, Vector b, Vector c)
+	{
+#ifdef SIMD_MATH_FMA
+		return { _mm_fmadd_ps(a.v, b.v, c.v) };
+#else
+		return { _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v) };
+#endif
+	}
+#else
+	inline Vector operator+(Vector a, Vector b) { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+	inline Vector operator-(Vector a, Vector b) { return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+	inline Vector operator*(Vector a, Vector b) { return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+	inline Vector operator/(Vector a, Vector b) { return { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; }
+
+	inline Vector VectorMultiplyAdd(Vector a, Vector b, Vector c)
+	{
+		return a * b + c;
+	}
+#endif
+
+	inline Vector operator*(Vector a, float s) { return a * VectorReplicate(s); }
+	inline Vector operator*(float s, Vector a) { return a * VectorReplicate(s); }
+	inline Vector operator-(Vector a) { return VectorZero() - a; }
+
+	// Keeps x, y, z of a and takes w from b.
+	inline Vector VectorSelectW(Vector a, Vector b)
+	{
+		Vector zw = VectorShuffle<2, 2, 3, 3>(a, b);
+		return VectorShuffle<0, 1, 0, 3>(a, zw);
+	}
+
+	// Dot products are replicated to every lane, as in DirectXMath.
+	inline Vector Vector3Dot(Vector a, Vector b)
+	{
+		Vector p = a * b;
+		return VectorSplat<0>(p) + VectorSplat<1>(p) + VectorSplat<2>(p);
+	}
+
+	inline Vector Vector4Dot(Vector a, Vector b)
+	{
+		Vector p = a * b;
+		p = p + VectorSwizzle<1, 0, 3, 2>(p);
+		return p + VectorSwizzle<2, 3, 0, 1>(p);
+	}
+
+	inline Vector Vector3Cross(Vector a, Vector b)
+	{
+		Vector r = VectorSwizzle<1, 2, 0, 3>(a) * VectorSwizzle<2, 0, 1, 3>(b)
+			- VectorSwizzle<2, 0, 1, 3>(a) * VectorSwizzle<1, 2, 0, 3>(b);
+		return VectorSelectW(r, VectorZero());
+	}
+
+	inline Vector Vector3LengthSq(Vector a)
+	{
+		return Vector3Dot(a, a);
+	}
+
+	inline Vector Vector3Length(Vector a)
+	{
+		return VectorReplicate(std::sqrt(VectorGetX(Vector3LengthSq(a))));
+	}
+
+	inline Vector Vector3Normalize(Vector a)
+	{
+		float length = VectorGetX(Vector3Length(a));
+		return length > 0.0f ? a * (1.0f / length) : a;
+	}
+
+	inline Vector LoadFloat3(const Float3& f)
+	{
+		return VectorSet(f.x, f.y, f.z, 0.0f);
+	}
+
+	inline void StoreFloat3(Float3* out, Vector a)
+	{
+		Float4 f = VectorToFloat4(a);
+		*out = Float3(f.x, f.y, f.z);
+	}
+
+	inline Matrix LoadFloat4x4(const Float4x4& f)
+	{
+		Matrix m;
+		for (int i = 0; i < 4; ++i)
+			m.r[i] = VectorSet(f.m[i][0], f.m[i][1], f.m[i][2], f.m[i][3]);
+		return m;
+	}
+
+	inline void StoreFloat4x4(Float4x4* out, const Matrix& m)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			Float4 row = VectorToFloat4(m.r[i]);
+			out->m[i][0] = row.x;
+			out->m[i][1] = row.y;
+			out->m[i][2] = row.z;
+			out->m[i][3] = row.w;
+		}
+	}
+
+	inline Matrix MatrixSet(
+		float m00, float m01, float m02, float m03,
+		float m10, float m11, float m12, float m13,
+		float m20, float m21, float m22, float m23,
+		float m30, float m31, float m32, float m33)
+	{
+		Matrix m;
+		m.r[0] = VectorSet(m00, m01, m02, m03);
+		m.r[1] = VectorSet(m10, m11, m12, m13);
+		m.r[2] = VectorSet(m20, m21, m22, m23);
+		m.r[3] = VectorSet(m30, m31, m32, m33);
+		return m;
+	}
+
+	inline Matrix MatrixIdentity()
+	{
+		return MatrixSet(
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	// Row vector times matrix.
+	inline Vector Vector4Transform(Vector v, const Matrix& m)
+	{
+		Vector r = VectorSplat<0>(v) * m.r[0];
+		r = VectorMultiplyAdd(VectorSplat<1>(v), m.r[1], r);
+		r = VectorMultiplyAdd(VectorSplat<2>(v), m.r[2], r);
+		return VectorMultiplyAdd(VectorSplat<3>(v), m.r[3], r);
+	}
+
+	inline Matrix MatrixMultiply(const Matrix& a, const Matrix& b)
+	{
+		Matrix m;
+		for (int i = 0; i < 4; ++i)
+			m.r[i] = Vector4Transform(a.r[i], b);
+		return m;
+	}
+
+	inline Matrix operator*(const Matrix& a, const Matrix& b)
+	{
+		return MatrixMultiply(a, b);
+	}
+
+	inline Matrix MatrixTranspose(const Matrix& m)
+	{
+		Vector t0 = VectorShuffle<0, 1, 0, 1>(m.r[0], m.r[1]); // m00 m01 m10 m11
+		Vector t1 = VectorShuffle<2, 3, 2, 3>(m.r[0], m.r[1]); // m02 m03 m12 m13
+		Vector t2 = VectorShuffle<0, 1, 0, 1>(m.r[2], m.r[3]); // m20 m21 m30 m31
+		Vector t3 = VectorShuffle<2, 3, 2, 3>(m.r[2], m.r[3]); // m22 m23 m32 m33
+
+		Matrix t;
+		t.r[0] = VectorShuffle<0, 2, 0, 2>(t0, t2);
+		t.r[1] = VectorShuffle<1, 3, 1, 3>(t0, t2);
+		t.r[2] = VectorShuffle<0, 2, 0, 2>(t1, t3);
+		t.r[3] = VectorShuffle<1, 3, 1, 3>(t1, t3);
+		return t;
+	}
+
+	namespace Detail
+	{
+		// 2x2 matrices stored row-major in one vector (a b / c d).
+
+		// A * B
+		inline Vector Mat2Mul(Vector a, Vector b)
+		{
+			return a * VectorSwizzle<0, 3, 0, 3>(b) + VectorSwizzle<1, 0, 3, 2>(a) * VectorSwizzle<2, 1, 2, 1>(b);
+		}
+
+		// adj(A) * B
+		inline Vector Mat2AdjMul(Vector a, Vector b)
+		{
+			return VectorSwizzle<3, 3, 0, 0>(a) * b - VectorSwizzle<1, 1, 2, 2>(a) * VectorSwizzle<2, 3, 0, 1>(b);
+		}
+
+		// A * adj(B)
+		inline Vector Mat2MulAdj(Vector a, Vector b)
+		{
+			return a * VectorSwizzle<3, 0, 3, 0>(b) - VectorSwizzle<1, 0, 3, 2>(a) * VectorSwizzle<2, 1, 2, 1>(b);
+		}
+
+		// Blockwise inverse (A B / C D) of a 4x4 matrix. Returns the adjugate blocks
+		// X, Y, Z, W (unscaled and still in 2x2 adjugate order) and the determinant.
+		inline void InverseBlocks(const Matrix& m, Vector& x, Vector& y, Vector& z, Vector& w, Vector& det)
+		{
+			Vector a = VectorShuffle<0, 1, 0, 1>(m.r[0], m.r[1]);
+			Vector b = VectorShuffle<2, 3, 2, 3>(m.r[0], m.r[1]);
+			Vector c = VectorShuffle<0, 1, 0, 1>(m.r[2], m.r[3]);
+			Vector d = VectorShuffle<2, 3, 2, 3>(m.r[2], m.r[3]);
+
+			// (|A| |B| |C| |D|)
+			Vector detSub = VectorShuffle<0, 2, 0, 2>(m.r[0], m.r[2]) * VectorShuffle<1, 3, 1, 3>(m.r[1], m.r[3])
+				- VectorShuffle<1, 3, 1, 3>(m.r[0], m.r[2]) * VectorShuffle<0, 2, 0, 2>(m.r[1], m.r[3]);
+			Vector detA = VectorSplat<0>(detSub);
+			Vector detB = VectorSplat<1>(detSub);
+			Vector detC = VectorSplat<2>(detSub);
+			Vector detD = VectorSplat<3>(detSub);
+
+			Vector dc = Mat2AdjMul(d, c);
+			Vector ab = Mat2AdjMul(a, b);
+
+			x = detD * a - Mat2Mul(b, dc);
+			w = detA * d - Mat2Mul(c, ab);
+			y = detB * c - Mat2MulAdj(d, ab);
+			z = detC * b - Mat2MulAdj(a, dc);
+
+			// |M| = |A||D| + |B||C| - tr(adj(A) B adj(D) C)
+			Vector tr = ab * VectorSwizzle<0, 2, 1, 3>(dc);
+			tr = tr + VectorSwizzle<1, 0, 3, 2>(tr);
+			tr = tr + VectorSwizzle<2, 3, 0, 1>(tr);
+			det = detA * detD + detB * detC - tr;
+		}
+	}
+
+	// Determinant replicated to every lane.
+	inline Vector MatrixDeterminant(const Matrix& m)
+	{
+		Vector x, y, z, w, det;
+		Detail::InverseBlocks(m, x, y, z, w, det);
+		return det;
+	}
+
+	// Like XMMatrixInverse: optionally returns the determinant; a singular matrix gives infinities.
+	inline Matrix MatrixInverse(Vector* determinant, const Matrix& m)
+	{
+		Vector x, y, z, w, det;
+		Detail::InverseBlocks(m, x, y, z, w, det);
+		if (determinant != nullptr)
+			*determinant = det;
+
+		Vector rcp = VectorSet(1.0f, -1.0f, -1.0f, 1.0f) / det;
+		x = x * rcp;
+		y = y * rcp;
+		z = z * rcp;
+		w = w * rcp;
+
+		// Undo the adjugate order while interleaving the blocks back into rows.
+		Matrix r;
+		r.r[0] = VectorShuffle<3, 1, 3, 1>(x, y);
+		r.r[1] = VectorShuffle<2, 0, 2, 0>(x, y);
+		r.r[2] = VectorShuffle<3, 1, 3, 1>(z, w);
+		r.r[3] = VectorShuffle<2, 0, 2, 0>(z, w);
+		return r;
+	}
+
+	inline Matrix MatrixLookToLH(Vector eye, Vector direction, Vector up)
+	{
+		Vector r2 = Vector3Normalize(direction);
+		Vector r0 = Vector3Normalize(Vector3Cross(up, r2));
+		Vector r1 = Vector3Cross(r2, r0);
+
+		Vector negEye = -eye;
+
+		Matrix m;
+		m.r[0] = VectorSelectW(r0, Vector3Dot(r0, negEye));
+		m.r[1] = VectorSelectW(r1, Vector3Dot(r1, negEye));
+		m.r[2] = VectorSelectW(r2, Vector3Dot(r2, negEye));
+		m.r[3] = VectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+		return MatrixTranspose(m);
+	}
+
+	inline Matrix MatrixLookAtLH(Vector eye, Vector focus, Vector up)
+	{
+		return MatrixLookToLH(eye, focus - eye, up);
+	}
+
+	inline Matrix MatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+	{
+		float height = std::cos(0.5f * fovAngleY) / std::sin(0.5f * fovAngleY);
+		float width = height / aspectRatio;
+		float range = farZ / (farZ - nearZ);
+
+		return MatrixSet(
+			width, 0.0f, 0.0f, 0.0f,
+			0.0f, height, 0.0f, 0.0f,
+			0.0f, 0.0f, range, 1.0f,
+			0.0f, 0.0f, -range * nearZ, 0.0f);
+	}
+
+	inline Matrix MatrixTranslation(float x, float y, float z)
+	{
+		Matrix m = MatrixIdentity();
+		m.r[3] = VectorSet(x, y, z, 1.0f);
+		return m;
+	}
+
+	inline Matrix MatrixScaling(float x, float y, float z)
+	{
+		return MatrixSet(
+			x, 0.0f, 0.0f, 0.0f,
+			0.0f, y, 0.0f, 0.0f,
+			0.0f, 0.0f, z, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "CameraRecording.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// One published simulation step: the state before and after the tick, so the
+// renderer can interpolate between them.
+struct SimulationSnapshot
+{
+	std::uint64_t Tick = 0;
+	double Time = 0.0; // seconds since Start at which Current became valid
+	CameraState Previous;
+	CameraState Current;
+};
+
+// Runs CameraController at a fixed rate on its own thread, independent of how
+// long frames take to render. Snapshots are handed to the render thread through
+// a TripleBuffer.
+class Simulation
+{
+public:
+	// Replaces the submitted input, e.g. for scripted headless runs. Called on the simulation thread.
+	typedef std::function<void(std::uint64_t tick, CameraInput& input)> InputScript;
+
+	explicit Simulation(double tickRate = 120.0);
+	Simulation(const Simulation& rhs) = delete;
+	Simulation& operator=(const Simulation& rhs) = delete;
+	~Simulation();
+
+	void Start(const CameraState& initial, InputScript script = InputScript());
+	void Stop();
+
+	double TickRate() const;
+	double Dt() const;
+	std::uint64_t Ticks() const;
+
+	// Merges input from the UI thread: held keys are replaced, deltas accumulate until the next tick.
+	void Submit(const CameraInput& input);
+
+	// Render-thread side. The state at time now (seconds since Start), interpolated one tick behind.
+	CameraState Sample(double now);
+	CameraState Sample();
+
+	double Now() const;
+
+	// Records every tick's input with the fixed timestep, so -replay-dt 1/rate reproduces it.
+	void StartRecording();
+	bool StopRecording(const std::string& path);
+
+	static CameraState Interpolate(const CameraState& a, const CameraState& b, float t);
+
+private:
+	void ThreadLoop();
+
+private:
+	double mTickRate;
+	double mDt;
+	CameraController mController;
+	InputScript mScript;
+
+	std::thread mThread;
+	std::atomic<bool> mRunning{ false };
+	std::atomic<std::uint64_t> mTicks{ 0 };
+	std::chrono::steady_clock::time_point mStart;
+
+	std::mutex mInputMutex;
+	CameraInput mPendingInput;
+	CameraRecording mRecording;
+	bool mRecordingRequested = false;
+	bool mRecordingActive = false;
+
+	CameraState mState;
+	TripleBuffer<SimulationSnapshot> mSnapshots;
+};
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct OutputSpan
+{
+	const void* Data;
+	std::size_t Size;
+};
+
+// Unbuffered output to a file, named pipe or stdout. Writes take a list of spans
+// (writev) so headers and pixel data go out without being copied into one buffer.
+// On Linux, pipes are fed with vmsplice, which hands the pages to the pipe
+// instead of copying them; the caller must then keep a written buffer unchanged
+// until RetainBytes() more bytes have been written after it.
+class StreamWriter
+{
+public:
+	StreamWriter();
+	StreamWriter(const StreamWriter& rhs) = delete;
+	StreamWriter& operator=(const StreamWriter& rhs) = delete;
+	~StreamWriter();
+
+	// "-" writes to stdout.
+	bool Open(const std::string& path);
+
+	// Opens an existing file to write after its first size bytes, dropping the rest.
+	bool Reopen(const std::string& path, std::uint64_t size);
+	bool Close();
+	bool IsOpen() const;
+
+	// Blocks until everything is written; a slow reader throttles the caller.
+	bool Write(const OutputSpan* spans, int count);
+
+	// Bytes a written buffer may still be referenced by: the pipe capacity when splicing, else 0.
+	std::size_t RetainBytes() const;
+
+	// Waits until the reader has consumed all spliced data, so retained buffers may be freed.
+	// Returns early if the reader closes the pipe, and gives up after 10 seconds.
+	void Drain();
+
+	std::uint64_t BytesWritten() const;
+
+private:
+	bool WriteCopy(const OutputSpan* spans, int count);
+	bool WriteSplice(const OutputSpan* spans, int count);
+
+private:
+	int mFd = -1;
+	bool mOwnsFd = false;
+	bool mSplice = false;
+	std::size_t mPipeCapacity = 0;
+	std::uint64_t mBytesWritten = 0;
+};
\ No newline at end of file
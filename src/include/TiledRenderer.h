@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CpuRenderer.h"
+#include <cstdint>
+#include <string>
+
+// One image too large for a framebuffer (poster prints), rendered tile by tile
+// into a tiled TIFF. Memory depends on the tile size, not the image size.
+struct TiledRenderOptions
+{
+	int Width = 8192;
+	int Height = 8192;
+	int TileSize = 512; // multiple of 16, and of Settings.TileSize with anti-aliasing
+	int Dpi = 300;
+	int Threads = 0;
+
+	CpuCamera Camera;
+	RenderSettings Settings;
+
+	std::string Output = "poster.tif";
+
+	// Finished tiles are checkpointed at most this often.
+	double CheckpointSeconds = 10.0;
+
+	// Stop after rendering this many tiles, as if interrupted; 0 renders them all.
+	int MaxTiles = 0;
+};
+
+struct TiledRenderStats
+{
+	int Tiles = 0;
+	int Rendered = 0; // by this run
+	int Skipped = 0;  // finished by an earlier run
+	int Damaged = 0;  // checkpointed, but failed their checksum and were rendered again
+	bool Resumed = false;
+	double TotalMs = 0.0;
+	double CheckpointMs = 0.0;
+	std::uint64_t BytesWritten = 0;
+};
+
+// Each tile is rendered with an apron of extra pixels that is cropped away, so the
+// passes that read neighbouring pixels (upsampling, lighting normals, anti-aliasing
+// edges) see the same neighbours as in one large render and tiles join without
+// seams. Finished tiles are checkpointed to <Output>.checkpoint; a run that finds
+// the checkpoint of the same image resumes it and skips the tiles that verify.
+class TiledRenderer
+{
+public:
+	explicit TiledRenderer(const TiledRenderOptions& options);
+
+	// Returns false and sets Error() if the output could not be written.
+	bool Run();
+
+	bool Finished() const;
+	const TiledRenderStats& Stats() const;
+	const std::string& Error() const;
+
+	std::string CheckpointPath() const;
+
+	static int RunDefault(const TiledRenderOptions& options);
+
+private:
+	// Identifies the image, so the checkpoint of a different render is never resumed.
+	std::string Signature() const;
+	int Apron() const;
+
+private:
+	TiledRenderOptions mOptions;
+	TiledRenderStats mStats;
+	std::string mError;
+};
\ No newline at end of file
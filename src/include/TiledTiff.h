@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Uncompressed, tiled 8-bit RGB TIFF. Every tile has a fixed size and place in the
+// file, so tiles can be written in any order, one at a time, and a file can be
+// reopened to fill in the tiles it is missing. Images whose file would pass 4 GB
+// need BigTIFF, which most print and image tools read.
+class TiledTiff
+{
+public:
+	TiledTiff() = default;
+	TiledTiff(const TiledTiff& rhs) = delete;
+	TiledTiff& operator=(const TiledTiff& rhs) = delete;
+
+	// Why a layout cannot be written, or null if it can.
+	static const char* LayoutError(int width, int height, int tileSize);
+	static bool NeedsBigTiff(int width, int height, int tileSize);
+
+	// tileSize must be a multiple of 16. Create starts an empty file of the full size;
+	// Open reopens one written with the same parameters and keeps its tiles.
+	bool Create(const std::string& path, int width, int height, int tileSize, int dpi, bool bigTiff);
+	bool Open(const std::string& path, int width, int height, int tileSize, int dpi, bool bigTiff);
+	bool Close();
+
+	// tileSize x tileSize RGB pixels; tiles on the right and bottom edges are
+	// padded to full size, as TIFF requires.
+	bool WriteTile(int tileX, int tileY, const std::uint8_t* rgb);
+	bool ReadTile(int tileX, int tileY, std::uint8_t* rgb);
+
+	int TilesX() const;
+	int TilesY() const;
+	std::size_t TileBytes() const;
+	const std::string& Error() const;
+
+private:
+	// Header, IFD and tile tables; tile data follows at mDataOffset.
+	std::vector<std::uint8_t> BuildHeader() const;
+	void SetLayout(int width, int height, int tileSize, int dpi, bool bigTiff);
+	bool Fail(const std::string& error);
+
+private:
+	std::fstream mFile;
+	int mWidth = 0;
+	int mHeight = 0;
+	int mTileSize = 0;
+	int mDpi = 0;
+	bool mBigTiff = false;
+	int mTilesX = 0;
+	int mTilesY = 0;
+	std::uint64_t mDataOffset = 0;
+	std::string mError;
+};
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped-zone tracing that writes Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+// Each thread appends to its own chunked buffer without locks after its first
+// zone of a session; a disabled tracer costs one relaxed load per zone and
+// allocates nothing. Define TRACE_ENABLED to 0 to compile
+// the zones out entirely.
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+class Trace
+{
+public:
+	// Zones are recorded between Start and Stop.
+	static void Start();
+	static void Stop();
+	static bool IsActive() { return sActive.load(std::memory_order_relaxed); }
+
+	// Writes every zone recorded since the last Start.
+	static bool WriteJson(const std::string& path);
+
+	// Names the calling thread in the trace viewer.
+	static void SetThreadName(const char* name);
+
+	// Nanoseconds on a monotonic clock.
+	static std::uint64_t Now();
+
+	// name must outlive the trace, i.e. be a string literal.
+	static void Record(const char* name, std::uint64_t begin, std::uint64_t end);
+
+private:
+	static std::atomic<bool> sActive;
+};
+
+class TraceScope
+{
+public:
+	explicit TraceScope(const char* name) :
+		mName(Trace::IsActive() ? name : nullptr),
+		mBegin(mName != nullptr ? Trace::Now() : 0)
+	{
+	}
+
+	TraceScope(const TraceScope& rhs) = delete;
+	TraceScope& operator=(const TraceScope& rhs) = delete;
+
+	~TraceScope()
+	{
+		if (mName != nullptr)
+			Trace::Record(mName, mBegin, Trace::Now());
+	}
+
+private:
+	const char* mName;
+	std::uint64_t mBegin;
+};
+
+#if TRACE_ENABLED
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) Trace::SetThreadName(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+
+// Single-producer, single-consumer triple buffer. The writer fills Back() and
+// publishes it; the reader picks up the newest published value. Neither side
+// ever waits, and a slow reader simply skips values.
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() = default;
+	TripleBuffer(const TripleBuffer& rhs) = delete;
+	TripleBuffer& operator=(const TripleBuffer& rhs) = delete;
+
+	// Writer side.
+	T& Back()
+	{
+		return mSlots[mBack].Value;
+	}
+
+	void Publish()
+	{
+		mBack = mMiddle.exchange(mBack | NewBit, std::memory_order_acq_rel) & IndexMask;
+	}
+
+	// Reader side. Returns true if a newer value was published since the last call.
+	bool Update()
+	{
+		if ((mMiddle.load(std::memory_order_relaxed) & NewBit) == 0)
+			return false;
+
+		mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & IndexMask;
+		return true;
+	}
+
+	const T& Front() const
+	{
+		return mSlots[mFront].Value;
+	}
+
+private:
+	static const int IndexMask = 3;
+	static const int NewBit = 4;
+
+	// Separate cache lines so writer and reader do not false-share.
+	struct alignas(64) Slot
+	{
+		T Value = T();
+	};
+
+	Slot mSlots[3];
+	alignas(64) std::atomic<int> mMiddle{ 1 };
+	alignas(64) int mBack = 0;
+	alignas(64) int mFront = 2;
+};
\ No newline at end of file
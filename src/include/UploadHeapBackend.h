@@ -0,0 +1,63 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "RingAllocator.h"
+
+// A persistently mapped upload heap buffer for LinearRingAllocator. Buffers are
+// 64 KB aligned, so every 256-byte aligned offset is a valid constant buffer address.
+class UploadHeapBackend : public IMemoryBackend
+{
+public:
+	UploadHeapBackend(ID3D12Device* device, std::size_t size) :
+		mSize(size)
+	{
+		CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+		CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+		ThrowIfFailed(device->CreateCommittedResource(
+			&heapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&resourceDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&mBuffer)
+		));
+
+		ThrowIfFailed(mBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedData)));
+	}
+
+	UploadHeapBackend(const UploadHeapBackend& rhs) = delete;
+	UploadHeapBackend& operator=(const UploadHeapBackend& rhs) = delete;
+	~UploadHeapBackend()
+	{
+		if (mBuffer != nullptr)
+			mBuffer->Unmap(0, nullptr);
+
+		mMappedData = nullptr;
+	}
+
+	std::uint8_t* CpuAddress() override
+	{
+		return mMappedData;
+	}
+
+	std::uint64_t GpuAddress() const override
+	{
+		return mBuffer->GetGPUVirtualAddress();
+	}
+
+	std::size_t Size() const override
+	{
+		return mSize;
+	}
+
+	ID3D12Resource* Resource() const
+	{
+		return mBuffer.Get();
+	}
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Resource> mBuffer;
+	std::uint8_t* mMappedData = nullptr;
+	std::size_t mSize = 0;
+};
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cmath>
+
+// Minimal 3-component vector used by the CPU side of the fractal code.
+// Kept free of DirectXMath so it can be instantiated with any scalar type.
+template<typename T>
+struct Vec3T
+{
+	T x;
+	T y;
+	T z;
+
+	Vec3T() : x(0), y(0), z(0) {}
+	Vec3T(T x, T y, T z) : x(x), y(y), z(z) {}
+
+	template<typename U>
+	explicit Vec3T(const Vec3T<U>& v) : x(T(v.x)), y(T(v.y)), z(T(v.z)) {}
+
+	Vec3T operator+(const Vec3T& v) const { return Vec3T(x + v.x, y + v.y, z + v.z); }
+	Vec3T operator-(const Vec3T& v) const { return Vec3T(x - v.x, y - v.y, z - v.z); }
+	Vec3T operator-() const { return Vec3T(-x, -y, -z); }
+	Vec3T operator*(T s) const { return Vec3T(x * s, y * s, z * s); }
+	Vec3T operator/(T s) const { return Vec3T(x / s, y / s, z / s); }
+
+	Vec3T& operator+=(const Vec3T& v) { x += v.x; y += v.y; z += v.z; return *this; }
+	Vec3T& operator-=(const Vec3T& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+	Vec3T& operator*=(T s) { x *= s; y *= s; z *= s; return *this; }
+};
+
+template<typename T>
+inline Vec3T<T> operator*(T s, const Vec3T<T>& v)
+{
+	return v * s;
+}
+
+template<typename T>
+inline T Dot(const Vec3T<T>& a, const Vec3T<T>& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+template<typename T>
+inline Vec3T<T> Cross(const Vec3T<T>& a, const Vec3T<T>& b)
+{
+	return Vec3T<T>(
+		a.y * b.z - a.z * b.y,
+		a.z * b.x - a.x * b.z,
+		a.x * b.y - a.y * b.x);
+}
+
+template<typename T>
+inline T Length(const Vec3T<T>& v)
+{
+	using std::sqrt;
+	return sqrt(Dot(v, v));
+}
+
+template<typename T>
+inline Vec3T<T> Normalize(const Vec3T<T>& v)
+{
+	return v / Length(v);
+}
+
+typedef Vec3T<float> Vec3f;
+typedef Vec3T<double> Vec3d;
\ No newline at end of file
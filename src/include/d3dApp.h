@@ -2,6 +2,7 @@
 
 #include "d3dUtil.h"
 #include "GameTimer.h"
+#include "FrameStats.h"
 
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "D3D12.lib")
@@ -73,6 +74,8 @@ protected:
 	UINT m4xMsaaQuality = 0;
 
 	GameTimer mTimer;
+	FrameStats mFrameStats;
+	float mTitleRefreshTime = 0.0f; // total time of the last window title update
 
 	Microsoft::WRL::ComPtr<IDXGIFactory4> mdxgiFactory;
 	Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain;